@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2017, 2019, 2020, 2023  T+A elektroakustik GmbH & Co. KG
+ * Copyright (C) 2017, 2019, 2020, 2023, 2026  T+A elektroakustik GmbH & Co. KG
  *
  * This file is part of the T+A Streaming Board software stack ("StrBoWare").
  *
@@ -27,6 +27,7 @@
 #include <limits>
 #include <climits>
 #include <cstring>
+#include <numeric>
 #include <glib.h>
 
 #include "configuration.hh"
@@ -221,3 +222,112 @@ size_t Configuration::find_varname_offset_in_keyname(const char *key)
     const char *found = strrchr(key, ':');
     return (found == nullptr) ? 0 : found - key + 1;
 }
+
+/*! Number of seeds tried per bucket before the table is enlarged. */
+static constexpr uint32_t KEY_INDEX_MAX_SEEDS = 4096;
+
+Configuration::KeyNameIndex::KeyNameIndex(const std::vector<Name> &names)
+{
+    size_t number_of_buckets = 1;
+
+    while(number_of_buckets < names.size())
+        number_of_buckets *= 2;
+
+    const auto buckets(distribute(names, number_of_buckets));
+
+    for(size_t number_of_slots = 2 * number_of_buckets;
+        !build(names, buckets, number_of_slots);
+        number_of_slots *= 2)
+        ;
+}
+
+std::vector<std::vector<size_t>>
+Configuration::KeyNameIndex::distribute(const std::vector<Name> &names,
+                                        size_t number_of_buckets)
+{
+    std::vector<std::vector<size_t>> buckets(number_of_buckets);
+
+    for(size_t i = 0; i < names.size(); ++i)
+    {
+        auto &bucket(buckets[hash(names[i].first, names[i].second, 0) &
+                             (number_of_buckets - 1)]);
+
+        /* duplicates would never end up in distinct slots */
+        const auto dup =
+            std::find_if(bucket.begin(), bucket.end(),
+                [&names, i] (size_t j)
+                {
+                    return names[j].second == names[i].second &&
+                           memcmp(names[j].first, names[i].first,
+                                  names[i].second) == 0;
+                });
+
+        if(dup == bucket.end())
+            bucket.push_back(i);
+        else
+            MSG_BUG("Duplicate configuration key name \"%.*s\"",
+                    int(names[i].second), names[i].first);
+    }
+
+    return buckets;
+}
+
+bool Configuration::KeyNameIndex::build(const std::vector<Name> &names,
+                                        const std::vector<std::vector<size_t>> &buckets,
+                                        size_t number_of_slots)
+{
+    const size_t number_of_buckets = buckets.size();
+
+    /* place large buckets first while there are many free slots */
+    std::vector<size_t> order(number_of_buckets);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&buckets] (size_t a, size_t b)
+                     { return buckets[a].size() > buckets[b].size(); });
+
+    seeds_.assign(number_of_buckets, 0);
+    slots_.assign(number_of_slots, Slot{nullptr, SIZE_MAX, NOT_FOUND});
+
+    std::vector<size_t> candidate;
+
+    for(const size_t b : order)
+    {
+        const auto &bucket(buckets[b]);
+
+        if(bucket.empty())
+            break;
+
+        uint32_t seed;
+
+        for(seed = 1; seed <= KEY_INDEX_MAX_SEEDS; ++seed)
+        {
+            candidate.clear();
+
+            for(const size_t i : bucket)
+            {
+                const size_t s =
+                    hash(names[i].first, names[i].second, seed) & (number_of_slots - 1);
+
+                if(slots_[s].name != nullptr ||
+                   std::find(candidate.begin(), candidate.end(), s) != candidate.end())
+                    break;
+
+                candidate.push_back(s);
+            }
+
+            if(candidate.size() == bucket.size())
+                break;
+        }
+
+        if(seed > KEY_INDEX_MAX_SEEDS)
+            return false;
+
+        seeds_[b] = seed;
+
+        for(size_t j = 0; j < bucket.size(); ++j)
+            slots_[candidate[j]] = Slot{names[bucket[j]].first,
+                                        names[bucket[j]].second, bucket[j]};
+    }
+
+    return true;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2017, 2019, 2020, 2022, 2023  T+A elektroakustik GmbH & Co. KG
+ * Copyright (C) 2017, 2019, 2020, 2022, 2023, 2026  T+A elektroakustik GmbH & Co. KG
  *
  * This file is part of the T+A Streaming Board software stack ("StrBoWare").
  *
@@ -27,10 +27,17 @@
 #include <functional>
 #include <cstring>
 #include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
 
 #include "configuration_changed.hh"
+#include "configuration_keyindex.hh"
 #include "gvariantwrapper.hh"
 #include "inifile.h"
+#include "inifile_diff.h"
+#include "logged_lock.hh"
+#include "timebase.hh"
 #include "messages.h"
 
 /* for GVariant serialization/deserialization */
@@ -101,6 +108,44 @@ class ConfigManager: public ConfigChanged<ValuesT>
 
     UpdatedCallback configuration_updated_callback_;
 
+    /*!
+     * State of write-behind mode, see
+     * #Configuration::ConfigManager::enable_write_behind().
+     */
+    struct WriteBehind
+    {
+        const Timebase &timebase_;
+        const std::chrono::milliseconds debounce_;
+
+        /*! Protects all fields below. */
+        LoggedLock::Mutex lock_;
+        LoggedLock::ConditionVariable wakeup_;
+        bool is_dirty_;
+        bool is_shutting_down_;
+        Timebase::time_point deadline_;
+        ValuesT pending_values_;
+
+        /*! Incremented on each change, tells if values changed while
+         *  storing. */
+        unsigned int generation_;
+
+        /*! Serializes writing the file, taken before \c lock_. */
+        LoggedLock::Mutex store_lock_;
+
+        std::thread thread_;
+
+        explicit WriteBehind(const Timebase &timebase,
+                             std::chrono::milliseconds debounce):
+            timebase_(timebase),
+            debounce_(debounce),
+            is_dirty_(false),
+            is_shutting_down_(false),
+            generation_(0)
+        {}
+    };
+
+    std::unique_ptr<WriteBehind> write_behind_;
+
   public:
     ConfigManager(const ConfigManager &) = delete;
     ConfigManager &operator=(const ConfigManager &) = delete;
@@ -113,6 +158,8 @@ class ConfigManager: public ConfigChanged<ValuesT>
         update_settings_(settings_)
     {}
 
+    ~ConfigManager() { shutdown(); }
+
     void set_updated_notification_callback(UpdatedCallback &&callback)
     {
         configuration_updated_callback_ = callback;
@@ -122,6 +169,8 @@ class ConfigManager: public ConfigChanged<ValuesT>
     {
         msg_log_assert(!is_updating_);
 
+        flush();
+
         ValuesT loaded(default_settings_);
 
         if(try_load(configuration_file_, loaded))
@@ -132,6 +181,186 @@ class ConfigManager: public ConfigChanged<ValuesT>
         return settings_.is_valid();
     }
 
+    /*!
+     * Load configuration file again, notify about values changed in file.
+     *
+     * The file is compared with the current values, and only values which
+     * differ are updated and passed to the notification callback. Values
+     * removed from the file are reset to their defaults.
+     *
+     * \returns
+     *     True on success, false on error (current values unchanged). It is
+     *     an error if the file is missing or cannot be read.
+     */
+    bool reload(const char *origin)
+    {
+        msg_log_assert(!is_updating_);
+
+        flush();
+
+        struct ini_file current;
+        inifile_new(&current);
+
+        struct ini_section *section =
+            inifile_new_section(&current, ValuesT::CONFIGURATION_SECTION_NAME,
+                                sizeof(ValuesT::CONFIGURATION_SECTION_NAME) - 1);
+
+        if(section == nullptr)
+        {
+            inifile_free(&current);
+            return false;
+        }
+
+        store_values(section, settings_.values());
+
+        static const char *const sections[] = { ValuesT::CONFIGURATION_SECTION_NAME };
+        static const struct inifile_parse_options options
+        {
+            INIFILE_FLAG_NONE, sections, 1, nullptr
+        };
+
+        struct ini_file loaded;
+        struct inifile_diff diff;
+        bool result = false;
+
+        /* a file which cannot be read is not the same as an empty file */
+        const int parse_result =
+            inifile_parse_from_file_with_options(&loaded, configuration_file_,
+                                                 &options);
+
+        if(parse_result == 0 &&
+           inifile_compute_diff(&diff, &current, &loaded) == 0)
+        {
+            apply_changes(diff);
+            inifile_diff_free(&diff);
+            result = true;
+        }
+
+        if(parse_result >= 0)
+            inifile_free(&loaded);
+
+        inifile_free(&current);
+
+        if(result && settings_.is_changed())
+        {
+            if(configuration_updated_callback_ != nullptr)
+                configuration_updated_callback_(origin, settings_.get_changed_ids());
+
+            settings_.changes_processed_notification();
+        }
+
+        return result;
+    }
+
+    /*!
+     * Store changes on a background thread, coalescing quick successions.
+     *
+     * By default, each update scope which changes any value stores the
+     * configuration file before it is closed. In write-behind mode, the file
+     * is stored by a background thread once \p debounce has passed after
+     * the first change which has not been stored yet, so that all changes
+     * made within this window are stored at once. Notifications are still
+     * sent when the update scope is closed.
+     *
+     * Function #Configuration::ConfigManager::flush() stores pending changes
+     * immediately, and #Configuration::ConfigManager::shutdown() stores them
+     * and ends write-behind mode.
+     *
+     * If storing fails, the changes are kept pending and storing is
+     * retried after another \p debounce has passed.
+     *
+     * \param debounce
+     *     Maximum time changes are kept in memory before being stored.
+     *
+     * \param timebase
+     *     Time source for the debounce window. The background thread sleeps
+     *     in real time, but only stores the file when \p timebase says that
+     *     the window has passed.
+     *
+     * \param with_thread
+     *     Start the background thread. If false, pending changes are only
+     *     stored by #Configuration::ConfigManager::process_write_behind(),
+     *     #Configuration::ConfigManager::flush(), and
+     *     #Configuration::ConfigManager::shutdown(). This is meant for unit
+     *     tests which drive a mock \p timebase.
+     */
+    void enable_write_behind(std::chrono::milliseconds debounce,
+                             const Timebase &timebase, bool with_thread = true)
+    {
+        msg_log_assert(!is_updating_);
+        msg_log_assert(write_behind_ == nullptr);
+
+        write_behind_ = std::make_unique<WriteBehind>(timebase, debounce);
+
+        if(with_thread)
+            write_behind_->thread_ = std::thread([this] { write_behind_main(); });
+    }
+
+    void enable_write_behind(std::chrono::milliseconds debounce)
+    {
+        static const Timebase default_timebase;
+        enable_write_behind(debounce, default_timebase);
+    }
+
+    /*!
+     * Store changes pending in write-behind mode now.
+     *
+     * \returns
+     *     False if storing has failed, true otherwise (including the case
+     *     that there was nothing to store).
+     */
+    bool flush()
+    {
+        return write_behind_ == nullptr || store_pending(false);
+    }
+
+    /*!
+     * Store changes pending in write-behind mode if the debounce window has
+     * passed.
+     *
+     * This is what the background thread does when it wakes up. Unit tests
+     * call it directly to step through write-behind mode without a thread.
+     *
+     * \returns
+     *     False if storing has failed, true otherwise (including the case
+     *     that there was nothing to store yet).
+     */
+    bool process_write_behind()
+    {
+        return write_behind_ == nullptr || store_pending(true);
+    }
+
+    /*!
+     * End write-behind mode, storing pending changes.
+     *
+     * Changes are stored immediately again after this function has
+     * returned. Nothing happens if write-behind mode is not enabled.
+     *
+     * \returns
+     *     False if storing the pending changes has failed, true otherwise.
+     *     The changes are lost in case of failure.
+     */
+    bool shutdown()
+    {
+        if(write_behind_ == nullptr)
+            return true;
+
+        {
+            LoggedLock::UniqueLock<LoggedLock::Mutex> lock(write_behind_->lock_);
+            write_behind_->is_shutting_down_ = true;
+        }
+
+        write_behind_->wakeup_.notify_one();
+
+        if(write_behind_->thread_.joinable())
+            write_behind_->thread_.join();
+
+        const bool result = flush();
+        write_behind_.reset();
+
+        return result;
+    }
+
     void reset_to_defaults()
     {
         msg_log_assert(!is_updating_);
@@ -155,17 +384,10 @@ class ConfigManager: public ConfigChanged<ValuesT>
         if(!to_local_key(key))
             return GVariantWrapper();
 
-        const size_t requested_key_length(strlen(key));
-        const auto &it(std::find_if(
-            ValuesT::all_keys.begin(), ValuesT::all_keys.end(),
-            [key, requested_key_length] (const auto &k)
-            {
-                return k.name_.length() == requested_key_length &&
-                       strcmp(k.name_.c_str(), key) == 0;
-            }));
+        const size_t idx = get_full_name_index<ValuesT>().find(key);
 
-        return it != ValuesT::all_keys.end()
-            ? it->box(settings_.values())
+        return idx != KeyNameIndex::NOT_FOUND
+            ? ValuesT::all_keys[idx].box(settings_.values())
             : GVariantWrapper();
     }
 
@@ -204,7 +426,10 @@ class ConfigManager: public ConfigChanged<ValuesT>
 
         if(settings_.is_changed())
         {
-            store();
+            if(write_behind_ != nullptr)
+                mark_dirty();
+            else
+                store();
 
             if(configuration_updated_callback_ != nullptr)
                 configuration_updated_callback_(origin, settings_.get_changed_ids());
@@ -214,44 +439,260 @@ class ConfigManager: public ConfigChanged<ValuesT>
     }
 
   private:
-    static bool try_load(const char *file, ValuesT &values)
+    void mark_dirty()
     {
-        struct ini_file ini;
+        auto &wb(*write_behind_);
+        LoggedLock::UniqueLock<LoggedLock::Mutex> lock(wb.lock_);
 
-        if(inifile_parse_from_file(&ini, file) != 0)
-            return false;
+        wb.pending_values_ = settings_.values();
+        ++wb.generation_;
 
-        const auto *section =
-            inifile_find_section(&ini, ValuesT::CONFIGURATION_SECTION_NAME,
-                                 sizeof(ValuesT::CONFIGURATION_SECTION_NAME) - 1);
+        if(wb.is_dirty_)
+            return;
 
-        if(section == nullptr)
+        wb.is_dirty_ = true;
+        wb.deadline_ = wb.timebase_.now() + wb.debounce_;
+        wb.wakeup_.notify_one();
+    }
+
+    void write_behind_main()
+    {
+        auto &wb(*write_behind_);
+        LoggedLock::UniqueLock<LoggedLock::Mutex> lock(wb.lock_);
+
+        while(!wb.is_shutting_down_)
         {
-            inifile_free(&ini);
-            return false;
+            if(!wb.is_dirty_)
+            {
+                wb.wakeup_.wait(lock,
+                                [&wb] { return wb.is_dirty_ || wb.is_shutting_down_; });
+                continue;
+            }
+
+            const auto now = wb.timebase_.now();
+
+            if(now < wb.deadline_)
+            {
+                wb.wakeup_.wait_for(lock, wb.deadline_ - now,
+                                    [&wb] { return wb.is_shutting_down_; });
+                continue;
+            }
+
+            lock.unlock();
+            store_pending(true);
+            lock.lock();
         }
+    }
+
+    /*!
+     * Store pending changes, keep them pending on failure.
+     *
+     * Changes made while the file is being stored remain pending, as do
+     * all changes if storing fails. In both cases, the debounce window is
+     * started over.
+     */
+    bool store_pending(bool only_if_due)
+    {
+        auto &wb(*write_behind_);
+        LoggedLock::UniqueLock<LoggedLock::Mutex> store_lock(wb.store_lock_);
+        ValuesT values;
+        unsigned int generation;
 
-        for(const auto &k : ValuesT::all_keys)
         {
-            auto *kv = inifile_section_lookup_kv_pair(section,
-                                                      k.name_.c_str() + k.varname_offset_,
-                                                      k.name_.length() - k.varname_offset_);
+            LoggedLock::UniqueLock<LoggedLock::Mutex> lock(wb.lock_);
+
+            if(!wb.is_dirty_ ||
+               (only_if_due && wb.timebase_.now() < wb.deadline_))
+                return true;
 
-            if(kv != nullptr)
-                k.write(values, kv->value);
+            values = wb.pending_values_;
+            generation = wb.generation_;
         }
 
-        inifile_free(&ini);
+        const bool result = try_store(configuration_file_, values);
 
-        return true;
+        if(!result)
+            msg_error(0, LOG_ERR,
+                      "Failed storing configuration file \"%s\", will retry",
+                      configuration_file_);
+
+        LoggedLock::UniqueLock<LoggedLock::Mutex> lock(wb.lock_);
+
+        if(result && generation == wb.generation_)
+            wb.is_dirty_ = false;
+        else
+            wb.deadline_ = wb.timebase_.now() + wb.debounce_;
+
+        return result;
+    }
+
+    struct LoadContext
+    {
+        ValuesT &values;
+        bool is_in_section;
+        bool found_section;
+
+        explicit LoadContext(ValuesT &v):
+            values(v),
+            is_in_section(false),
+            found_section(false)
+        {}
+    };
+
+    static int load_section_begin(const char *name, size_t name_length,
+                                  void *user_data)
+    {
+        auto &ctx = *static_cast<LoadContext *>(user_data);
+
+        /* repeated sections are merged by the INI parser, so the rest of the
+         * file must be looked at even after our section has ended */
+        ctx.is_in_section =
+            name_length == sizeof(ValuesT::CONFIGURATION_SECTION_NAME) - 1 &&
+            memcmp(name, ValuesT::CONFIGURATION_SECTION_NAME, name_length) == 0;
+
+        if(ctx.is_in_section)
+            ctx.found_section = true;
+
+        return 0;
+    }
+
+    /*!
+     * Find key by its name in the configuration section.
+     *
+     * \returns
+     *     Index into \c ValuesT::all_keys, or \c ValuesT::NUMBER_OF_KEYS if
+     *     the key is unknown.
+     */
+    static size_t find_key_index(const char *key, size_t key_length)
+    {
+        const size_t idx =
+            get_variable_name_index<ValuesT>().find(key, key_length);
+
+        return idx != KeyNameIndex::NOT_FOUND ? idx : ValuesT::NUMBER_OF_KEYS;
+    }
+
+    template <typename KeyT>
+    static void write_value(const KeyT &k, ValuesT &values,
+                            const char *value, size_t value_length)
+    {
+        /* values are not zero-terminated in the file */
+        char buffer[128];
+
+        if(value_length < sizeof(buffer))
+        {
+            std::copy_n(value, value_length, buffer);
+            buffer[value_length] = '\0';
+            k.write(values, buffer);
+        }
+        else
+            k.write(values, std::string(value, value_length).c_str());
+    }
+
+    static int load_value(const char *key, size_t key_length,
+                          const char *value, size_t value_length,
+                          void *user_data)
+    {
+        auto &ctx = *static_cast<LoadContext *>(user_data);
+
+        if(!ctx.is_in_section)
+            return 0;
+
+        const size_t idx = find_key_index(key, key_length);
+
+        if(idx < ValuesT::NUMBER_OF_KEYS)
+            write_value(ValuesT::all_keys[idx], ctx.values, value, value_length);
+
+        return 0;
+    }
+
+    /*!
+     * Apply changes of values in configuration section found by reload.
+     *
+     * Values are marked as changed only if their serialized form differs
+     * after deserialization so that equivalent spellings in the file (such
+     * as different representations of the same number) are not reported.
+     */
+    void apply_changes(const struct inifile_diff &diff)
+    {
+        ValuesT values(settings_.values());
+        std::array<bool, ValuesT::NUMBER_OF_KEYS> changed;
+        changed.fill(false);
+
+        char before[128];
+        char after[128];
+
+        for(size_t i = 0; i < diff.number_of_changes; ++i)
+        {
+            const struct inifile_change &change(diff.changes[i]);
+            const struct ini_key_value_pair *kv;
+
+            switch(change.kind)
+            {
+              case INIFILE_CHANGE_VALUE_ADDED:
+              case INIFILE_CHANGE_VALUE_CHANGED:
+                kv = change.new_kv;
+                break;
+
+              case INIFILE_CHANGE_VALUE_REMOVED:
+                kv = change.old_kv;
+                break;
+
+              case INIFILE_CHANGE_SECTION_ADDED:
+              case INIFILE_CHANGE_SECTION_REMOVED:
+              default:
+                continue;
+            }
+
+            const size_t idx = find_key_index(kv->key, kv->key_length);
+
+            if(idx >= ValuesT::NUMBER_OF_KEYS)
+                continue;
+
+            const auto &k(ValuesT::all_keys[idx]);
+
+            k.read(before, sizeof(before), values);
+
+            if(change.kind == INIFILE_CHANGE_VALUE_REMOVED)
+            {
+                k.read(after, sizeof(after), default_settings_);
+                k.write(values, after);
+            }
+            else
+                write_value(k, values, kv->value, kv->value_length);
+
+            k.read(after, sizeof(after), values);
+
+            if(strcmp(before, after) != 0)
+                changed[static_cast<size_t>(k.id_)] = true;
+        }
+
+        settings_.put_changed(values, changed);
+    }
+
+    static bool try_load(const char *file, ValuesT &values)
+    {
+        LoadContext ctx(values);
+
+        if(inifile_parse_events_from_file(file, load_section_begin, load_value,
+                                          &ctx) != 0)
+            return false;
+
+        return ctx.found_section;
     }
 
     static bool try_store(const char *file, const ValuesT &values)
     {
+        /* strings point into the file so that only changed lines are
+         * written back */
+        static const struct inifile_parse_options options
+        {
+            INIFILE_FLAG_BORROWED, nullptr, 0, nullptr
+        };
+
         struct ini_file ini;
         struct ini_section *section;
 
-        if(inifile_parse_from_file(&ini, file) == 0)
+        if(inifile_parse_from_file_with_options(&ini, file, &options) == 0)
             section =
                 inifile_find_section(&ini, ValuesT::CONFIGURATION_SECTION_NAME,
                                      sizeof(ValuesT::CONFIGURATION_SECTION_NAME) - 1);
@@ -274,6 +715,16 @@ class ConfigManager: public ConfigChanged<ValuesT>
             }
         }
 
+        store_values(section, values);
+
+        const bool result = inifile_write_to_file_if_changed(&ini, file) >= 0;
+        inifile_free(&ini);
+
+        return result;
+    }
+
+    static void store_values(struct ini_section *section, const ValuesT &values)
+    {
         char buffer[128];
 
         for(const auto &k : ValuesT::all_keys)
@@ -289,11 +740,6 @@ class ConfigManager: public ConfigChanged<ValuesT>
                                                   k.name_.c_str() + k.varname_offset_,
                                                   k.name_.length() - k.varname_offset_);
         }
-
-        inifile_write_to_file(&ini, file);
-        inifile_free(&ini);
-
-        return true;
     }
 
     bool store()
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#ifndef CONFIGURATION_KEYINDEX_HH
+#define CONFIGURATION_KEYINDEX_HH
+
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <cstdint>
+
+namespace Configuration
+{
+
+/*!
+ * Perfect hash table mapping key names to indices into a table of keys.
+ *
+ * The table is built once from a fixed set of unique names. The names are
+ * distributed over buckets by a first hash function, and each bucket gets
+ * its own seed for a second hash function such that all names end up in
+ * distinct slots ("hash and displace"). Looking up a name takes two hash
+ * computations and at most one string comparison, and it never allocates
+ * memory.
+ */
+class KeyNameIndex
+{
+  public:
+    static constexpr size_t NOT_FOUND = SIZE_MAX;
+
+    /*! Name and its length, not necessarily zero-terminated. */
+    using Name = std::pair<const char *, size_t>;
+
+  private:
+    struct Slot
+    {
+        const char *name;
+        size_t length;
+        size_t index;
+    };
+
+    std::vector<uint32_t> seeds_;
+    std::vector<Slot> slots_;
+
+  public:
+    KeyNameIndex(const KeyNameIndex &) = delete;
+    KeyNameIndex &operator=(const KeyNameIndex &) = delete;
+
+    /*!
+     * Build index for given names.
+     *
+     * The position of each name in \p names is the index returned by
+     * #Configuration::KeyNameIndex::find() for that name. The strings must
+     * outlive the index.
+     */
+    explicit KeyNameIndex(const std::vector<Name> &names);
+
+    /*!
+     * Look up name.
+     *
+     * \returns
+     *     Position of \p name in the names passed to the constructor, or
+     *     #Configuration::KeyNameIndex::NOT_FOUND.
+     */
+    size_t find(const char *name, size_t length) const
+    {
+        const size_t bucket = hash(name, length, 0) & (seeds_.size() - 1);
+        const Slot &slot(slots_[hash(name, length, seeds_[bucket]) &
+                                (slots_.size() - 1)]);
+
+        return slot.length == length && memcmp(slot.name, name, length) == 0
+            ? slot.index
+            : NOT_FOUND;
+    }
+
+    /*!
+     * Look up zero-terminated name.
+     *
+     * The length of the name is determined while computing the first hash,
+     * so there is no extra pass over \p name.
+     */
+    size_t find(const char *name) const
+    {
+        /* same as #hash() with seed 0 */
+        uint32_t h = 2166136261U * 16777619U;
+        size_t length = 0;
+
+        for(/* nothing */; name[length] != '\0'; ++length)
+        {
+            h ^= static_cast<uint8_t>(name[length]);
+            h *= 16777619U;
+        }
+
+        const size_t bucket = mix(h) & (seeds_.size() - 1);
+        const Slot &slot(slots_[hash(name, length, seeds_[bucket]) &
+                                (slots_.size() - 1)]);
+
+        return slot.length == length && memcmp(slot.name, name, length) == 0
+            ? slot.index
+            : NOT_FOUND;
+    }
+
+  private:
+    /*!
+     * Seeded FNV-1a, with final mixing so that the low bits are usable.
+     */
+    static uint32_t hash(const char *name, size_t length, uint32_t seed)
+    {
+        uint32_t h = (2166136261U ^ seed) * 16777619U;
+
+        for(size_t i = 0; i < length; ++i)
+        {
+            h ^= static_cast<uint8_t>(name[i]);
+            h *= 16777619U;
+        }
+
+        return mix(h);
+    }
+
+    static uint32_t mix(uint32_t h)
+    {
+        h ^= h >> 16;
+        h *= 0x85ebca6bU;
+        h ^= h >> 13;
+
+        return h;
+    }
+
+    /*!
+     * Distribute names over buckets by the first hash function.
+     *
+     * Duplicate names are reported as bug and left out.
+     */
+    static std::vector<std::vector<size_t>>
+    distribute(const std::vector<Name> &names, size_t number_of_buckets);
+
+    bool build(const std::vector<Name> &names,
+               const std::vector<std::vector<size_t>> &buckets,
+               size_t number_of_slots);
+};
+
+/*!
+ * Index of the key names as they appear in the configuration section of the
+ * INI file managed for \p ValuesT, built on first use.
+ */
+template <typename ValuesT>
+static const KeyNameIndex &get_variable_name_index()
+{
+    static const KeyNameIndex index(
+        [] ()
+        {
+            std::vector<KeyNameIndex::Name> names;
+
+            for(const auto &k : ValuesT::all_keys)
+                names.emplace_back(k.name_.c_str() + k.varname_offset_,
+                                   k.name_.length() - k.varname_offset_);
+
+            return names;
+        }());
+
+    return index;
+}
+
+/*!
+ * Index of the full key names in \c ValuesT::all_keys, built on first use.
+ */
+template <typename ValuesT>
+static const KeyNameIndex &get_full_name_index()
+{
+    static const KeyNameIndex index(
+        [] ()
+        {
+            std::vector<KeyNameIndex::Name> names;
+
+            for(const auto &k : ValuesT::all_keys)
+                names.emplace_back(k.name_.c_str(), k.name_.length());
+
+            return names;
+        }());
+
+    return index;
+}
+
+}
+
+#endif /* !CONFIGURATION_KEYINDEX_HH */
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2017, 2019, 2022, 2023  T+A elektroakustik GmbH & Co. KG
+ * Copyright (C) 2017, 2019, 2022, 2023, 2026  T+A elektroakustik GmbH & Co. KG
  *
  * This file is part of the T+A Streaming Board software stack ("StrBoWare").
  *
@@ -88,6 +88,24 @@ class Settings
         is_valid_ = true;
     }
 
+    /*!
+     * Replace all values, marking the values with given IDs as changed.
+     */
+    void put_changed(const ValuesT &v,
+                     const std::array<bool, ValuesT::NUMBER_OF_KEYS> &changed)
+    {
+        put(v);
+
+        for(size_t i = 0; i < changed.size(); ++i)
+        {
+            if(changed[i])
+            {
+                changed_[i] = true;
+                has_pending_changes_ = true;
+            }
+        }
+    }
+
     bool is_valid() const { return is_valid_; }
     bool is_changed() const { return has_pending_changes_; }
 
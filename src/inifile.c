@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2015, 2018, 2019, 2022, 2023  T+A elektroakustik GmbH & Co. KG
+ * Copyright (C) 2015, 2018, 2019, 2022, 2023, 2026  T+A elektroakustik GmbH & Co. KG
  *
  * This file is part of the T+A Streaming Board software stack ("StrBoWare").
  *
@@ -24,11 +24,18 @@
 #endif /* HAVE_CONFIG_H */
 
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "inifile.h"
+#include "inifile_index.h"
+#include "inifile_pool.h"
+#include "inifile_scan.h"
 #include "messages.h"
 #include "os.h"
 
@@ -37,8 +44,9 @@ enum parser_state
     STATE_EXPECT_SECTION_BEGIN = 0,
     STATE_EXPECT_SECTION_NAME,
     STATE_EXPECT_ASSIGNMENT,
+    STATE_SKIP_SECTION,
 
-    STATE_LAST_PARSER_STATE = STATE_EXPECT_ASSIGNMENT,
+    STATE_LAST_PARSER_STATE = STATE_SKIP_SECTION,
 };
 
 enum skip_result
@@ -48,25 +56,173 @@ enum skip_result
     SKIP_RESULT_EOF,
 };
 
+struct parser_data;
+
+/*!
+ * What the parser does with the sections and assignments it finds.
+ *
+ * The functions return 0 to continue parsing, 1 to stop parsing, or -1 to
+ * abort parsing with an error.
+ */
+struct parser_events
+{
+    int (*section_begin)(struct parser_data *data,
+                         const char *name, size_t name_length);
+    int (*key_value)(struct parser_data *data,
+                     const char *key, size_t key_length,
+                     const char *value, size_t value_length);
+};
+
 struct parser_data
 {
     const char *const source;
     const char *const content;
     const size_t size;
+    const struct parser_events *const events;
 
+    /* for building INI file structures */
     struct ini_file *const inifile;
     struct ini_section *current_section;
+
+    /* sections to be parsed, all others are skipped */
+    const char *const *const sections;
+    const size_t number_of_sections;
+
+    /* for event-based parsing */
+    const inifile_section_event_fn section_fn;
+    const inifile_value_event_fn value_fn;
+    void *const user_data;
+
     size_t pos;
     size_t line;
     enum parser_state state;
+    bool stop;
+
+    /* do not report syntax errors, they have been reported before */
+    bool is_quiet;
+};
+
+/*!
+ * Memory block in an arena, a linked list.
+ */
+struct arena_block
+{
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+};
+
+struct inifile_storage
+{
+    unsigned int flags;
+
+    /*! Arena blocks, block with free space is always at the head. */
+    struct arena_block *blocks;
+
+    /*! Size of next arena block allocated for small objects. */
+    size_t next_block_size;
+
+    /*! Index of sections by name, only for #INIFILE_FLAG_INDEX. */
+    struct inifile_index sections_index;
+
+    /*! Parsed file kept mapped for #INIFILE_FLAG_BORROWED. */
+    struct os_mapped_file_data mapped;
+
+    /*! Parsed input for #INIFILE_FLAG_BORROWED, the strings point into it. */
+    const char *borrowed_content;
+    size_t borrowed_size;
+
+    /*! Pool section names and keys are taken from, may be \c NULL. */
+    struct inifile_string_pool *string_pool;
+};
+
+/*!
+ * Entry in a compact copy of key/value pairs.
+ *
+ * Offsets are relative to the strings following the array of entries.
+ */
+struct compact_entry
+{
+    uint32_t key_offset;
+    uint32_t key_length;
+    uint32_t value_offset;
+    uint32_t value_length;
 };
 
+/*!
+ * Compact copy of the key/value pairs of a section.
+ *
+ * The array of entries is followed by all keys and values, each
+ * zero-terminated, in order of the entries.
+ */
+struct inifile_compact_values
+{
+    size_t number_of_entries;
+    size_t strings_size;
+    struct compact_entry entries[];
+};
+
+#define ARENA_MIN_BLOCK_SIZE    ((size_t)4096)
+#define ARENA_MAX_BLOCK_SIZE    ((size_t)256 * 1024)
+
+/*!
+ * Internal storage flag for indices which only exist while parsing.
+ *
+ * Memory for these indices is always taken from the heap, even if the INI
+ * file uses an arena, so that it can be returned after parsing.
+ */
+#define STORAGE_FLAG_PARSER_INDEX   (1U << 31)
+
+/*!
+ * Internal storage flag set while parsing with #INIFILE_FLAG_BORROWED.
+ *
+ * Strings passed to #parser_strdup() are not copied while this flag is set.
+ */
+#define STORAGE_FLAG_BORROW_STRINGS (1U << 30)
+
+/*!
+ * Inputs smaller than this are parsed without temporary indices.
+ *
+ * Linear search through a handful of keys is cheaper than setting up and
+ * tearing down the hash tables.
+ */
+#define PARSER_INDEX_MIN_SIZE   ((size_t)1024)
+
 void inifile_new(struct ini_file *inifile)
+{
+    inifile_new_with_flags(inifile, INIFILE_FLAG_NONE);
+}
+
+void inifile_new_with_flags(struct ini_file *inifile, unsigned int flags)
+{
+    inifile_new_with_string_pool(inifile, flags, NULL);
+}
+
+void inifile_new_with_string_pool(struct ini_file *inifile, unsigned int flags,
+                                  struct inifile_string_pool *string_pool)
 {
     msg_log_assert(inifile != NULL);
 
+    if((flags & INIFILE_FLAG_BORROWED) != 0)
+        flags |= INIFILE_FLAG_ARENA;
+
     inifile->sections_head = NULL;
     inifile->sections_tail = NULL;
+    inifile->flags = flags;
+    inifile->string_pool = string_pool;
+    inifile->storage = NULL;
+}
+
+static void new_with_options(struct ini_file *inifile,
+                             const struct inifile_parse_options *options,
+                             unsigned int ignored_flags)
+{
+    if(options != NULL)
+        inifile_new_with_string_pool(inifile, options->flags & ~ignored_flags,
+                                     options->string_pool);
+    else
+        inifile_new(inifile);
 }
 
 static inline char peek_character(const struct parser_data *data)
@@ -99,15 +255,13 @@ static enum skip_result enter_next_line(struct parser_data *data)
  */
 static enum skip_result skip_spaces(struct parser_data *data)
 {
-    for(/* nothing */; data->pos < data->size; ++data->pos)
-    {
-        const char ch = peek_character(data);
+    data->pos += inifile_scan_for_nonblank(data->content + data->pos,
+                                           data->size - data->pos);
 
-        if(!isblank(ch))
-            return ch != '\n' ? SKIP_RESULT_OK : enter_next_line(data);
-    }
+    if(data->pos >= data->size)
+        return SKIP_RESULT_EOF;
 
-    return SKIP_RESULT_EOF;
+    return peek_character(data) != '\n' ? SKIP_RESULT_OK : enter_next_line(data);
 }
 
 /*!
@@ -155,18 +309,13 @@ static enum skip_result skip_spaces_reverse(struct parser_data *data)
  */
 static enum skip_result skip_until(struct parser_data *data, char until)
 {
-    for(/* nothing */; data->pos < data->size; ++data->pos)
-    {
-        const char ch = peek_character(data);
-
-        if(ch == until)
-            return SKIP_RESULT_OK;
+    data->pos += inifile_scan_for_either(data->content + data->pos,
+                                         data->size - data->pos, until, '\n');
 
-        if(ch == '\n')
-            return enter_next_line(data);
-    }
+    if(data->pos >= data->size)
+        return SKIP_RESULT_EOF;
 
-    return SKIP_RESULT_EOF;
+    return peek_character(data) == until ? SKIP_RESULT_OK : enter_next_line(data);
 }
 
 /*!
@@ -178,13 +327,10 @@ static enum skip_result skip_until(struct parser_data *data, char until)
  */
 static enum skip_result skip_line(struct parser_data *data)
 {
-    for(/* nothing */; data->pos < data->size; ++data->pos)
-    {
-        if(peek_character(data) == '\n')
-            return enter_next_line(data);
-    }
+    if(skip_until(data, '\n') == SKIP_RESULT_EOF)
+        return SKIP_RESULT_EOF;
 
-    return SKIP_RESULT_EOF;
+    return enter_next_line(data);
 }
 
 /*!
@@ -192,6 +338,88 @@ static enum skip_result skip_line(struct parser_data *data)
  */
 #define ERROR_LOCATION_FMTSTR  " (line %zu in \"%s\")"
 
+/*!
+ * Report syntax error, unless the parser has been told to be quiet.
+ */
+#define parser_error(DATA, ...) \
+    do \
+    { \
+        if(!(DATA)->is_quiet) \
+            msg_error(__VA_ARGS__); \
+    } \
+    while(0)
+
+/*!
+ * Turn return value of #parser_events functions into parser handler result.
+ */
+static int event_result(struct parser_data *data, int ret)
+{
+    if(ret > 0)
+    {
+        data->stop = true;
+        return 0;
+    }
+
+    return ret < 0 ? -1 : 0;
+}
+
+static int tree_section_begin(struct parser_data *data,
+                              const char *name, size_t name_length)
+{
+    data->current_section = inifile_new_section(data->inifile, name, name_length);
+    return data->current_section != NULL ? 0 : -1;
+}
+
+static int tree_key_value(struct parser_data *data,
+                          const char *key, size_t key_length,
+                          const char *value, size_t value_length)
+{
+    msg_log_assert(data->current_section != NULL);
+
+    const struct ini_key_value_pair *kv = value_length > 0
+        ? inifile_section_store_value(data->current_section,
+                                      key, key_length, value, value_length)
+        : inifile_section_store_empty_value(data->current_section,
+                                            key, key_length);
+
+    return kv != NULL ? 0 : -1;
+}
+
+/*!
+ * Parser events for building an INI file structure.
+ */
+static const struct parser_events tree_events =
+{
+    .section_begin = tree_section_begin,
+    .key_value = tree_key_value,
+};
+
+static int user_section_begin(struct parser_data *data,
+                              const char *name, size_t name_length)
+{
+    return data->section_fn != NULL
+        ? data->section_fn(name, name_length, data->user_data)
+        : 0;
+}
+
+static int user_key_value(struct parser_data *data,
+                          const char *key, size_t key_length,
+                          const char *value, size_t value_length)
+{
+    return data->value_fn != NULL
+        ? data->value_fn(key, key_length, value, value_length, data->user_data)
+        : 0;
+}
+
+/*!
+ * Parser events for passing sections and assignments to user callbacks.
+ */
+static const struct parser_events user_events =
+{
+    .section_begin = user_section_begin,
+    .key_value = user_key_value,
+};
+
 /*!
  * Recognize beginning of a section header.
  *
@@ -217,9 +445,9 @@ static int parse_section_begin(struct parser_data *data)
 
     if(peek_character(data) != '[')
     {
-        msg_error(EINVAL, LOG_ERR,
-                  "Expected begin of section, got junk" ERROR_LOCATION_FMTSTR,
-                  data->line, data->source);
+        parser_error(data, EINVAL, LOG_ERR,
+                     "Expected begin of section, got junk" ERROR_LOCATION_FMTSTR,
+                     data->line, data->source);
         return 1;
     }
 
@@ -229,12 +457,30 @@ static int parse_section_begin(struct parser_data *data)
     return 0;
 }
 
+static bool is_section_wanted(const struct parser_data *data,
+                              const char *name, size_t length)
+{
+    if(data->sections == NULL)
+        return true;
+
+    for(size_t i = 0; i < data->number_of_sections; ++i)
+    {
+        if(strncmp(data->sections[i], name, length) == 0 &&
+           data->sections[i][length] == '\0')
+            return true;
+    }
+
+    return false;
+}
+
 /*!
  * Read section name, closing bracket, and rest of line.
  *
  * Possible next states:
  * - #STATE_EXPECT_ASSIGNMENT    on success, causing the parser to read
  *                               key/value pairs for this section.
+ * - #STATE_SKIP_SECTION         on success for sections not in the list of
+ *                               sections to be parsed.
  * - #STATE_EXPECT_SECTION_BEGIN on error, causing the parser to find the next
  *                               section header.
  */
@@ -250,15 +496,15 @@ static int parse_section_name(struct parser_data *data)
     switch(skip_until(data, ']'))
     {
       case SKIP_RESULT_EOF:
-        msg_error(EINVAL, LOG_ERR,
-                  "End of file within section header" ERROR_LOCATION_FMTSTR,
-                  data->line, data->source);
+        parser_error(data, EINVAL, LOG_ERR,
+                     "End of file within section header" ERROR_LOCATION_FMTSTR,
+                     data->line, data->source);
         return 0;
 
       case SKIP_RESULT_EOL:
-        msg_error(EINVAL, LOG_ERR,
-                  "End of line within section header" ERROR_LOCATION_FMTSTR,
-                  data->line - 1, data->source);
+        parser_error(data, EINVAL, LOG_ERR,
+                     "End of line within section header" ERROR_LOCATION_FMTSTR,
+                     data->line - 1, data->source);
         return 0;
 
       case SKIP_RESULT_OK:
@@ -269,8 +515,9 @@ static int parse_section_name(struct parser_data *data)
 
     if(length == 0)
     {
-        msg_error(EINVAL, LOG_ERR, "Empty section name" ERROR_LOCATION_FMTSTR,
-                  data->line, data->source);
+        parser_error(data, EINVAL, LOG_ERR,
+                     "Empty section name" ERROR_LOCATION_FMTSTR,
+                     data->line, data->source);
         return 1;
     }
 
@@ -279,9 +526,9 @@ static int parse_section_name(struct parser_data *data)
     switch(skip_spaces(data))
     {
       case SKIP_RESULT_OK:
-        msg_error(EINVAL, LOG_ERR,
-                  "Got junk after section header" ERROR_LOCATION_FMTSTR,
-                  data->line, data->source);
+        parser_error(data, EINVAL, LOG_ERR,
+                     "Got junk after section header" ERROR_LOCATION_FMTSTR,
+                     data->line, data->source);
         return 1;
 
       case SKIP_RESULT_EOF:
@@ -289,16 +536,18 @@ static int parse_section_name(struct parser_data *data)
         break;
     }
 
-    data->current_section =
-        inifile_new_section(data->inifile,
-                            data->content + start_of_name, length);
-
-    if(data->current_section == NULL)
-        return -1;
+    if(!is_section_wanted(data, data->content + start_of_name, length))
+    {
+        data->state = STATE_SKIP_SECTION;
+        return 0;
+    }
 
     data->state = STATE_EXPECT_ASSIGNMENT;
 
-    return 0;
+    return event_result(data,
+                        data->events->section_begin(data,
+                                                    data->content + start_of_name,
+                                                    length));
 }
 
 static int parse_key_or_value(struct parser_data *data, size_t start_of_token,
@@ -306,8 +555,8 @@ static int parse_key_or_value(struct parser_data *data, size_t start_of_token,
 {
     if(data->pos == start_of_token)
     {
-        msg_error(EINVAL, LOG_ERR, "Expected %s" ERROR_LOCATION_FMTSTR,
-                  what, data->line, data->source);
+        parser_error(data, EINVAL, LOG_ERR, "Expected %s" ERROR_LOCATION_FMTSTR,
+                     what, data->line, data->source);
         return -1;
     }
 
@@ -347,28 +596,24 @@ static int parse_nonempty_value(struct parser_data *const data,
     if(parse_key_or_value(data, start_of_value, "value", &length_of_value) < 0)
         return 1;
 
-    const struct ini_key_value_pair *kv =
-        inifile_section_store_value(data->current_section,
-                                    data->content + start_of_key,
-                                    length_of_key,
-                                    data->content + start_of_value,
-                                    length_of_value);
+    const int ret =
+        data->events->key_value(data,
+                                data->content + start_of_key, length_of_key,
+                                data->content + start_of_value, length_of_value);
 
     if(skipped == SKIP_RESULT_OK)
         ++data->line;
 
-    return kv != NULL ? 0 : -1;
+    return event_result(data, ret);
 }
 
 static int insert_empty_value_for_key(struct parser_data *const data,
                                 const size_t start_of_key, const size_t length_of_key)
 {
-    const struct ini_key_value_pair *kv =
-        inifile_section_store_empty_value(data->current_section,
-                                          data->content + start_of_key,
-                                          length_of_key);
-
-    return kv != NULL ? 0 : -1;
+    return event_result(data,
+                        data->events->key_value(data,
+                                                data->content + start_of_key,
+                                                length_of_key, "", 0));
 }
 
 /*!
@@ -384,7 +629,6 @@ static int insert_empty_value_for_key(struct parser_data *const data,
 static int parse_assignment(struct parser_data *data)
 {
     msg_log_assert(data->state == STATE_EXPECT_ASSIGNMENT);
-    msg_log_assert(data->current_section != NULL);
 
     switch(skip_spaces(data))
     {
@@ -412,9 +656,9 @@ static int parse_assignment(struct parser_data *data)
         /* fall-through */
 
       case SKIP_RESULT_EOL:
-        msg_error(EINVAL, LOG_ERR,
-                  "Expected assignment" ERROR_LOCATION_FMTSTR,
-                  data->line - 1, data->source);
+        parser_error(data, EINVAL, LOG_ERR,
+                     "Expected assignment" ERROR_LOCATION_FMTSTR,
+                     data->line - 1, data->source);
         return 0;
 
       case SKIP_RESULT_OK:
@@ -445,6 +689,40 @@ static int parse_assignment(struct parser_data *data)
     return ret;
 }
 
+/*!
+ * Skip lines of an unwanted section without looking at their contents.
+ *
+ * Possible next states:
+ * - #STATE_EXPECT_SECTION_BEGIN in case a '[' character was found starting a
+ *                               line.
+ */
+static int skip_section(struct parser_data *data)
+{
+    msg_log_assert(data->state == STATE_SKIP_SECTION);
+
+    while(data->pos < data->size)
+    {
+        switch(skip_spaces(data))
+        {
+          case SKIP_RESULT_OK:
+            if(peek_character(data) == '[')
+            {
+                data->state = STATE_EXPECT_SECTION_BEGIN;
+                return 0;
+            }
+
+            skip_line(data);
+            break;
+
+          case SKIP_RESULT_EOL:
+          case SKIP_RESULT_EOF:
+            break;
+        }
+    }
+
+    return 0;
+}
+
 /*!
  * Signature of handlers for parser states.
  */
@@ -461,9 +739,10 @@ static int parse_memory(struct parser_data *data)
         parse_section_begin,
         parse_section_name,
         parse_assignment,
+        skip_section,
     };
 
-    while(data->pos < data->size)
+    while(data->pos < data->size && !data->stop)
     {
         int ret = parser_state_handlers[data->state](data);
 
@@ -477,6 +756,16 @@ static int parse_memory(struct parser_data *data)
 }
 
 int inifile_parse_from_file(struct ini_file *inifile, const char *filename)
+{
+    return inifile_parse_from_file_with_options(inifile, filename, NULL);
+}
+
+/*!
+ * Parse file, in parallel if \p number_of_threads is not 1.
+ */
+static int parse_file(struct ini_file *inifile, const char *filename,
+                      const struct inifile_parse_options *options,
+                      unsigned int number_of_threads)
 {
     msg_log_assert(inifile != NULL);
     msg_log_assert(filename != NULL);
@@ -485,338 +774,2433 @@ int inifile_parse_from_file(struct ini_file *inifile, const char *filename)
 
     if(os_map_file_to_memory(&mapped, filename) < 0)
     {
-        inifile_new(inifile);
+        new_with_options(inifile, options, 0);
         return 1;
     }
 
-    int ret = inifile_parse_from_memory(inifile, filename,
-                                        mapped.ptr, mapped.length);
+    int ret = number_of_threads == 1
+        ? inifile_parse_from_memory_with_options(inifile, filename,
+                                                 mapped.ptr, mapped.length,
+                                                 options)
+        : inifile_parse_from_memory_parallel(inifile, filename,
+                                             mapped.ptr, mapped.length,
+                                             options, number_of_threads);
 
-    os_unmap_file(&mapped);
+    if(ret == 0 && (inifile->flags & INIFILE_FLAG_BORROWED) != 0)
+    {
+        /* parsed structure points into the mapped file */
+        inifile->storage->mapped = mapped;
+    }
+    else
+        os_unmap_file(&mapped);
 
     return ret;
 }
 
+int inifile_parse_from_file_with_options(struct ini_file *inifile,
+                                         const char *filename,
+                                         const struct inifile_parse_options *options)
+{
+    return parse_file(inifile, filename, options, 1);
+}
+
+int inifile_parse_from_file_parallel(struct ini_file *inifile,
+                                     const char *filename,
+                                     const struct inifile_parse_options *options,
+                                     unsigned int number_of_threads)
+{
+    return parse_file(inifile, filename, options, number_of_threads);
+}
+
+static int create_storage(struct ini_file *inifile, size_t size_hint);
+static int begin_parser_index(struct ini_file *inifile, size_t size);
+static void end_parser_index(struct ini_file *inifile);
+static void end_parser_compact(struct ini_file *inifile);
+
 int inifile_parse_from_memory(struct ini_file *inifile, const char *source,
                               const char *content, size_t size)
 {
-    msg_log_assert(inifile != NULL);
-    msg_log_assert(content != NULL);
+    return inifile_parse_from_memory_with_options(inifile, source,
+                                                  content, size, NULL);
+}
+
+/*!
+ * Parse text into INI file structure.
+ *
+ * \param first_line
+ *     Line number of the first line in \p content for diagnostics.
+ */
+static int parse_tree(struct ini_file *inifile, const char *source,
+                      const char *content, size_t size,
+                      const struct inifile_parse_options *options,
+                      size_t first_line)
+{
+    new_with_options(inifile, options, 0);
+
+    if(create_storage(inifile, size) < 0 ||
+       begin_parser_index(inifile, size) < 0)
+    {
+        inifile_free(inifile);
+        return -1;
+    }
 
-    inifile_new(inifile);
+    if((inifile->flags & INIFILE_FLAG_BORROWED) != 0)
+    {
+        inifile->storage->flags |= STORAGE_FLAG_BORROW_STRINGS;
+        inifile->storage->borrowed_content = content;
+        inifile->storage->borrowed_size = size;
+    }
 
     struct parser_data data =
     {
         .source = source,
         .content = content,
         .size = size,
+        .events = &tree_events,
         .inifile = inifile,
         .current_section = NULL,
+        .sections = options != NULL ? options->sections : NULL,
+        .number_of_sections = options != NULL ? options->number_of_sections : 0,
         .pos = 0,
-        .line = 1,
+        .line = first_line,
         .state = STATE_EXPECT_SECTION_BEGIN,
     };
 
     int ret = parse_memory(&data);
 
+    end_parser_index(inifile);
+    end_parser_compact(inifile);
+
+    if(inifile->storage != NULL)
+        inifile->storage->flags &= ~STORAGE_FLAG_BORROW_STRINGS;
+
     if(ret < 0)
         inifile_free(inifile);
 
     return ret;
 }
 
-static void *parser_malloc(size_t size)
+int inifile_parse_from_memory_with_options(struct ini_file *inifile,
+                                           const char *source,
+                                           const char *content, size_t size,
+                                           const struct inifile_parse_options *options)
 {
-    void *ptr = malloc(size);
-
-    if(ptr == NULL)
-        msg_error(errno, LOG_ERR, "malloc() failed for %zu bytes", size);
+    msg_log_assert(inifile != NULL);
+    msg_log_assert(content != NULL);
 
-    return ptr;
+    return parse_tree(inifile, source, content, size, options, 1);
 }
 
-static void parser_free(void *ptr)
+int inifile_parse_events_from_memory(const char *source,
+                                     const char *content, size_t size,
+                                     inifile_section_event_fn section_fn,
+                                     inifile_value_event_fn value_fn,
+                                     void *user_data)
 {
-    if(ptr != NULL)
-        free(ptr);
+    msg_log_assert(content != NULL || size == 0);
+
+    struct parser_data data =
+    {
+        .source = source,
+        .content = content,
+        .size = size,
+        .events = &user_events,
+        .section_fn = section_fn,
+        .value_fn = value_fn,
+        .user_data = user_data,
+        .pos = 0,
+        .line = 1,
+        .state = STATE_EXPECT_SECTION_BEGIN,
+    };
+
+    return parse_memory(&data);
 }
 
-static char *parser_strdup(const char *string, size_t size)
+int inifile_parse_events_from_file(const char *filename,
+                                   inifile_section_event_fn section_fn,
+                                   inifile_value_event_fn value_fn,
+                                   void *user_data)
 {
-    char *cp = parser_malloc(size + 1);
+    msg_log_assert(filename != NULL);
 
-    if(cp == NULL)
-        return NULL;
+    struct os_mapped_file_data mapped;
 
-    memcpy(cp, string, size);
-    cp[size] = '\0';
+    if(os_map_file_to_memory(&mapped, filename) < 0)
+        return 1;
 
-    return cp;
+    const int ret =
+        inifile_parse_events_from_memory(filename, mapped.ptr, mapped.length,
+                                         section_fn, value_fn, user_data);
+
+    os_unmap_file(&mapped);
+
+    return ret;
 }
 
-struct ini_section *inifile_new_section(struct ini_file *inifile,
-                                        const char *name, size_t length)
+/*!
+ * Parse a range of complete lines fed to a push parser.
+ */
+static int push_parser_parse(struct inifile_push_parser *parser,
+                             const char *content, size_t size)
 {
-    if(length == 0)
-        length = strlen(name);
-
-    if(length == 0)
-        return NULL;
+    struct parser_data data =
+    {
+        .source = parser->source,
+        .content = content,
+        .size = size,
+        .events = &tree_events,
+        .inifile = parser->inifile,
+        .current_section = parser->current_section,
+        .sections = parser->sections,
+        .number_of_sections = parser->number_of_sections,
+        .pos = 0,
+        .line = parser->line,
+        .state = (enum parser_state)parser->state,
+    };
 
-    struct ini_section *section = inifile_find_section(inifile, name, length);
-    if(section != NULL)
-        return section;
+    const int ret = parse_memory(&data);
 
-    section = parser_malloc(sizeof(*section));
+    parser->current_section = data.current_section;
+    parser->line = data.line;
+    parser->state = data.state;
 
-    if(section == NULL)
-        return NULL;
+    return ret;
+}
 
-    section->next = NULL;
-    section->values_head = NULL;
-    section->name_length = length;
-    section->name = parser_strdup(name, length);
+static int push_parser_carry(struct inifile_push_parser *parser,
+                             const char *data, size_t size)
+{
+    if(size == 0)
+        return 0;
 
-    if(section->name == NULL)
+    if(parser->carry_capacity - parser->carry_size < size)
     {
-        parser_free(section);
-        return NULL;
-    }
+        size_t capacity = parser->carry_capacity > 0 ? parser->carry_capacity : 256;
 
-    if(inifile->sections_head == NULL)
-        inifile->sections_head = section;
+        while(capacity - parser->carry_size < size)
+            capacity *= 2;
+
+        char *carry = realloc(parser->carry, capacity);
+
+        if(carry == NULL)
+            return msg_out_of_memory("INI file line buffer");
+
+        parser->carry = carry;
+        parser->carry_capacity = capacity;
+    }
+
+    memcpy(parser->carry + parser->carry_size, data, size);
+    parser->carry_size += size;
+
+    return 0;
+}
+
+static int push_parser_fail(struct inifile_push_parser *parser)
+{
+    end_parser_index(parser->inifile);
+    inifile_free(parser->inifile);
+    parser->inifile = NULL;
+
+    return -1;
+}
+
+int inifile_push_parser_init(struct inifile_push_parser *parser,
+                             struct ini_file *inifile, const char *source,
+                             const struct inifile_parse_options *options)
+{
+    msg_log_assert(parser != NULL);
+    msg_log_assert(inifile != NULL);
+
+    new_with_options(inifile, options, INIFILE_FLAG_BORROWED);
+
+    parser->inifile = inifile;
+    parser->source = source;
+    parser->sections = options != NULL ? options->sections : NULL;
+    parser->number_of_sections = options != NULL ? options->number_of_sections : 0;
+    parser->current_section = NULL;
+    parser->line = 1;
+    parser->state = STATE_EXPECT_SECTION_BEGIN;
+    parser->carry = NULL;
+    parser->carry_size = 0;
+    parser->carry_capacity = 0;
+
+    /* total size is unknown, so we assume a large input */
+    if(create_storage(inifile, 0) < 0 ||
+       begin_parser_index(inifile, PARSER_INDEX_MIN_SIZE) < 0)
+    {
+        push_parser_fail(parser);
+        return -1;
+    }
+
+    return 0;
+}
+
+int inifile_push_parser_feed(struct inifile_push_parser *parser,
+                             const char *chunk, size_t size)
+{
+    msg_log_assert(parser != NULL);
+    msg_log_assert(chunk != NULL || size == 0);
+
+    if(parser->inifile == NULL)
+        return -1;
+
+    if(parser->carry_size > 0)
+    {
+        /* complete the line carried over from previous chunks */
+        const char *eol = memchr(chunk, '\n', size);
+
+        if(eol == NULL)
+            return push_parser_carry(parser, chunk, size) == 0
+                ? 0
+                : push_parser_fail(parser);
+
+        const size_t length = (size_t)(eol - chunk) + 1;
+
+        if(push_parser_carry(parser, chunk, length) < 0 ||
+           push_parser_parse(parser, parser->carry, parser->carry_size) < 0)
+            return push_parser_fail(parser);
+
+        parser->carry_size = 0;
+        chunk += length;
+        size -= length;
+    }
+
+    /* parse all complete lines directly from the chunk */
+    const char *last_eol = size > 0 ? memrchr(chunk, '\n', size) : NULL;
+
+    if(last_eol != NULL)
+    {
+        const size_t length = (size_t)(last_eol - chunk) + 1;
+
+        if(push_parser_parse(parser, chunk, length) < 0)
+            return push_parser_fail(parser);
+
+        chunk += length;
+        size -= length;
+    }
+
+    if(push_parser_carry(parser, chunk, size) < 0)
+        return push_parser_fail(parser);
+
+    return 0;
+}
+
+int inifile_push_parser_finish(struct inifile_push_parser *parser)
+{
+    msg_log_assert(parser != NULL);
+
+    int ret = -1;
+
+    if(parser->inifile != NULL)
+    {
+        if(parser->carry_size > 0 &&
+           push_parser_parse(parser, parser->carry, parser->carry_size) < 0)
+            push_parser_fail(parser);
+        else
+        {
+            end_parser_index(parser->inifile);
+            end_parser_compact(parser->inifile);
+            parser->inifile = NULL;
+            ret = 0;
+        }
+    }
+
+    free(parser->carry);
+    parser->carry = NULL;
+    parser->carry_size = 0;
+    parser->carry_capacity = 0;
+
+    return ret;
+}
+
+static void *plain_malloc(size_t size)
+{
+    void *ptr = malloc(size);
+
+    if(ptr == NULL)
+        msg_error(errno, LOG_ERR, "malloc() failed for %zu bytes", size);
+
+    return ptr;
+}
+
+static bool is_using_arena(const struct inifile_storage *storage)
+{
+    return storage != NULL && (storage->flags & INIFILE_FLAG_ARENA) != 0;
+}
+
+/*!
+ * Allocate memory from arena.
+ *
+ * Objects which do not fit into the current block are either placed into a
+ * new block which then becomes current, or, if they are large, into a
+ * dedicated block which is put behind the current block so that the space
+ * left in the current block is not wasted.
+ */
+static void *arena_alloc(struct inifile_storage *storage, size_t size,
+                         size_t alignment)
+{
+    struct arena_block *block = storage->blocks;
+
+    if(block != NULL)
+    {
+        const size_t offset = (block->used + alignment - 1) & ~(alignment - 1);
+
+        if(offset <= block->size && block->size - offset >= size)
+        {
+            block->used = offset + size;
+            return (char *)block->data + offset;
+        }
+    }
+
+    const bool is_large = size > storage->next_block_size / 4;
+    const size_t block_size = is_large ? size : storage->next_block_size;
+
+    struct arena_block *new_block =
+        plain_malloc(sizeof(*new_block) + block_size);
+
+    if(new_block == NULL)
+        return NULL;
+
+    new_block->size = block_size;
+    new_block->used = size;
+
+    if(is_large && block != NULL)
+    {
+        new_block->next = block->next;
+        block->next = new_block;
+    }
+    else
+    {
+        new_block->next = block;
+        storage->blocks = new_block;
+
+        storage->next_block_size *= 2;
+
+        if(storage->next_block_size > ARENA_MAX_BLOCK_SIZE)
+            storage->next_block_size = ARENA_MAX_BLOCK_SIZE;
+    }
+
+    return new_block->data;
+}
+
+static void arena_free_all(struct inifile_storage *storage)
+{
+    struct arena_block *block = storage->blocks;
+
+    while(block != NULL)
+    {
+        struct arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    storage->blocks = NULL;
+}
+
+static int allocate_storage(struct ini_file *inifile, size_t size_hint)
+{
+    struct inifile_storage *storage = plain_malloc(sizeof(*storage));
+
+    if(storage == NULL)
+        return -1;
+
+    storage->flags = inifile->flags;
+    storage->blocks = NULL;
+    inifile_index_init(&storage->sections_index);
+    storage->mapped.fd = -1;
+    storage->borrowed_content = NULL;
+    storage->borrowed_size = 0;
+    storage->string_pool = inifile->string_pool;
+
+    /* the parsed structure takes a bit more space than the text because of
+     * the nodes and zero-terminators */
+    size_hint += size_hint / 2;
+    storage->next_block_size =
+        size_hint < ARENA_MIN_BLOCK_SIZE
+        ? ARENA_MIN_BLOCK_SIZE
+        : (size_hint > ARENA_MAX_BLOCK_SIZE ? ARENA_MAX_BLOCK_SIZE : size_hint);
+
+    inifile->storage = storage;
+
+    return 0;
+}
+
+/*!
+ * Allocate storage structure for INI file, if the file's flags require one.
+ *
+ * \param inifile
+ *     The INI file which needs a storage structure.
+ *
+ * \param size_hint
+ *     Expected size of the data to be stored in the INI file, or 0 if
+ *     unknown. Used for choosing the size of the first arena block.
+ */
+static int create_storage(struct ini_file *inifile, size_t size_hint)
+{
+    if(inifile->storage != NULL ||
+       (inifile->flags == INIFILE_FLAG_NONE && inifile->string_pool == NULL))
+        return 0;
+
+    return allocate_storage(inifile, size_hint);
+}
+
+static void free_storage(struct ini_file *inifile)
+{
+    if(inifile->storage == NULL)
+        return;
+
+    if(!is_using_arena(inifile->storage) ||
+       (inifile->storage->flags & STORAGE_FLAG_PARSER_INDEX) != 0)
+        free(inifile->storage->sections_index.slots);
+
+    if(inifile->storage->mapped.fd >= 0)
+        os_unmap_file(&inifile->storage->mapped);
+
+    arena_free_all(inifile->storage);
+    free(inifile->storage);
+    inifile->storage = NULL;
+}
+
+static void *parser_malloc(struct inifile_storage *storage, size_t size)
+{
+    if(is_using_arena(storage))
+        return arena_alloc(storage, size, _Alignof(max_align_t));
+    else
+        return plain_malloc(size);
+}
+
+static void parser_free(struct inifile_storage *storage, void *ptr)
+{
+    if(ptr != NULL && !is_using_arena(storage))
+        free(ptr);
+}
+
+static char *parser_strdup(struct inifile_storage *storage,
+                           const char *string, size_t size)
+{
+    if(storage != NULL && (storage->flags & STORAGE_FLAG_BORROW_STRINGS) != 0)
+        return (char *)(uintptr_t)string;
+
+    char *cp = is_using_arena(storage)
+        ? arena_alloc(storage, size + 1, 1)
+        : plain_malloc(size + 1);
+
+    if(cp == NULL)
+        return NULL;
+
+    memcpy(cp, string, size);
+    cp[size] = '\0';
+
+    return cp;
+}
+
+/*!
+ * Copy section name or key, or take it from the string pool.
+ */
+static char *parser_strdup_name(struct inifile_storage *storage,
+                                const char *string, size_t size)
+{
+    if(storage == NULL || storage->string_pool == NULL)
+        return parser_strdup(storage, string, size);
+
+    return (char *)(uintptr_t)inifile_string_pool_intern(storage->string_pool,
+                                                         string, size);
+}
+
+static void parser_free_name(struct inifile_storage *storage, char *name)
+{
+    if(storage == NULL || storage->string_pool == NULL)
+        parser_free(storage, name);
+}
+
+static bool is_indexed(const struct inifile_storage *storage)
+{
+    return storage != NULL && (storage->flags & INIFILE_FLAG_INDEX) != 0;
+}
+
+static void *index_malloc(struct inifile_storage *storage, size_t size)
+{
+    if((storage->flags & STORAGE_FLAG_PARSER_INDEX) != 0)
+        return plain_malloc(size);
+    else
+        return parser_malloc(storage, size);
+}
+
+static void index_free(struct inifile_storage *storage, void *ptr)
+{
+    if((storage->flags & STORAGE_FLAG_PARSER_INDEX) != 0)
+        free(ptr);
+    else
+        parser_free(storage, ptr);
+}
+
+/*!
+ * Make sure there is room for one more item in given index.
+ *
+ * Slots are allocated from the storage so that they end up in the arena if
+ * the INI file uses one.
+ */
+static int index_make_room(struct inifile_storage *storage,
+                           struct inifile_index *index)
+{
+    const size_t capacity = inifile_index_required_capacity(index, 1);
+
+    if(capacity == 0)
+        return 0;
+
+    struct inifile_index_slot *slots =
+        index_malloc(storage, inifile_index_slots_size(capacity));
+
+    if(slots == NULL)
+        return -1;
+
+    index_free(storage, inifile_index_rehash(index, slots, capacity));
+
+    return 0;
+}
+
+static int index_add_section(struct inifile_storage *storage,
+                             struct ini_section *section)
+{
+    if(index_make_room(storage, &storage->sections_index) < 0)
+        return -1;
+
+    inifile_index_insert(&storage->sections_index,
+                         inifile_hash(section->name, section->name_length),
+                         section);
+
+    return 0;
+}
+
+static int index_add_kv_pair(struct ini_section *section,
+                             struct ini_key_value_pair *kv)
+{
+    if(index_make_room(section->storage, section->values_index) < 0)
+        return -1;
+
+    inifile_index_insert(section->values_index,
+                         inifile_hash(kv->key, kv->key_length), kv);
+
+    return 0;
+}
+
+static int create_values_index(struct ini_section *section)
+{
+    section->values_index =
+        index_malloc(section->storage, sizeof(*section->values_index));
+
+    if(section->values_index == NULL)
+        return -1;
+
+    inifile_index_init(section->values_index);
+
+    for(struct ini_key_value_pair *kv = section->values_head; kv != NULL; kv = kv->next)
+    {
+        if(index_add_kv_pair(section, kv) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static void free_values_index(struct ini_section *section)
+{
+    if(section->values_index == NULL)
+        return;
+
+    index_free(section->storage, section->values_index->slots);
+    index_free(section->storage, section->values_index);
+    section->values_index = NULL;
+}
+
+static struct ini_section *lookup_section_in_index(const struct inifile_index *index,
+                                                   const char *name,
+                                                   size_t length)
+{
+    const uint32_t hash = inifile_hash(name, length);
+    size_t cursor;
+
+    for(struct ini_section *s = inifile_index_find_first(index, hash, &cursor);
+        s != NULL;
+        s = inifile_index_find_next(index, hash, &cursor))
+    {
+        if(s->name_length == length &&
+           (s->name == name || memcmp(s->name, name, length) == 0))
+            return s;
+    }
+
+    return NULL;
+}
+
+static struct ini_key_value_pair *
+lookup_kv_pair_in_index(const struct inifile_index *index,
+                        const char *key, size_t key_length)
+{
+    const uint32_t hash = inifile_hash(key, key_length);
+    size_t cursor;
+
+    for(struct ini_key_value_pair *kv = inifile_index_find_first(index, hash, &cursor);
+        kv != NULL;
+        kv = inifile_index_find_next(index, hash, &cursor))
+    {
+        if(kv->key_length == key_length &&
+           (kv->key == key || memcmp(kv->key, key, key_length) == 0))
+            return kv;
+    }
+
+    return NULL;
+}
+
+static void drop_index(struct ini_file *inifile)
+{
+    struct inifile_storage *storage = inifile->storage;
+
+    for(struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
+        free_values_index(s);
+
+    index_free(storage, storage->sections_index.slots);
+    inifile_index_init(&storage->sections_index);
+
+    storage->flags &= ~(unsigned int)INIFILE_FLAG_INDEX;
+    inifile->flags &= ~(unsigned int)INIFILE_FLAG_INDEX;
+}
+
+/*!
+ * Set up temporary indices for parsing large inputs.
+ *
+ * Without indices, each key read from the input would have to be compared
+ * against all keys already stored in its section to detect duplicates,
+ * rendering parsing quadratic in the number of keys per section. Same for
+ * section names.
+ *
+ * Nothing is done if the caller has requested an index anyway.
+ */
+static int begin_parser_index(struct ini_file *inifile, size_t size)
+{
+    if((inifile->flags & INIFILE_FLAG_INDEX) != 0 || size < PARSER_INDEX_MIN_SIZE)
+        return 0;
+
+    if(inifile->storage == NULL && allocate_storage(inifile, size) < 0)
+        return -1;
+
+    inifile->storage->flags |= INIFILE_FLAG_INDEX | STORAGE_FLAG_PARSER_INDEX;
+
+    return 0;
+}
+
+/*!
+ * Remove indices set up by #begin_parser_index().
+ *
+ * The storage structure is freed as well if it was allocated only for the
+ * indices so that the INI file looks exactly as if it had been parsed
+ * without them.
+ */
+static void end_parser_index(struct ini_file *inifile)
+{
+    struct inifile_storage *storage = inifile->storage;
+
+    if(storage == NULL || (storage->flags & STORAGE_FLAG_PARSER_INDEX) == 0)
+        return;
+
+    drop_index(inifile);
+    storage->flags &= ~STORAGE_FLAG_PARSER_INDEX;
+
+    if(storage->flags != INIFILE_FLAG_NONE || storage->string_pool != NULL)
+        return;
+
+    for(struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
+        s->storage = NULL;
+
+    free_storage(inifile);
+}
+
+int inifile_build_index(struct ini_file *inifile)
+{
+    msg_log_assert(inifile != NULL);
+
+    if(is_indexed(inifile->storage))
+        return 0;
+
+    inifile->flags |= INIFILE_FLAG_INDEX;
+
+    if(create_storage(inifile, 0) < 0)
+    {
+        inifile->flags &= ~(unsigned int)INIFILE_FLAG_INDEX;
+        return -1;
+    }
+
+    struct inifile_storage *storage = inifile->storage;
+
+    storage->flags |= INIFILE_FLAG_INDEX;
+
+    for(struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
+    {
+        /* sections may have been created before the storage existed */
+        s->storage = storage;
+        s->values_index = NULL;
+    }
+
+    for(struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
+    {
+        if(index_add_section(storage, s) < 0 || create_values_index(s) < 0)
+        {
+            drop_index(inifile);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static inline const char *
+compact_strings(const struct inifile_compact_values *compact)
+{
+    return (const char *)&compact->entries[compact->number_of_entries];
+}
+
+static size_t compact_values_size(const struct inifile_compact_values *compact)
+{
+    return sizeof(*compact) +
+           compact->number_of_entries * sizeof(compact->entries[0]) +
+           compact->strings_size;
+}
+
+static int create_compact_values(struct ini_section *section)
+{
+    size_t number_of_entries = 0;
+    size_t strings_size = 0;
+
+    for(const struct ini_key_value_pair *kv = section->values_head; kv != NULL; kv = kv->next)
+    {
+        ++number_of_entries;
+        strings_size += kv->key_length + 1 + kv->value_length + 1;
+    }
+
+    /* too large for 32 bit offsets, keep using the linked list; all offsets
+     * and lengths narrowed to 32 bits below rely on this check */
+    if(strings_size > UINT32_MAX)
+        return 0;
+
+    struct inifile_compact_values *compact =
+        parser_malloc(section->storage,
+                      sizeof(*compact) +
+                      number_of_entries * sizeof(compact->entries[0]) +
+                      strings_size);
+
+    if(compact == NULL)
+        return -1;
+
+    compact->number_of_entries = number_of_entries;
+    compact->strings_size = strings_size;
+
+    char *strings = (char *)&compact->entries[number_of_entries];
+    uint32_t offset = 0;
+    struct compact_entry *entry = compact->entries;
+
+    for(const struct ini_key_value_pair *kv = section->values_head; kv != NULL; kv = kv->next)
+    {
+        entry->key_offset = offset;
+        entry->key_length = (uint32_t)kv->key_length;
+        memcpy(&strings[offset], kv->key, kv->key_length);
+        offset += entry->key_length;
+        strings[offset++] = '\0';
+
+        entry->value_offset = offset;
+        entry->value_length = (uint32_t)kv->value_length;
+        memcpy(&strings[offset], kv->value, kv->value_length);
+        offset += entry->value_length;
+        strings[offset++] = '\0';
+
+        ++entry;
+    }
+
+    section->values_compact = compact;
+
+    return 0;
+}
+
+static void drop_compact_values(struct ini_section *section)
+{
+    if(section->values_compact == NULL)
+        return;
+
+    parser_free(section->storage, section->values_compact);
+    section->values_compact = NULL;
+}
+
+int inifile_compact(struct ini_file *inifile)
+{
+    msg_log_assert(inifile != NULL);
+
+    inifile->flags |= INIFILE_FLAG_COMPACT;
+
+    if(create_storage(inifile, 0) < 0)
+        return -1;
+
+    struct inifile_storage *storage = inifile->storage;
+
+    storage->flags |= INIFILE_FLAG_COMPACT;
+
+    int ret = 0;
+
+    for(struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
+    {
+        /* sections may have been created before the storage existed */
+        s->storage = storage;
+
+        if(s->values_compact == NULL && create_compact_values(s) < 0)
+            ret = -1;
+    }
+
+    return ret;
+}
+
+/*!
+ * Create compact copies after parsing if requested by the caller.
+ *
+ * Failure is not fatal since iteration falls back to the linked lists.
+ */
+static void end_parser_compact(struct ini_file *inifile)
+{
+    if((inifile->flags & INIFILE_FLAG_COMPACT) != 0)
+        (void)inifile_compact(inifile);
+}
+
+struct ini_section *inifile_new_section(struct ini_file *inifile,
+                                        const char *name, size_t length)
+{
+    if(length == 0)
+        length = strlen(name);
+
+    if(length == 0)
+        return NULL;
+
+    struct ini_section *section = inifile_find_section(inifile, name, length);
+    if(section != NULL)
+        return section;
+
+    if(create_storage(inifile, 0) < 0)
+        return NULL;
+
+    section = parser_malloc(inifile->storage, sizeof(*section));
+
+    if(section == NULL)
+        return NULL;
+
+    section->next = NULL;
+    section->prev = NULL;
+    section->values_head = NULL;
+    section->values_tail = NULL;
+    section->name_length = length;
+    section->name = parser_strdup_name(inifile->storage, name, length);
+    section->storage = inifile->storage;
+    section->values_index = NULL;
+    section->values_compact = NULL;
+
+    if(section->name == NULL)
+    {
+        parser_free(inifile->storage, section);
+        return NULL;
+    }
+
+    if(is_indexed(inifile->storage) &&
+       (create_values_index(section) < 0 ||
+        index_add_section(inifile->storage, section) < 0))
+    {
+        free_values_index(section);
+        parser_free_name(inifile->storage, section->name);
+        parser_free(inifile->storage, section);
+        return NULL;
+    }
+
+    if(inifile->sections_head == NULL)
+        inifile->sections_head = section;
+    else
+    {
+        msg_log_assert(inifile->sections_tail != NULL);
+        section->prev = inifile->sections_tail;
+        inifile->sections_tail->next = section;
+    }
+
+    inifile->sections_tail = section;
+
+    return section;
+}
+
+static struct ini_section *find_section_by_pointer(const struct ini_file *inifile,
+                                                   const struct ini_section *section)
+{
+    for(struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
+    {
+        if(s == section)
+            return s;
+    }
+
+    return NULL;
+}
+
+static struct ini_section *find_section_by_name(const struct ini_file *inifile,
+                                                const char *section_name,
+                                                size_t section_name_length)
+{
+    if(section_name_length == 0)
+        section_name_length = strlen(section_name);
+
+    if(is_indexed(inifile->storage))
+        return lookup_section_in_index(&inifile->storage->sections_index,
+                                       section_name, section_name_length);
+
+    for(struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
+    {
+        if(s->name_length == section_name_length &&
+           (s->name == section_name ||
+            memcmp(s->name, section_name, section_name_length) == 0))
+            return s;
+    }
+
+    return NULL;
+}
+
+static void free_kv_pair(struct inifile_storage *storage,
+                         struct ini_key_value_pair *kv)
+{
+    if(is_using_arena(storage))
+        return;
+
+    parser_free_name(storage, kv->key);
+    parser_free(storage, kv->value);
+    parser_free(storage, kv);
+}
+
+static void free_section(struct ini_section *section)
+{
+    if(is_using_arena(section->storage))
+        return;
+
+    struct ini_key_value_pair *kv = section->values_head;
+
+    if(kv != NULL)
+    {
+        for(struct ini_key_value_pair *next_kv = kv->next; kv != NULL; kv = next_kv)
+        {
+            next_kv = kv->next;
+            free_kv_pair(section->storage, kv);
+        }
+    }
+
+    free_values_index(section);
+    drop_compact_values(section);
+    parser_free_name(section->storage, section->name);
+    parser_free(section->storage, section);
+}
+
+static void remove_section(struct ini_file *inifile,
+                           struct ini_section *section)
+{
+    if(section->prev != NULL)
+    {
+        msg_log_assert(section == section->prev->next);
+        section->prev->next = section->next;
+    }
+    else
+    {
+        msg_log_assert(section == inifile->sections_head);
+        inifile->sections_head = section->next;
+    }
+
+    if(section->next != NULL)
+    {
+        msg_log_assert(section == section->next->prev);
+        section->next->prev = section->prev;
+    }
+    else
+    {
+        msg_log_assert(section == inifile->sections_tail);
+        inifile->sections_tail = section->prev;
+    }
+
+    if(is_indexed(inifile->storage))
+        inifile_index_remove(&inifile->storage->sections_index,
+                             inifile_hash(section->name, section->name_length),
+                             section);
+
+    free_section(section);
+}
+
+bool inifile_remove_section(struct ini_file *inifile,
+                            const struct ini_section *section)
+{
+    msg_log_assert(inifile != NULL);
+
+    if(section == NULL)
+        return false;
+
+    struct ini_section *s = find_section_by_pointer(inifile, section);
+
+    if(s == NULL)
+        return false;
+
+    remove_section(inifile, s);
+
+    return true;
+}
+
+void inifile_remove_section_unchecked(struct ini_file *inifile,
+                                      struct ini_section *section)
+{
+    msg_log_assert(inifile != NULL);
+    msg_log_assert(section != NULL);
+    msg_log_assert(section->storage == inifile->storage);
+
+    remove_section(inifile, section);
+}
+
+bool inifile_remove_section_by_name(struct ini_file *inifile,
+                                    const char *section_name,
+                                    size_t section_name_length)
+{
+    msg_log_assert(inifile != NULL);
+    msg_log_assert(section_name != NULL);
+
+    struct ini_section *s = find_section_by_name(inifile, section_name,
+                                                 section_name_length);
+
+    if(s == NULL)
+        return false;
+
+    remove_section(inifile, s);
+
+    return true;
+}
+
+size_t inifile_remove_sections_if(struct ini_file *inifile,
+                                  inifile_section_predicate_fn predicate,
+                                  void *user_data)
+{
+    msg_log_assert(inifile != NULL);
+    msg_log_assert(predicate != NULL);
+
+    size_t count = 0;
+    struct ini_section *s = inifile->sections_head;
+
+    while(s != NULL)
+    {
+        struct ini_section *next = s->next;
+
+        if(predicate(s, user_data))
+        {
+            remove_section(inifile, s);
+            ++count;
+        }
+
+        s = next;
+    }
+
+    return count;
+}
+
+struct ini_section *inifile_find_section(const struct ini_file *inifile,
+                                         const char *section_name,
+                                         size_t section_name_length)
+{
+    msg_log_assert(inifile != NULL);
+    msg_log_assert(section_name != NULL);
+
+    return find_section_by_name(inifile, section_name, section_name_length);
+}
+
+/*! Inputs smaller than this per thread are parsed by fewer threads. */
+#define PARALLEL_PARSE_MIN_CHUNK_SIZE   ((size_t)64 * 1024)
+
+#define PARALLEL_PARSE_MAX_THREADS      32U
+
+/*!
+ * Part of the input parsed by one thread.
+ */
+struct parse_job
+{
+    struct ini_file inifile;
+    const char *source;
+    const char *content;
+    size_t size;
+    size_t first_line;
+    const struct inifile_parse_options *options;
+    int result;
+    pthread_t thread;
+    bool is_thread_started;
+
+    /*!
+     * Copy of the caller's options with a private string pool.
+     *
+     * Only used if the caller has passed a string pool. Names are interned
+     * into the private pool without contention on the lock of the caller's
+     * pool, and moved over to the caller's pool while merging.
+     */
+    struct inifile_parse_options options_with_private_pool;
+    struct inifile_string_pool private_pool;
+};
+
+static void *parse_job_main(void *arg)
+{
+    struct parse_job *job = arg;
+
+    job->result = parse_tree(&job->inifile, job->source,
+                             job->content, job->size, job->options,
+                             job->first_line);
+
+    return NULL;
+}
+
+/*!
+ * Find first line beginning with '[' at or after given position.
+ *
+ * Such a line always begins a new section, whatever the state of the parser
+ * at the end of the preceding line, so the input can be split there.
+ *
+ * \returns
+ *     Position of the '[' character, or \p size if there is no such line.
+ */
+static size_t find_section_line(const char *content, size_t size, size_t pos)
+{
+    if(pos == 0)
+        return 0;
+
+    --pos;
+
+    while(pos + 1 < size)
+    {
+        const char *eol = memchr(content + pos, '\n', size - 1 - pos);
+
+        if(eol == NULL)
+            break;
+
+        pos = (size_t)(eol - content) + 1;
+
+        if(content[pos] == '[')
+            return pos;
+    }
+
+    return size;
+}
+
+static size_t count_lines(const char *content, size_t size)
+{
+    size_t count = 0;
+    const char *end = content + size;
+
+    while((content = memchr(content, '\n', (size_t)(end - content))) != NULL)
+    {
+        ++count;
+        ++content;
+    }
+
+    return count;
+}
+
+/*!
+ * Split input at section boundaries into roughly equal parts.
+ *
+ * \returns
+ *     Number of jobs set up, at most \p max_jobs.
+ */
+static size_t split_input(struct parse_job *jobs, size_t max_jobs,
+                          const char *source, const char *content, size_t size,
+                          const struct inifile_parse_options *options)
+{
+    size_t count = 0;
+    size_t start = 0;
+    size_t line = 1;
+
+    while(start < size && count < max_jobs)
+    {
+        const size_t target = size / max_jobs * (count + 1);
+        size_t end = count + 1 < max_jobs
+            ? find_section_line(content, size, target > start ? target : start + 1)
+            : size;
+
+        struct parse_job *job = &jobs[count++];
+
+        job->source = source;
+        job->content = content + start;
+        job->size = end - start;
+        job->first_line = line;
+        job->options = options;
+        job->result = -1;
+        job->is_thread_started = false;
+
+        if(end < size)
+            line += count_lines(job->content, job->size);
+
+        start = end;
+    }
+
+    return count;
+}
+
+/*!
+ * Move arena blocks of one storage to another.
+ *
+ * The block with free space remains at the head of \p to.
+ */
+static void move_arena_blocks(struct inifile_storage *to,
+                              struct inifile_storage *from)
+{
+    struct arena_block *head = from->blocks;
+
+    if(head == NULL)
+        return;
+
+    struct arena_block *tail = head;
+
+    while(tail->next != NULL)
+        tail = tail->next;
+
+    if(to->blocks == NULL)
+        to->blocks = head;
+    else
+    {
+        tail->next = to->blocks->next;
+        to->blocks->next = head;
+    }
+
+    from->blocks = NULL;
+}
+
+static void append_section(struct ini_file *inifile, struct ini_section *section)
+{
+    section->next = NULL;
+    section->prev = inifile->sections_tail;
+    section->storage = inifile->storage;
+
+    if(inifile->sections_head == NULL)
+        inifile->sections_head = section;
+    else
+        inifile->sections_tail->next = section;
+
+    inifile->sections_tail = section;
+}
+
+/*!
+ * Merge values of a duplicate section into the first section of that name.
+ *
+ * Values replace values with the same key, other values are appended, just
+ * as if they had been stored by #inifile_section_store_value(). The emptied
+ * \p src is freed.
+ */
+static int merge_section_values(struct ini_section *dst, struct ini_section *src)
+{
+    if(dst->values_index == NULL && is_indexed(dst->storage) &&
+       create_values_index(dst) < 0)
+        return -1;
+
+    drop_compact_values(dst);
+
+    while(src->values_head != NULL)
+    {
+        struct ini_key_value_pair *kv = src->values_head;
+        struct ini_key_value_pair *existing =
+            inifile_section_lookup_kv_pair(dst, kv->key, kv->key_length);
+
+        if(existing != NULL)
+        {
+            src->values_head = kv->next;
+            parser_free(dst->storage, existing->value);
+            existing->value_length = kv->value_length;
+            existing->value = kv->value;
+            parser_free_name(src->storage, kv->key);
+            parser_free(src->storage, kv);
+            continue;
+        }
+
+        if(dst->values_index != NULL && index_add_kv_pair(dst, kv) < 0)
+            return -1;
+
+        src->values_head = kv->next;
+        kv->next = NULL;
+        kv->prev = dst->values_tail;
+
+        if(dst->values_head == NULL)
+            dst->values_head = kv;
+        else
+            dst->values_tail->next = kv;
+
+        dst->values_tail = kv;
+    }
+
+    free_values_index(src);
+    drop_compact_values(src);
+    parser_free_name(src->storage, src->name);
+    parser_free(src->storage, src);
+
+    return 0;
+}
+
+/*!
+ * Replace names from a job's private string pool by names from \p pool.
+ */
+static int move_names_to_pool(struct ini_file *part,
+                              struct inifile_string_pool *pool)
+{
+    for(struct ini_section *s = part->sections_head; s != NULL; s = s->next)
+    {
+        const char *name =
+            inifile_string_pool_intern(pool, s->name, s->name_length);
+
+        if(name == NULL)
+            return -1;
+
+        s->name = (char *)(uintptr_t)name;
+
+        for(struct ini_key_value_pair *kv = s->values_head; kv != NULL; kv = kv->next)
+        {
+            name = inifile_string_pool_intern(pool, kv->key, kv->key_length);
+
+            if(name == NULL)
+                return -1;
+
+            kv->key = (char *)(uintptr_t)name;
+        }
+    }
+
+    return 0;
+}
+
+/*!
+ * Move sections parsed by a job to the final structure.
+ *
+ * In case of error, all sections are still moved so that they are freed
+ * along with \p inifile, but the structure is not usable anymore.
+ */
+static int merge_parsed_part(struct ini_file *inifile, struct ini_file *part)
+{
+    struct inifile_storage *part_storage = part->storage;
+
+    if(part_storage != NULL)
+        move_arena_blocks(inifile->storage, part_storage);
+
+    int ret = 0;
+
+    if(part_storage != NULL &&
+       part_storage->string_pool != inifile->storage->string_pool &&
+       move_names_to_pool(part, inifile->storage->string_pool) < 0)
+        ret = -1;
+    struct ini_section *s = part->sections_head;
+
+    while(s != NULL)
+    {
+        struct ini_section *next = s->next;
+
+        struct ini_section *dst =
+            ret == 0
+            ? find_section_by_name(inifile, s->name, s->name_length)
+            : NULL;
+
+        if(dst != NULL)
+        {
+            if(merge_section_values(dst, s) < 0)
+            {
+                ret = -1;
+                append_section(inifile, s);
+            }
+        }
+        else
+        {
+            append_section(inifile, s);
+
+            if(ret == 0 && is_indexed(inifile->storage) &&
+               index_add_section(inifile->storage, s) < 0)
+                ret = -1;
+        }
+
+        s = next;
+    }
+
+    part->sections_head = NULL;
+    part->sections_tail = NULL;
+
+    if(part_storage != NULL)
+    {
+        /* the part has no parser index anymore, and an index requested by
+         * the caller has been replaced by the index of the final structure */
+        if(!is_using_arena(part_storage))
+            free(part_storage->sections_index.slots);
+
+        free(part_storage);
+        part->storage = NULL;
+    }
+
+    return ret;
+}
+
+int inifile_parse_from_memory_parallel(struct ini_file *inifile,
+                                       const char *source,
+                                       const char *content, size_t size,
+                                       const struct inifile_parse_options *options,
+                                       unsigned int number_of_threads)
+{
+    msg_log_assert(inifile != NULL);
+    msg_log_assert(content != NULL);
+
+    if(number_of_threads == 0)
+    {
+        const long online = sysconf(_SC_NPROCESSORS_ONLN);
+        number_of_threads = online > 0 ? (unsigned int)online : 1;
+    }
+
+    if(number_of_threads > PARALLEL_PARSE_MAX_THREADS)
+        number_of_threads = PARALLEL_PARSE_MAX_THREADS;
+
+    const size_t max_threads_for_size = size / PARALLEL_PARSE_MIN_CHUNK_SIZE;
+
+    if(number_of_threads > max_threads_for_size)
+        number_of_threads = (unsigned int)max_threads_for_size;
+
+    if(number_of_threads <= 1)
+        return parse_tree(inifile, source, content, size, options, 1);
+
+    struct parse_job jobs[PARALLEL_PARSE_MAX_THREADS];
+    const size_t number_of_jobs =
+        split_input(jobs, number_of_threads, source, content, size, options);
+    const bool have_private_pools = options != NULL && options->string_pool != NULL;
+
+    if(have_private_pools)
+    {
+        for(size_t i = 0; i < number_of_jobs; ++i)
+        {
+            inifile_string_pool_init(&jobs[i].private_pool);
+            jobs[i].options_with_private_pool = *options;
+            jobs[i].options_with_private_pool.string_pool = &jobs[i].private_pool;
+            jobs[i].options = &jobs[i].options_with_private_pool;
+        }
+    }
+
+    /* the calling thread parses the first part itself */
+    for(size_t i = 1; i < number_of_jobs; ++i)
+    {
+        if(pthread_create(&jobs[i].thread, NULL, parse_job_main, &jobs[i]) == 0)
+            jobs[i].is_thread_started = true;
+        else
+            parse_job_main(&jobs[i]);
+    }
+
+    parse_job_main(&jobs[0]);
+
+    int ret = 0;
+
+    for(size_t i = 0; i < number_of_jobs; ++i)
+    {
+        if(jobs[i].is_thread_started)
+            pthread_join(jobs[i].thread, NULL);
+
+        if(jobs[i].result < 0)
+            ret = -1;
+    }
+
+    new_with_options(inifile, options, 0);
+
+    if(ret == 0 &&
+       (create_storage(inifile, 0) < 0 || begin_parser_index(inifile, size) < 0))
+        ret = -1;
+
+    for(size_t i = 0; i < number_of_jobs; ++i)
+    {
+        /* structures have been freed already in case of parse errors */
+        if(jobs[i].result < 0)
+            continue;
+
+        if(ret < 0)
+            inifile_free(&jobs[i].inifile);
+        else if(merge_parsed_part(inifile, &jobs[i].inifile) < 0)
+            ret = -1;
+    }
+
+    end_parser_index(inifile);
+
+    if(ret < 0)
+        inifile_free(inifile);
+
+    /* names have been moved to the caller's pool, or the structures using
+     * them have been freed */
+    if(have_private_pools)
+    {
+        for(size_t i = 0; i < number_of_jobs; ++i)
+            inifile_string_pool_free(&jobs[i].private_pool);
+    }
+
+    if(ret < 0)
+        return -1;
+
+    if((inifile->flags & INIFILE_FLAG_BORROWED) != 0)
+    {
+        inifile->storage->borrowed_content = content;
+        inifile->storage->borrowed_size = size;
+    }
+
+    /* copies of merged duplicate sections have been dropped */
+    end_parser_compact(inifile);
+
+    return 0;
+}
+
+/*!
+ * Output buffer for #inifile_write_to_file().
+ *
+ * The serialized file is collected in this buffer so that only a few large
+ * write operations hit the file system instead of four tiny ones per
+ * key/value pair.
+ */
+struct write_buffer
+{
+    int fd;
+
+    /*! Collects the output instead of \c fd if not \c NULL. */
+    struct memory_output *memory;
+
+    size_t used;
+    char data[4096];
+};
+
+/*!
+ * Growing memory block for serialized INI files.
+ */
+struct memory_output
+{
+    char *data;
+    size_t size;
+    size_t capacity;
+};
+
+static void init_write_buffer(struct write_buffer *wb, int fd,
+                              struct memory_output *memory)
+{
+    wb->fd = fd;
+    wb->memory = memory;
+    wb->used = 0;
+}
+
+static int append_to_memory_output(struct memory_output *memory,
+                                   const char *src, size_t count)
+{
+    if(count > memory->capacity - memory->size)
+    {
+        size_t capacity = memory->capacity > 0 ? memory->capacity : 4096;
+
+        while(capacity - memory->size < count)
+            capacity *= 2;
+
+        char *data = realloc(memory->data, capacity);
+
+        if(data == NULL)
+            return msg_out_of_memory("INI file output");
+
+        memory->data = data;
+        memory->capacity = capacity;
+    }
+
+    memcpy(memory->data + memory->size, src, count);
+    memory->size += count;
+
+    return 0;
+}
+
+static int write_output(struct write_buffer *wb, const char *src, size_t count)
+{
+    if(wb->memory != NULL)
+        return append_to_memory_output(wb->memory, src, count);
+    else
+        return os_write_from_buffer(src, count, wb->fd);
+}
+
+static int flush_write_buffer(struct write_buffer *wb)
+{
+    if(wb->used == 0)
+        return 0;
+
+    const size_t count = wb->used;
+
+    wb->used = 0;
+
+    return write_output(wb, wb->data, count);
+}
+
+static int append_to_write_buffer(struct write_buffer *wb,
+                                  const char *src, size_t count)
+{
+    if(count > sizeof(wb->data) - wb->used)
+    {
+        if(flush_write_buffer(wb) < 0)
+            return -1;
+
+        /* no point in copying huge values around */
+        if(count >= sizeof(wb->data))
+            return write_output(wb, src, count);
+    }
+
+    memcpy(wb->data + wb->used, src, count);
+    wb->used += count;
+
+    return 0;
+}
+
+static int write_section_header(struct write_buffer *wb,
+                                const struct ini_section *section)
+{
+    if(append_to_write_buffer(wb, "[", 1) < 0 ||
+       append_to_write_buffer(wb, section->name, section->name_length) < 0 ||
+       append_to_write_buffer(wb, "]\n", 2) < 0)
+        return -1;
+
+    return 0;
+}
+
+static int write_kv_pair(struct write_buffer *wb,
+                         const struct ini_key_value_pair *kv)
+{
+    if(append_to_write_buffer(wb, kv->key, kv->key_length) < 0 ||
+       append_to_write_buffer(wb, " = ", 3) < 0 ||
+       append_to_write_buffer(wb, kv->value, kv->value_length) < 0 ||
+       append_to_write_buffer(wb, "\n", 1) < 0)
+        return -1;
+
+    return 0;
+}
+
+static int write_section(struct write_buffer *wb,
+                         const struct ini_section *section)
+{
+    if(write_section_header(wb, section) < 0)
+        return -1;
+
+    struct inifile_section_iterator iter;
+    inifile_section_iterator_init(&iter, section);
+
+    for(const struct ini_key_value_pair *kv = inifile_section_iterator_next(&iter);
+        kv != NULL;
+        kv = inifile_section_iterator_next(&iter))
+    {
+        if(write_kv_pair(wb, kv) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/*!
+ * Serialize INI file structure.
+ */
+static int serialize_inifile(struct write_buffer *wb,
+                             const struct ini_file *inifile)
+{
+    for(const struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
+    {
+        if(write_section(wb, s) < 0)
+            return -1;
+    }
+
+    return flush_write_buffer(wb);
+}
+
+/*!
+ * State of writing an INI file by patching the text it was parsed from.
+ */
+struct patch_data
+{
+    const struct ini_file *const inifile;
+    const char *const content;
+    const size_t size;
+    struct write_buffer *const wb;
+
+    /*! Beginning of source text not written or skipped yet. */
+    size_t pos;
+
+    /*! Whether or not the last character written is a newline. */
+    bool is_at_line_start;
+
+    /*! Section the current part of the source belongs to, if any. */
+    const struct ini_section *section;
+
+    /*! Set if the section has been removed from the INI file structure. */
+    bool is_skipping_section;
+
+    /*! Whether or not \c section was parsed from this part of the source. */
+    bool is_owner_of_section;
+};
+
+static bool is_in_patch_source(const struct patch_data *pd, const char *ptr)
+{
+    return (uintptr_t)ptr - (uintptr_t)pd->content < pd->size;
+}
+
+static size_t patch_line_begin(const struct patch_data *pd, const char *ptr)
+{
+    const char *nl = memrchr(pd->content, '\n', (size_t)(ptr - pd->content));
+    return nl != NULL ? (size_t)(nl - pd->content) + 1 : 0;
+}
+
+static size_t patch_line_end(const struct patch_data *pd, const char *ptr)
+{
+    const char *const end = pd->content + pd->size;
+    const char *nl = memchr(ptr, '\n', (size_t)(end - ptr));
+    return nl != NULL ? (size_t)(nl - pd->content) + 1 : pd->size;
+}
+
+static int patch_write(struct patch_data *pd, const char *src, size_t count)
+{
+    if(count == 0)
+        return 0;
+
+    pd->is_at_line_start = src[count - 1] == '\n';
+
+    return append_to_write_buffer(pd->wb, src, count);
+}
+
+/*!
+ * Copy unmodified source text up to given position.
+ */
+static int patch_copy_source(struct patch_data *pd, size_t end)
+{
+    const size_t begin = pd->pos;
+
+    pd->pos = end;
+
+    return patch_write(pd, pd->content + begin, end - begin);
+}
+
+static int patch_begin_new_line(struct patch_data *pd)
+{
+    return pd->is_at_line_start ? 0 : patch_write(pd, "\n", 1);
+}
+
+/*!
+ * Append key/value pairs which have been added to the current section.
+ *
+ * New pairs are written after the last assignment of the section's first
+ * occurrence in the source.
+ */
+static int patch_add_new_values(struct patch_data *pd)
+{
+    if(pd->section == NULL || !pd->is_owner_of_section)
+        return 0;
+
+    for(const struct ini_key_value_pair *kv = pd->section->values_head;
+        kv != NULL;
+        kv = kv->next)
+    {
+        if(is_in_patch_source(pd, kv->key))
+            continue;
+
+        if(patch_begin_new_line(pd) < 0 || write_kv_pair(pd->wb, kv) < 0)
+            return -1;
+
+        pd->is_at_line_start = true;
+    }
+
+    return 0;
+}
+
+/*!
+ * Finish the current part of the source, up to given position.
+ */
+static int patch_end_section(struct patch_data *pd, size_t end)
+{
+    if(patch_add_new_values(pd) < 0)
+        return -1;
+
+    if(pd->is_skipping_section)
+    {
+        pd->pos = end;
+        return 0;
+    }
+
+    return patch_copy_source(pd, end);
+}
+
+static int patch_section_begin(const char *name, size_t name_length,
+                               void *user_data)
+{
+    struct patch_data *pd = user_data;
+    const size_t begin = patch_line_begin(pd, name);
+    const size_t end = patch_line_end(pd, name + name_length);
+
+    if(patch_end_section(pd, begin) < 0)
+        return -1;
+
+    pd->section = inifile_find_section(pd->inifile, name, name_length);
+
+    /* sections removed from the structure are not written, and neither are
+     * sections which have been removed and added again, these are written
+     * like new sections */
+    if(pd->section == NULL || !is_in_patch_source(pd, pd->section->name))
+    {
+        pd->section = NULL;
+        pd->is_skipping_section = true;
+        pd->pos = end;
+        return 0;
+    }
+
+    pd->is_skipping_section = false;
+    pd->is_owner_of_section = pd->section->name == name;
+
+    return patch_copy_source(pd, end);
+}
+
+static int patch_key_value(const char *key, size_t key_length,
+                           const char *value, size_t value_length,
+                           void *user_data)
+{
+    struct patch_data *pd = user_data;
+    const size_t begin = patch_line_begin(pd, key);
+    const size_t end = patch_line_end(pd, key + key_length);
+
+    if(pd->is_skipping_section)
+    {
+        pd->pos = end;
+        return 0;
+    }
+
+    if(patch_copy_source(pd, begin) < 0)
+        return -1;
+
+    const struct ini_key_value_pair *kv =
+        inifile_section_lookup_kv_pair(pd->section, key, key_length);
+
+    if(kv == NULL)
+    {
+        /* removed */
+        pd->pos = end;
+        return 0;
+    }
+
+    if(kv->value == value || (kv->value_length == 0 && value_length == 0))
+    {
+        /* this line defines the current value */
+        return patch_copy_source(pd, end);
+    }
+
+    if(kv->key != key)
+    {
+        /* duplicate assignment of a value defined elsewhere */
+        pd->pos = end;
+        return 0;
+    }
+
+    if(is_in_patch_source(pd, kv->value) ||
+       (kv->value_length == value_length &&
+        memcmp(kv->value, value, value_length) == 0))
+    {
+        /* value defined by a later line, or stored again unchanged */
+        return patch_copy_source(pd, end);
+    }
+
+    pd->pos = end;
+
+    if(write_kv_pair(pd->wb, kv) < 0)
+        return -1;
+
+    pd->is_at_line_start = true;
+
+    return 0;
+}
+
+/*!
+ * Serialize INI file structure by patching the text it was parsed from.
+ */
+static int serialize_changes(struct write_buffer *wb,
+                             const struct ini_file *inifile)
+{
+    const struct inifile_storage *storage = inifile->storage;
+
+    if(storage == NULL || storage->borrowed_content == NULL)
+        return serialize_inifile(wb, inifile);
+
+    struct patch_data pd =
+    {
+        .inifile = inifile,
+        .content = storage->borrowed_content,
+        .size = storage->borrowed_size,
+        .wb = wb,
+        .pos = 0,
+        .is_at_line_start = true,
+    };
+
+    struct parser_data data =
+    {
+        .source = "INI file patch",
+        .content = pd.content,
+        .size = pd.size,
+        .events = &user_events,
+        .section_fn = patch_section_begin,
+        .value_fn = patch_key_value,
+        .user_data = &pd,
+        .pos = 0,
+        .line = 1,
+        .state = STATE_EXPECT_SECTION_BEGIN,
+        .is_quiet = true,
+    };
+
+    if(parse_memory(&data) < 0 || patch_end_section(&pd, pd.size) < 0)
+        return -1;
+
+    for(const struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
+    {
+        if(is_in_patch_source(&pd, s->name))
+            continue;
+
+        if(patch_begin_new_line(&pd) < 0 || write_section(wb, s) < 0)
+            return -1;
+
+        pd.is_at_line_start = true;
+    }
+
+    return flush_write_buffer(wb);
+}
+
+static void delete_incomplete_file(const char *filename)
+{
+    const bool was_suppressed = os_suppress_error_messages(true);
+
+    if(os_file_delete(filename) < 0)
+        msg_error(errno, LOG_ERR, "Failed to delete incomplete file");
+
+    os_suppress_error_messages(was_suppressed);
+}
+
+int inifile_write_to_file(const struct ini_file *inifile,
+                          const char *filename)
+{
+    msg_log_assert(inifile != NULL);
+    msg_log_assert(filename != NULL);
+
+    int fd = os_file_new(filename);
+
+    if(fd < 0)
+        return -1;
+
+    struct write_buffer wb;
+    init_write_buffer(&wb, fd, NULL);
+
+    if(serialize_inifile(&wb, inifile) < 0)
+    {
+        msg_error(0, LOG_ERR,
+                  "Failed writing INI file \"%s\", deleting partially written file",
+                  filename);
+
+        os_file_close(fd);
+        delete_incomplete_file(filename);
+
+        return -1;
+    }
+
+    os_file_close(fd);
+
+    return 0;
+}
+
+#define TEMP_FILE_SUFFIX    ".tmp"
+
+/*!
+ * Write file via temporary file, then rename it.
+ *
+ * The file contents are either produced by \p serialize, or taken from
+ * \p serialized if it is not \c NULL.
+ *
+ * The name of the temporary file is derived from \p filename, so concurrent
+ * writes of the same file must be serialized by the caller.
+ */
+static int write_file_atomically(const struct ini_file *inifile,
+                                 const char *filename,
+                                 int (*serialize)(struct write_buffer *wb,
+                                                  const struct ini_file *inifile),
+                                 const struct memory_output *serialized)
+{
+    const size_t filename_length = strlen(filename);
+    char *temp_name = malloc(filename_length + sizeof(TEMP_FILE_SUFFIX));
+
+    if(temp_name == NULL)
+        return msg_out_of_memory("temporary file name");
+
+    memcpy(temp_name, filename, filename_length);
+    memcpy(temp_name + filename_length, TEMP_FILE_SUFFIX, sizeof(TEMP_FILE_SUFFIX));
+
+    int ret = -1;
+    int fd = os_file_new(temp_name);
+
+    if(fd < 0)
+        goto exit_free;
+
+    struct write_buffer wb;
+    init_write_buffer(&wb, fd, NULL);
+
+    const int write_result =
+        serialized != NULL
+        ? os_write_from_buffer(serialized->data, serialized->size, fd)
+        : serialize(&wb, inifile);
+
+    /* this is where the data hit the storage; the file must not be renamed
+     * unless this has worked */
+    if(write_result < 0 || os_file_sync(fd) < 0)
+    {
+        msg_error(0, LOG_ERR,
+                  "Failed writing INI file \"%s\", keeping previous file",
+                  filename);
+
+        os_file_close(fd);
+        delete_incomplete_file(temp_name);
+
+        goto exit_free;
+    }
+
+    /* data have been synced above, no need to sync them again */
+    os_file_close_without_sync(fd);
+
+    if(!os_file_rename(temp_name, filename))
+    {
+        delete_incomplete_file(temp_name);
+        goto exit_free;
+    }
+
+    /* make the rename persistent; the buffer is reused for the directory
+     * name, which is never longer than the file name */
+    const char *slash = strrchr(filename, '/');
+
+    if(slash == NULL)
+        strcpy(temp_name, ".");
     else
     {
-        msg_log_assert(inifile->sections_tail != NULL);
-        inifile->sections_tail->next = section;
+        const size_t dir_length = slash > filename ? (size_t)(slash - filename) : 1;
+        memcpy(temp_name, filename, dir_length);
+        temp_name[dir_length] = '\0';
     }
 
-    inifile->sections_tail = section;
+    os_sync_dir(temp_name);
 
-    return section;
+    ret = 0;
+
+exit_free:
+    free(temp_name);
+
+    return ret;
 }
 
-static struct ini_section *find_section_by_pointer(const struct ini_file *inifile,
-                                                   const struct ini_section *section,
-                                                   struct ini_section **preceding)
+int inifile_write_to_file_atomically(const struct ini_file *inifile,
+                                     const char *filename)
 {
-    struct ini_section *p = NULL;
-
-    for(struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
-    {
-        if(s == section)
-        {
-            if(preceding != NULL)
-                *preceding = p;
+    msg_log_assert(inifile != NULL);
+    msg_log_assert(filename != NULL);
 
-            return s;
-        }
+    return write_file_atomically(inifile, filename, serialize_inifile, NULL);
+}
 
-        p = s;
-    }
+int inifile_write_changes_to_file(const struct ini_file *inifile,
+                                  const char *filename)
+{
+    msg_log_assert(inifile != NULL);
+    msg_log_assert(filename != NULL);
 
-    return NULL;
+    return write_file_atomically(inifile, filename, serialize_changes, NULL);
 }
 
-static struct ini_section *find_section_by_name(const struct ini_file *inifile,
-                                                const char *section_name,
-                                                size_t section_name_length,
-                                                struct ini_section **preceding)
+/*!
+ * What we know about a file written by #inifile_write_to_file_if_changed().
+ */
+struct written_file
 {
-    if(section_name_length == 0)
-        section_name_length = strlen(section_name);
+    struct written_file *next;
+    char *filename;
 
-    struct ini_section *p = NULL;
+    /* identity of the file as seen right after writing it */
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    struct timespec mtime;
 
-    for(struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
-    {
-        if(s->name_length == section_name_length &&
-           memcmp(s->name, section_name, section_name_length) == 0)
-        {
-            if(preceding != NULL)
-                *preceding = p;
+    uint64_t hash;
+};
 
-            return s;
-        }
+static struct
+{
+    pthread_mutex_t lock;
+    struct written_file *files;
+    unsigned long skipped;
+    unsigned long performed;
+}
+written_files =
+{
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
 
-        p = s;
+/*!
+ * Hash function for file contents (64 bit FNV-1a).
+ */
+static uint64_t hash_file_contents(const char *data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for(size_t i = 0; i < size; ++i)
+    {
+        hash ^= (uint8_t)data[i];
+        hash *= 1099511628211ULL;
     }
 
-    return NULL;
+    return hash;
 }
 
-static void free_kv_pair(struct ini_key_value_pair *kv)
+static bool stat_written_file(const char *filename, struct stat *buf)
 {
-    parser_free(kv->key);
-    parser_free(kv->value);
-    parser_free(kv);
+    const bool was_suppressed = os_suppress_error_messages(true);
+    const bool ret = os_stat(filename, buf) == 0;
+    os_suppress_error_messages(was_suppressed);
+    return ret;
 }
 
-static void free_section(struct ini_section *section)
+static bool is_same_written_file(const struct written_file *wf,
+                                 const struct stat *buf)
 {
-    struct ini_key_value_pair *kv = section->values_head;
+    return wf->device == buf->st_dev && wf->inode == buf->st_ino &&
+           wf->size == buf->st_size &&
+           wf->mtime.tv_sec == buf->st_mtim.tv_sec &&
+           wf->mtime.tv_nsec == buf->st_mtim.tv_nsec;
+}
 
-    if(kv != NULL)
+static struct written_file *find_written_file(const char *filename)
+{
+    for(struct written_file *wf = written_files.files; wf != NULL; wf = wf->next)
     {
-        for(struct ini_key_value_pair *next_kv = kv->next; kv != NULL; kv = next_kv)
-        {
-            next_kv = kv->next;
-            free_kv_pair(kv);
-        }
+        if(strcmp(wf->filename, filename) == 0)
+            return wf;
     }
 
-    parser_free(section->name);
-    parser_free(section);
+    return NULL;
 }
 
-static void remove_section(struct ini_file *inifile,
-                           struct ini_section *section,
-                           struct ini_section *preceding)
+/*!
+ * Remember file contents by hash and file identity.
+ *
+ * Must be called with the lock held. Failure to remember is not an error,
+ * the next write will simply not be skipped.
+ */
+static void remember_written_file(const char *filename, const struct stat *buf,
+                                  uint64_t hash)
 {
-    if(preceding != NULL)
+    struct written_file *wf = find_written_file(filename);
+
+    if(wf == NULL)
     {
-        msg_log_assert(section == preceding->next);
+        wf = malloc(sizeof(*wf));
 
-        preceding->next = section->next;
+        if(wf == NULL)
+            return;
 
-        if(preceding->next == NULL)
-            inifile->sections_tail = preceding;
-    }
-    else
-    {
-        msg_log_assert(section == inifile->sections_head);
+        wf->filename = strdup(filename);
 
-        if(section->next != NULL)
-            inifile->sections_head = section->next;
-        else
+        if(wf->filename == NULL)
         {
-            inifile->sections_head = NULL;
-            inifile->sections_tail = NULL;
+            free(wf);
+            return;
         }
+
+        wf->next = written_files.files;
+        written_files.files = wf;
     }
 
-    free_section(section);
+    wf->device = buf->st_dev;
+    wf->inode = buf->st_ino;
+    wf->size = buf->st_size;
+    wf->mtime = buf->st_mtim;
+    wf->hash = hash;
 }
 
-bool inifile_remove_section(struct ini_file *inifile,
-                            const struct ini_section *section)
+/*!
+ * Check whether or not the file already contains the serialized data.
+ *
+ * If we have written the file before and it has not been touched since,
+ * then the hashes are compared. Otherwise, the file is read and compared
+ * with the data.
+ */
+static bool is_file_content_equal(const char *filename,
+                                  const struct memory_output *serialized,
+                                  uint64_t hash)
 {
-    msg_log_assert(inifile != NULL);
+    struct stat buf;
 
-    if(section == NULL)
+    if(!stat_written_file(filename, &buf))
         return false;
 
-    struct ini_section *preceding;
-    struct ini_section *s = find_section_by_pointer(inifile, section,
-                                                    &preceding);
-
-    if(s == NULL)
+    if((size_t)buf.st_size != serialized->size)
         return false;
 
-    remove_section(inifile, s, preceding);
+    pthread_mutex_lock(&written_files.lock);
 
-    return true;
-}
+    const struct written_file *wf = find_written_file(filename);
+    const bool is_known = wf != NULL && is_same_written_file(wf, &buf);
+    bool is_equal = is_known && wf->hash == hash;
 
-bool inifile_remove_section_by_name(struct ini_file *inifile,
-                                    const char *section_name,
-                                    size_t section_name_length)
-{
-    msg_log_assert(inifile != NULL);
-    msg_log_assert(section_name != NULL);
+    pthread_mutex_unlock(&written_files.lock);
 
-    struct ini_section *preceding;
-    struct ini_section *s = find_section_by_name(inifile, section_name,
-                                                 section_name_length, &preceding);
+    if(is_known)
+        return is_equal;
 
-    if(s == NULL)
-        return false;
+    if(serialized->size == 0)
+        return true;
 
-    remove_section(inifile, s, preceding);
+    struct os_mapped_file_data mapped;
+    const bool was_suppressed = os_suppress_error_messages(true);
 
-    return true;
-}
+    if(os_map_file_to_memory(&mapped, filename) == 0)
+    {
+        is_equal = mapped.length == serialized->size &&
+                   memcmp(mapped.ptr, serialized->data, serialized->size) == 0;
+        os_unmap_file(&mapped);
+    }
 
-struct ini_section *inifile_find_section(const struct ini_file *inifile,
-                                         const char *section_name,
-                                         size_t section_name_length)
-{
-    msg_log_assert(inifile != NULL);
-    msg_log_assert(section_name != NULL);
+    os_suppress_error_messages(was_suppressed);
 
-    return find_section_by_name(inifile, section_name, section_name_length,
-                                NULL);
+    if(is_equal)
+    {
+        pthread_mutex_lock(&written_files.lock);
+        remember_written_file(filename, &buf, hash);
+        pthread_mutex_unlock(&written_files.lock);
+    }
+
+    return is_equal;
 }
 
-int inifile_write_to_file(const struct ini_file *inifile,
-                          const char *filename)
+int inifile_write_to_file_if_changed(const struct ini_file *inifile,
+                                     const char *filename)
 {
     msg_log_assert(inifile != NULL);
     msg_log_assert(filename != NULL);
 
-    int fd = os_file_new(filename);
+    struct memory_output serialized = { .data = NULL, };
+    struct write_buffer wb;
+    init_write_buffer(&wb, -1, &serialized);
 
-    if(fd < 0)
+    if(serialize_changes(&wb, inifile) < 0)
+    {
+        free(serialized.data);
         return -1;
+    }
 
-    for(const struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
+    const uint64_t hash = hash_file_contents(serialized.data, serialized.size);
+    int ret;
+
+    if(is_file_content_equal(filename, &serialized, hash))
     {
-        if(os_write_from_buffer("[", 1, fd) < 0 ||
-           os_write_from_buffer(s->name, s->name_length, fd) < 0 ||
-           os_write_from_buffer("]\n", 2, fd) < 0)
-        {
-            goto error_exit;
-        }
+        __atomic_add_fetch(&written_files.skipped, 1, __ATOMIC_RELAXED);
+        ret = 1;
+    }
+    else if(write_file_atomically(inifile, filename, NULL, &serialized) == 0)
+    {
+        __atomic_add_fetch(&written_files.performed, 1, __ATOMIC_RELAXED);
+        ret = 0;
 
-        for(const struct ini_key_value_pair *kv = s->values_head; kv != NULL; kv = kv->next)
-        {
-            const size_t value_length = strlen(kv->value);
+        struct stat buf;
 
-            if(os_write_from_buffer(kv->key, kv->key_length, fd) < 0 ||
-               os_write_from_buffer(" = ", 3, fd) < 0 ||
-               (value_length > 0 && os_write_from_buffer(kv->value, value_length, fd) < 0) ||
-               os_write_from_buffer("\n", 1, fd) < 0)
-            {
-                goto error_exit;
-            }
+        if(stat_written_file(filename, &buf))
+        {
+            pthread_mutex_lock(&written_files.lock);
+            remember_written_file(filename, &buf, hash);
+            pthread_mutex_unlock(&written_files.lock);
         }
     }
+    else
+        ret = -1;
 
-    os_file_close(fd);
+    free(serialized.data);
 
-    return 0;
+    return ret;
+}
 
-error_exit:
-    msg_error(0, LOG_ERR,
-              "Failed writing INI file \"%s\", deleting partially written file",
-              filename);
+void inifile_get_write_statistics(struct inifile_write_statistics *stats)
+{
+    msg_log_assert(stats != NULL);
 
-    os_file_close(fd);
+    stats->skipped = __atomic_load_n(&written_files.skipped, __ATOMIC_RELAXED);
+    stats->performed = __atomic_load_n(&written_files.performed, __ATOMIC_RELAXED);
+}
 
-    const bool was_suppressed = os_suppress_error_messages(true);
+void inifile_forget_written_files(void)
+{
+    pthread_mutex_lock(&written_files.lock);
 
-    if(os_file_delete(filename) < 0)
-        msg_error(errno, LOG_ERR, "Failed to delete incomplete file");
+    struct written_file *wf = written_files.files;
+    written_files.files = NULL;
 
-    os_suppress_error_messages(was_suppressed);
+    pthread_mutex_unlock(&written_files.lock);
 
-    return -1;
+    while(wf != NULL)
+    {
+        struct written_file *next = wf->next;
+        free(wf->filename);
+        free(wf);
+        wf = next;
+    }
 }
 
 void inifile_free(struct ini_file *inifile)
 {
     msg_log_assert(inifile != NULL);
 
-    struct ini_section *s = inifile->sections_head;
+    if(!is_using_arena(inifile->storage))
+    {
+        struct ini_section *s = inifile->sections_head;
 
-    if(s == NULL)
-        return;
+        if(s != NULL)
+        {
+            for(struct ini_section *next_section = s->next; s != NULL; s = next_section)
+            {
+                next_section = s->next;
+                free_section(s);
+            }
+        }
+    }
+
+    free_storage(inifile);
+}
+
+size_t inifile_get_memory_usage(const struct ini_file *inifile)
+{
+    msg_log_assert(inifile != NULL);
+
+    const struct inifile_storage *storage = inifile->storage;
+    size_t total = 0;
+
+    if(storage != NULL)
+    {
+        total += sizeof(*storage);
+
+        for(const struct arena_block *block = storage->blocks;
+            block != NULL;
+            block = block->next)
+            total += sizeof(*block) + block->size;
+    }
+
+    if(is_using_arena(storage))
+        return total;
 
-    for(struct ini_section *next_section = s->next; s != NULL; s = next_section)
+    if(storage != NULL)
+        total += inifile_index_slots_size(storage->sections_index.capacity);
+
+    /* interned names and keys are owned by the pool */
+    const bool is_pooled = storage != NULL && storage->string_pool != NULL;
+
+    for(const struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
     {
-        next_section = s->next;
-        free_section(s);
+        total += sizeof(*s) + (is_pooled ? 0 : s->name_length + 1);
+
+        if(s->values_index != NULL)
+            total += sizeof(*s->values_index) +
+                     inifile_index_slots_size(s->values_index->capacity);
+
+        if(s->values_compact != NULL)
+            total += compact_values_size(s->values_compact);
+
+        for(const struct ini_key_value_pair *kv = s->values_head; kv != NULL; kv = kv->next)
+            total += sizeof(*kv) + (is_pooled ? 0 : kv->key_length + 1) +
+                     kv->value_length + 1;
     }
+
+    return total;
 }
 
 static struct ini_key_value_pair *
@@ -824,33 +3208,48 @@ do_store_value(struct ini_section *section,
                const char *key, size_t key_length,
                const char *value, size_t value_length)
 {
-    char *value_copy = parser_strdup(value, value_length);
+    char *value_copy = parser_strdup(section->storage, value, value_length);
     if(value_copy == NULL)
         return NULL;
 
+    drop_compact_values(section);
+
     struct ini_key_value_pair *kv =
         inifile_section_lookup_kv_pair(section, key, key_length);
 
     if(kv != NULL)
     {
-        parser_free(kv->value);
+        parser_free(section->storage, kv->value);
+        kv->value_length = value_length;
         kv->value = value_copy;
         return kv;
     }
 
-    char *key_copy = parser_strdup(key, key_length);
+    char *key_copy = parser_strdup_name(section->storage, key, key_length);
 
     if(key_copy != NULL)
     {
-        kv = parser_malloc(sizeof(*kv));
+        kv = parser_malloc(section->storage, sizeof(*kv));
 
         if(kv != NULL)
         {
             kv->next = NULL;
+            kv->prev = section->values_tail;
             kv->key_length = key_length;
             kv->key = key_copy;
+            kv->value_length = value_length;
             kv->value = value_copy;
 
+            if(section->values_index != NULL &&
+               index_add_kv_pair(section, kv) < 0)
+            {
+                parser_free(section->storage, kv);
+                kv = NULL;
+            }
+        }
+
+        if(kv != NULL)
+        {
             if(section->values_head == NULL)
                 section->values_head = kv;
             else
@@ -865,8 +3264,8 @@ do_store_value(struct ini_section *section,
 
     if(kv == NULL)
     {
-        parser_free(key_copy);
-        parser_free(value_copy);
+        parser_free_name(section->storage, key_copy);
+        parser_free(section->storage, value_copy);
     }
 
     return kv;
@@ -912,38 +3311,93 @@ inifile_section_store_empty_value(struct ini_section *section,
     return do_store_value(section, key, key_length, "", 0);
 }
 
+static void remove_kv_pair(struct ini_section *section,
+                           struct ini_key_value_pair *kv)
+{
+    if(kv->prev != NULL)
+    {
+        msg_log_assert(kv == kv->prev->next);
+        kv->prev->next = kv->next;
+    }
+    else
+    {
+        msg_log_assert(kv == section->values_head);
+        section->values_head = kv->next;
+    }
+
+    if(kv->next != NULL)
+    {
+        msg_log_assert(kv == kv->next->prev);
+        kv->next->prev = kv->prev;
+    }
+    else
+    {
+        msg_log_assert(kv == section->values_tail);
+        section->values_tail = kv->prev;
+    }
+
+    if(section->values_index != NULL)
+        inifile_index_remove(section->values_index,
+                             inifile_hash(kv->key, kv->key_length), kv);
+
+    free_kv_pair(section->storage, kv);
+}
+
 bool inifile_section_remove_value(struct ini_section *section,
                                   const char *key, size_t key_length)
 {
     msg_log_assert(section != NULL);
     msg_log_assert(key != NULL);
 
-    if(key_length == 0)
-        key_length = strlen(key);
+    struct ini_key_value_pair *kv =
+        inifile_section_lookup_kv_pair(section, key, key_length);
 
-    struct ini_key_value_pair *preceding = NULL;
+    if(kv == NULL)
+        return false;
 
-    for(struct ini_key_value_pair *kv = section->values_head; kv != NULL; kv = kv->next)
-    {
-        if(kv->key_length == key_length && memcmp(kv->key, key, key_length) == 0)
-        {
-            if(section->values_head == kv)
-                section->values_head = kv->next;
-            else
-                preceding->next = kv->next;
+    drop_compact_values(section);
+    remove_kv_pair(section, kv);
+
+    return true;
+}
 
-            if(section->values_tail == kv)
-                section->values_tail = preceding;
+void inifile_section_remove_kv_pair(struct ini_section *section,
+                                    struct ini_key_value_pair *kv)
+{
+    msg_log_assert(section != NULL);
+    msg_log_assert(kv != NULL);
 
-            free_kv_pair(kv);
+    drop_compact_values(section);
+    remove_kv_pair(section, kv);
+}
 
-            return true;
+size_t inifile_section_remove_values_if(struct ini_section *section,
+                                        inifile_kv_pair_predicate_fn predicate,
+                                        void *user_data)
+{
+    msg_log_assert(section != NULL);
+    msg_log_assert(predicate != NULL);
+
+    size_t count = 0;
+    struct ini_key_value_pair *kv = section->values_head;
+
+    while(kv != NULL)
+    {
+        struct ini_key_value_pair *next = kv->next;
+
+        if(predicate(kv, user_data))
+        {
+            if(count == 0)
+                drop_compact_values(section);
+
+            remove_kv_pair(section, kv);
+            ++count;
         }
 
-        preceding = kv;
+        kv = next;
     }
 
-    return false;
+    return count;
 }
 
 struct ini_key_value_pair *
@@ -956,11 +3410,59 @@ inifile_section_lookup_kv_pair(const struct ini_section *section,
     if(key_length == 0)
         key_length = strlen(key);
 
+    if(section->values_index != NULL)
+        return lookup_kv_pair_in_index(section->values_index, key, key_length);
+
     for(struct ini_key_value_pair *kv = section->values_head; kv != NULL; kv = kv->next)
     {
-        if(kv->key_length == key_length && memcmp(kv->key, key, key_length) == 0)
+        if(kv->key_length == key_length &&
+           (kv->key == key || memcmp(kv->key, key, key_length) == 0))
             return kv;
     }
 
     return NULL;
 }
+
+void inifile_section_iterator_init(struct inifile_section_iterator *iter,
+                                   const struct ini_section *section)
+{
+    msg_log_assert(iter != NULL);
+    msg_log_assert(section != NULL);
+
+    iter->section = section;
+    iter->kv = section->values_head;
+    iter->index = 0;
+}
+
+const struct ini_key_value_pair *
+inifile_section_iterator_next(struct inifile_section_iterator *iter)
+{
+    msg_log_assert(iter != NULL);
+
+    const struct inifile_compact_values *compact = iter->section->values_compact;
+
+    if(compact == NULL)
+    {
+        const struct ini_key_value_pair *kv = iter->kv;
+
+        if(kv != NULL)
+            iter->kv = kv->next;
+
+        return kv;
+    }
+
+    if(iter->index >= compact->number_of_entries)
+        return NULL;
+
+    const struct compact_entry *entry = &compact->entries[iter->index++];
+    const char *strings = compact_strings(compact);
+
+    iter->current.next = NULL;
+    iter->current.prev = NULL;
+    iter->current.key_length = entry->key_length;
+    iter->current.key = (char *)(uintptr_t)&strings[entry->key_offset];
+    iter->current.value_length = entry->value_length;
+    iter->current.value = (char *)(uintptr_t)&strings[entry->value_offset];
+
+    return &iter->current;
+}
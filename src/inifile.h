@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2015, 2019, 2023  T+A elektroakustik GmbH & Co. KG
+ * Copyright (C) 2015, 2019, 2023, 2026  T+A elektroakustik GmbH & Co. KG
  *
  * This file is part of the T+A Streaming Board software stack ("StrBoWare").
  *
@@ -30,47 +30,258 @@
  */
 /*!@{*/
 
+/*!
+ * \internal
+ * Memory management backing for an INI file structure.
+ *
+ * Only used for INI files which have been set up with non-default flags.
+ */
+struct inifile_storage;
+
+/*!
+ * \internal
+ * Hash index for quick lookup of sections or keys, see inifile_index.h.
+ */
+struct inifile_index;
+
+/*!
+ * \internal
+ * Compact copy of the key/value pairs of a section, see
+ * #INIFILE_FLAG_COMPACT.
+ */
+struct inifile_compact_values;
+
+/*!
+ * Pool of interned section names and keys, see inifile_pool.h.
+ */
+struct inifile_string_pool;
+
+/*!
+ * Flags for INI file structures.
+ *
+ * \see #inifile_new_with_flags(), #inifile_parse_options
+ */
+enum ini_file_flags
+{
+    INIFILE_FLAG_NONE  = 0,
+
+    /*!
+     * Allocate sections, key/value pairs, and all strings from a few large
+     * memory blocks owned by the INI file structure.
+     *
+     * This is much cheaper in terms of allocations and heap fragmentation,
+     * and #inifile_free() becomes very fast. Memory occupied by removed
+     * sections, removed key/value pairs, and replaced values is not reused,
+     * but released only when the whole structure is freed. Use this flag for
+     * structures which are parsed once and modified only a little, if at all.
+     */
+    INIFILE_FLAG_ARENA = 1U << 0,
+
+    /*!
+     * Maintain hash indices for sections and keys.
+     *
+     * Looking up sections by name and keys by name takes constant time, at
+     * the expense of some extra memory per section. The order of sections
+     * and keys stored in the linked lists is not affected.
+     */
+    INIFILE_FLAG_INDEX = 1U << 1,
+
+    /*!
+     * Do not copy section names, keys, and values while parsing.
+     *
+     * The parsed structure points directly into the parsed input, avoiding
+     * nearly all allocations. Strings are only copied when they are stored
+     * after parsing.
+     *
+     * When parsing from memory, the caller must keep the input alive until
+     * the INI file structure is freed. When parsing from file, the file is
+     * kept mapped (and open) until #inifile_free() is called.
+     *
+     * \attention
+     *     Borrowed strings are \e not zero-terminated. Users of structures
+     *     parsed with this flag must use the \c name_length, \c key_length,
+     *     and \c value_length fields.
+     *
+     * This flag implies #INIFILE_FLAG_ARENA.
+     */
+    INIFILE_FLAG_BORROWED = 1U << 2,
+
+    /*!
+     * Keep a compact copy of the key/value pairs of each section.
+     *
+     * After parsing, the key/value pairs of each section are copied to a
+     * single memory block holding an array of offsets and lengths, followed
+     * by all keys and values. Iterating over the section by
+     * #inifile_section_iterator_next() then reads memory sequentially
+     * instead of chasing list pointers across the heap.
+     *
+     * The copy of a section is dropped when a value is stored in or removed
+     * from the section through this API, and iteration falls back to the
+     * linked list. Function #inifile_compact() restores dropped copies.
+     *
+     * Note that the copies are a cache for iteration which is kept \e in
+     * \e addition to the linked lists, not a replacement for them, so this
+     * flag trades memory for speed. For a file with 50 sections of 20 short
+     * values each, memory usage grows from about 74 kB to 114 kB. Do not set
+     * this flag on memory-constrained systems unless sections are iterated
+     * over frequently.
+     */
+    INIFILE_FLAG_COMPACT = 1U << 3,
+};
+
+/*!
+ * Options for #inifile_parse_from_file_with_options() and
+ * #inifile_parse_from_memory_with_options().
+ */
+struct inifile_parse_options
+{
+    /*! Bitmask of #ini_file_flags values. */
+    unsigned int flags;
+
+    /*!
+     * Names of the sections to be parsed, or \c NULL to parse all sections.
+     *
+     * All other sections are skipped line by line without tokenizing their
+     * contents, and they do not show up in the parsed structure.
+     */
+    const char *const *sections;
+
+    /*! Number of names in \c sections. */
+    size_t number_of_sections;
+
+    /*!
+     * Pool for section names and keys, or \c NULL to copy them for each
+     * section and key.
+     *
+     * \see #inifile_new_with_string_pool()
+     */
+    struct inifile_string_pool *string_pool;
+};
+
+/*!
+ * State of an incremental INI file parser.
+ *
+ * All fields are internal. The structure is allocated by the caller and set
+ * up by #inifile_push_parser_init().
+ */
+struct inifile_push_parser
+{
+    /*! \internal INI file being filled, \c NULL after errors. */
+    struct ini_file *inifile;
+
+    /*! \internal Name of the data source for diagnostics messages. */
+    const char *source;
+
+    /*! \internal Copied from #inifile_parse_options. */
+    const char *const *sections;
+    size_t number_of_sections;
+
+    /*! \internal State of the parser at the end of the last complete line. */
+    struct ini_section *current_section;
+    size_t line;
+    int state;
+
+    /*! \internal Incomplete last line of the data fed so far. */
+    char *carry;
+    size_t carry_size;
+    size_t carry_capacity;
+};
+
 /*!
  * Simple structure holding a key and a value.
  *
- * Also a singly linked list of key/value pairs.
+ * Also a doubly linked list of key/value pairs.
  */
 struct ini_key_value_pair
 {
     struct ini_key_value_pair *next;
+    struct ini_key_value_pair *prev;
     size_t key_length;
     char *key;
+    size_t value_length;
     char *value;
 };
 
 /*!
  * Structure that represents an INI file section.
  *
- * The section name is stored along with a singly linked list of key/value
+ * The section name is stored along with a doubly linked list of key/value
  * pairs. For quick appending to the list, there is a pointer to the list's
  * tail element.
  *
- * The structure itself is also part of a singly linked list (of sections).
+ * The structure itself is also part of a doubly linked list (of sections),
+ * so that known sections and values can be removed in constant time.
  */
 struct ini_section
 {
     struct ini_section *next;
+    struct ini_section *prev;
     struct ini_key_value_pair *values_head;
     struct ini_key_value_pair *values_tail;
     size_t name_length;
     char *name;
+
+    /*! \internal Same as in the #ini_file the section belongs to. */
+    struct inifile_storage *storage;
+
+    /*! \internal Index of keys, only for #INIFILE_FLAG_INDEX. */
+    struct inifile_index *values_index;
+
+    /*! \internal Compact copy of values, only for #INIFILE_FLAG_COMPACT. */
+    struct inifile_compact_values *values_compact;
+};
+
+/*!
+ * Iterator over the key/value pairs of a section.
+ *
+ * All fields are internal. The structure is allocated by the caller and set
+ * up by #inifile_section_iterator_init().
+ */
+struct inifile_section_iterator
+{
+    /*! \internal Section being iterated. */
+    const struct ini_section *section;
+
+    /*! \internal Next key/value pair in the linked list. */
+    const struct ini_key_value_pair *kv;
+
+    /*! \internal Next entry in the compact copy. */
+    size_t index;
+
+    /*! \internal Returned for entries in the compact copy. */
+    struct ini_key_value_pair current;
 };
 
 /*!
  * Structure that represents an INI file.
  *
- * This is nothing more than a singly linked list of section structures. The
- * section structures only store their names and a list of keys and values.
+ * At its core, this is a doubly linked list of section structures, each of
+ * which stores its name and a doubly linked list of keys and values. The
+ * lists define the order of sections and values in the file.
+ *
+ * Depending on #ini_file_flags, there is more to it, all managed through the
+ * internal storage: arena blocks holding the structures and strings
+ * (#INIFILE_FLAG_ARENA), hash indices of sections and keys
+ * (#INIFILE_FLAG_INDEX), the mapped text the strings point into
+ * (#INIFILE_FLAG_BORROWED), and compact copies of the values of each
+ * section (#INIFILE_FLAG_COMPACT). Section names and keys may be shared
+ * with other structures through a string pool, see
+ * #inifile_new_with_string_pool(). None of these change the lists, so code
+ * which only walks the lists works with any of them.
  */
 struct ini_file
 {
     struct ini_section *sections_head;
     struct ini_section *sections_tail;
+
+    /*! Bitmask of #ini_file_flags values. */
+    unsigned int flags;
+
+    /*! \internal Pool for names and keys, may be \c NULL. */
+    struct inifile_string_pool *string_pool;
+
+    /*! \internal Allocated on demand for non-default flags or pool. */
+    struct inifile_storage *storage;
 };
 
 #ifdef __cplusplus
@@ -86,6 +297,66 @@ extern "C" {
  */
 void inifile_new(struct ini_file *inifile);
 
+/*!
+ * Initialize INI file structure with non-default flags.
+ *
+ * \param inifile
+ *     A structure to be initialized. The structure must have been allocated by
+ *     the caller. This function does not allocate any memory.
+ *
+ * \param flags
+ *     Bitmask of #ini_file_flags values.
+ */
+void inifile_new_with_flags(struct ini_file *inifile, unsigned int flags);
+
+/*!
+ * Initialize INI file structure which takes names and keys from a pool.
+ *
+ * All section names and keys stored in \p inifile are interned in
+ * \p string_pool, also those stored while parsing and those stored by
+ * #inifile_new_section() and #inifile_section_store_value(). Identical names
+ * and keys share a single copy, and a key passed to the lookup functions
+ * as a pointer obtained from the pool is found by pointer comparison.
+ *
+ * \param inifile
+ *     A structure to be initialized. The structure must have been allocated by
+ *     the caller. This function does not allocate any memory.
+ *
+ * \param flags
+ *     Bitmask of #ini_file_flags values.
+ *
+ * \param string_pool
+ *     The pool of strings, may be \c NULL. The pool must outlive
+ *     \p inifile.
+ */
+void inifile_new_with_string_pool(struct ini_file *inifile, unsigned int flags,
+                                  struct inifile_string_pool *string_pool);
+
+/*!
+ * Enable #INIFILE_FLAG_INDEX for an existing INI file structure.
+ *
+ * The indices for all sections and keys currently stored in \p inifile are
+ * built, and they will be maintained for all future modifications.
+ *
+ * \returns
+ *     0 on success, -1 on error (out of memory). In case of error, the
+ *     structure remains usable, but without indices.
+ */
+int inifile_build_index(struct ini_file *inifile);
+
+/*!
+ * Create compact copies of the key/value pairs of all sections.
+ *
+ * Sets #INIFILE_FLAG_COMPACT. Copies which exist already are kept, so this
+ * function may be called after modifications to restore the copies which
+ * have been dropped.
+ *
+ * \returns
+ *     0 on success, -1 on error. In case of error, iteration falls back to
+ *     the linked lists where copies are missing.
+ */
+int inifile_compact(struct ini_file *inifile);
+
 /*!
  * Parse an INI file.
  *
@@ -104,6 +375,26 @@ void inifile_new(struct ini_file *inifile);
  */
 int inifile_parse_from_file(struct ini_file *inifile, const char *filename);
 
+/*!
+ * Parse an INI file, use non-default options.
+ *
+ * Like #inifile_parse_from_file(), but the resulting structure is set up
+ * according to \p options, which may be \c NULL to select default options.
+ */
+int inifile_parse_from_file_with_options(struct ini_file *inifile,
+                                         const char *filename,
+                                         const struct inifile_parse_options *options);
+
+/*!
+ * Parse a large INI file using multiple threads.
+ *
+ * See #inifile_parse_from_memory_parallel().
+ */
+int inifile_parse_from_file_parallel(struct ini_file *inifile,
+                                     const char *filename,
+                                     const struct inifile_parse_options *options,
+                                     unsigned int number_of_threads);
+
 /*!
  * Parse an INI file from memory.
  *
@@ -130,6 +421,184 @@ int inifile_parse_from_file(struct ini_file *inifile, const char *filename);
 int inifile_parse_from_memory(struct ini_file *inifile, const char *source,
                               const char *content, size_t size);
 
+/*!
+ * Parse an INI file from memory, use non-default options.
+ *
+ * Like #inifile_parse_from_memory(), but the resulting structure is set up
+ * according to \p options, which may be \c NULL to select default options.
+ */
+int inifile_parse_from_memory_with_options(struct ini_file *inifile,
+                                           const char *source,
+                                           const char *content, size_t size,
+                                           const struct inifile_parse_options *options);
+
+/*!
+ * Parse a large INI file from memory using multiple threads.
+ *
+ * The input is split into roughly equal parts at lines beginning with a
+ * \c '[' character. Each part is parsed by its own thread into its own
+ * structure (and its own arena for #INIFILE_FLAG_ARENA), and the results are
+ * merged in order. Sections occurring in more than one part are merged just
+ * like sections occurring more than once in a sequentially parsed file, so
+ * the resulting structure is the same as the one returned by
+ * #inifile_parse_from_memory_with_options().
+ *
+ * Small inputs are parsed by fewer threads, or sequentially by the calling
+ * thread.
+ *
+ * If a string pool is passed in \p options, each thread interns names into
+ * a private pool so that the threads do not contend for the lock of the
+ * given pool. The names are moved to the given pool while merging.
+ *
+ * \param inifile, source, content, size, options
+ *     See #inifile_parse_from_memory_with_options().
+ *
+ * \param number_of_threads
+ *     Maximum number of threads to use, including the calling thread. Pass 0
+ *     to use one thread per online CPU.
+ *
+ * \returns
+ *     0 on success, -1 on hard error (out of memory).
+ */
+int inifile_parse_from_memory_parallel(struct ini_file *inifile,
+                                       const char *source,
+                                       const char *content, size_t size,
+                                       const struct inifile_parse_options *options,
+                                       unsigned int number_of_threads);
+
+/*!
+ * Callback for section headers found by #inifile_parse_events_from_memory().
+ *
+ * \param name, name_length
+ *     Name of the section. The name is \e not zero-terminated.
+ * \param user_data
+ *     Pointer passed to the parser function.
+ *
+ * \returns
+ *     0 to continue parsing, 1 to stop parsing, -1 to abort parsing with an
+ *     error.
+ */
+typedef int (*inifile_section_event_fn)(const char *name, size_t name_length,
+                                        void *user_data);
+
+/*!
+ * Callback for assignments found by #inifile_parse_events_from_memory().
+ *
+ * The key and value are \e not zero-terminated. Empty values are passed
+ * with a \p value_length of 0.
+ *
+ * \returns
+ *     0 to continue parsing, 1 to stop parsing, -1 to abort parsing with an
+ *     error.
+ */
+typedef int (*inifile_value_event_fn)(const char *key, size_t key_length,
+                                      const char *value, size_t value_length,
+                                      void *user_data);
+
+/*!
+ * Parse INI file from memory without building an INI file structure.
+ *
+ * The parser calls \p section_fn for each section header and \p value_fn
+ * for each assignment within a section, in the order in which they appear
+ * in \p content. Strings passed to the callbacks point directly into
+ * \p content, so no memory is allocated at all. Use this function if only a
+ * small part of a large file is needed, or if the data are going to be
+ * converted into some other representation anyway.
+ *
+ * Note that, unlike the INI file structures built by the other parser
+ * functions, repeated section headers and repeated assignments to a key are
+ * reported as they are. They are not merged.
+ *
+ * \param source
+ *     Name of the data source (usually a filename) for diagnostics messages.
+ * \param content, size
+ *     An INI file read or mapped to memory.
+ * \param section_fn, value_fn
+ *     Callbacks for sections and assignments. Either may be \c NULL.
+ * \param user_data
+ *     Pointer passed to the callbacks.
+ *
+ * \returns
+ *     0 on success, including the case that a callback has stopped parsing;
+ *     -1 in case a callback has aborted parsing.
+ */
+int inifile_parse_events_from_memory(const char *source,
+                                     const char *content, size_t size,
+                                     inifile_section_event_fn section_fn,
+                                     inifile_value_event_fn value_fn,
+                                     void *user_data);
+
+/*!
+ * Parse INI file without building an INI file structure.
+ *
+ * Like #inifile_parse_events_from_memory(), but for a file.
+ *
+ * \retval 0 on success
+ * \retval 1 if file does not exist
+ * \retval -1 on error
+ */
+int inifile_parse_events_from_file(const char *filename,
+                                   inifile_section_event_fn section_fn,
+                                   inifile_value_event_fn value_fn,
+                                   void *user_data);
+
+/*!
+ * Start parsing an INI file which is going to be passed in chunks.
+ *
+ * Use this function and its companions #inifile_push_parser_feed() and
+ * #inifile_push_parser_finish() to parse data as it arrives, for instance
+ * from a pipe or socket, without collecting the whole document in a single
+ * buffer first. Only the incomplete last line of each chunk is copied and
+ * carried over to the next chunk. Sections and values are available in
+ * \p inifile as soon as their lines have been fed.
+ *
+ * \param parser
+ *     A structure to be set up by this function. The structure must have been
+ *     allocated by the caller.
+ * \param inifile
+ *     A structure to be filled by the parser. It is initialized by this
+ *     function, so it is not necessary to call #inifile_new() beforehand.
+ * \param source
+ *     Name of the data source for diagnostics messages. The string must
+ *     remain valid until #inifile_push_parser_finish() has been called.
+ * \param options
+ *     Options for the resulting structure, or \c NULL for default options.
+ *     Flag #INIFILE_FLAG_BORROWED is ignored because chunks are not
+ *     required to stay around.
+ *
+ * \returns
+ *     0 on success, -1 on hard error (out of memory).
+ */
+int inifile_push_parser_init(struct inifile_push_parser *parser,
+                             struct ini_file *inifile, const char *source,
+                             const struct inifile_parse_options *options);
+
+/*!
+ * Parse next chunk of data.
+ *
+ * Chunks may be split at arbitrary positions, including in the middle of
+ * lines. The chunk may be freed or reused after this function has returned.
+ *
+ * \returns
+ *     0 on success, -1 on hard error (out of memory). In case of error, the
+ *     INI file structure is freed and all further calls of this function
+ *     and #inifile_push_parser_finish() will fail.
+ */
+int inifile_push_parser_feed(struct inifile_push_parser *parser,
+                             const char *chunk, size_t size);
+
+/*!
+ * Parse remaining data and free resources occupied by the parser.
+ *
+ * This function must be called exactly once for each successfully
+ * initialized parser, even after errors.
+ *
+ * \returns
+ *     0 on success, -1 on hard error. In case of error, the INI file
+ *     structure has been freed.
+ */
+int inifile_push_parser_finish(struct inifile_push_parser *parser);
+
 /*!
  * Allocate a new section structure for given name.
  *
@@ -167,10 +636,70 @@ struct ini_section *inifile_new_section(struct ini_file *inifile,
  *
  * returns
  *     True on success, false in case the section does not exist.
+ *
+ * \note
+ *     This function verifies that \p section is actually part of \p inifile,
+ *     which takes linear time. Use #inifile_remove_section_unchecked() for
+ *     sections known to be part of the file.
  */
 bool inifile_remove_section(struct ini_file *inifile,
                             const struct ini_section *section);
 
+/*!
+ * Remove section from file in constant time, without checking the pointer.
+ *
+ * \param inifile
+ *     INI file structure the section should be removed from.
+ *
+ * \param section
+ *     Pointer to the section to be removed, as returned by
+ *     #inifile_new_section() or #inifile_find_section() for \p inifile.
+ *     Passing any other pointer results in undefined behavior.
+ */
+void inifile_remove_section_unchecked(struct ini_file *inifile,
+                                      struct ini_section *section);
+
+/*!
+ * Callback for #inifile_remove_sections_if().
+ *
+ * \returns
+ *     True if the section should be removed, false if it should be kept.
+ */
+typedef bool (*inifile_section_predicate_fn)(const struct ini_section *section,
+                                             void *user_data);
+
+/*!
+ * Callback for #inifile_section_remove_values_if().
+ *
+ * \returns
+ *     True if the key/value pair should be removed, false if it should be
+ *     kept.
+ */
+typedef bool (*inifile_kv_pair_predicate_fn)(const struct ini_key_value_pair *kv,
+                                             void *user_data);
+
+/*!
+ * Remove all sections matching a predicate in a single pass.
+ *
+ * The predicate is called once for each section in file order. It must not
+ * modify \p inifile.
+ *
+ * \param inifile
+ *     INI file structure the sections should be removed from.
+ *
+ * \param predicate
+ *     Function which decides whether or not to remove a section.
+ *
+ * \param user_data
+ *     Pointer passed to \p predicate.
+ *
+ * \returns
+ *     Number of removed sections.
+ */
+size_t inifile_remove_sections_if(struct ini_file *inifile,
+                                  inifile_section_predicate_fn predicate,
+                                  void *user_data);
+
 /*!
  * Remove section from file, freeing all resources occupied by it.
  *
@@ -210,15 +739,121 @@ struct ini_section *inifile_find_section(const struct ini_file *inifile,
 int inifile_write_to_file(const struct ini_file *inifile,
                           const char *filename);
 
+/*!
+ * Write INI file to filesystem, replacing any existing file atomically.
+ *
+ * The file is written to a temporary file named \p filename with suffix
+ * \c .tmp in the same directory, which is synced to storage and then
+ * renamed over \p filename. Finally, the directory is synced to make the
+ * rename persistent. Readers will either see the previous file or the new
+ * file, never a partially written file, even in case of power failure.
+ *
+ * The name of the temporary file is always the same for a given
+ * \p filename, so a stale temporary file left behind by a crash is simply
+ * overwritten. This also means that two writers of the same file would
+ * clobber each other's temporary file; callers must make sure that writes
+ * to the same file are serialized.
+ *
+ * \returns
+ *     0 on success, -1 on error. In case of error, including failure to
+ *     sync the temporary file to storage, any existing file named
+ *     \p filename is left untouched.
+ */
+int inifile_write_to_file_atomically(const struct ini_file *inifile,
+                                     const char *filename);
+
+/*!
+ * Write INI file, keep unchanged lines of the text it was parsed from.
+ *
+ * For INI files parsed with #INIFILE_FLAG_BORROWED, the original text is
+ * copied verbatim, except for lines of modified values, which are replaced,
+ * and lines of removed values and sections, which are left out. New values
+ * are inserted after the last line of their section, new sections are
+ * appended to the end of the file. Thus, the layout of the file is preserved
+ * and only the changed lines are formatted. Storing a value equal to the
+ * current value does not count as a change.
+ *
+ * The original text is found by the string pointers in the structure, so the
+ * structure must not have been parsed with a section filter (sections which
+ * are not in the structure are considered removed). Lookups are done for
+ * each line of the original text, so #INIFILE_FLAG_INDEX should be set for
+ * large files.
+ *
+ * Other INI files are written as by #inifile_write_to_file_atomically().
+ *
+ * The file is always replaced atomically as described for
+ * #inifile_write_to_file_atomically(), so it is safe to write to the file
+ * the structure was parsed from (and which is still mapped).
+ *
+ * \returns
+ *     0 on success, -1 on error.
+ */
+int inifile_write_changes_to_file(const struct ini_file *inifile,
+                                  const char *filename);
+
+/*!
+ * Counters for #inifile_write_to_file_if_changed().
+ */
+struct inifile_write_statistics
+{
+    /*! Number of writes skipped because the file was up-to-date. */
+    unsigned long skipped;
+
+    /*! Number of files actually written. */
+    unsigned long performed;
+};
+
+/*!
+ * Write INI file only if its contents differ from the file on storage.
+ *
+ * The INI file is serialized to memory as by
+ * #inifile_write_changes_to_file(), and the file is replaced atomically only
+ * if the serialized data differ from its current contents. This saves flash
+ * wear and time spent in \c fsync() for rewriting identical data.
+ *
+ * A hash of the data is remembered for each file written by this function,
+ * along with device, inode, size, and modification time of the file. As
+ * long as the file is not touched by anybody else, the serialized data are
+ * compared by hash. Otherwise, the file is read and compared with the data.
+ *
+ * \retval 0 if the file has been written
+ * \retval 1 if the file was up-to-date and has not been written
+ * \retval -1 on error
+ */
+int inifile_write_to_file_if_changed(const struct ini_file *inifile,
+                                     const char *filename);
+
+/*!
+ * Read counters of skipped and performed writes.
+ */
+void inifile_get_write_statistics(struct inifile_write_statistics *stats);
+
+/*!
+ * Drop all hashes remembered by #inifile_write_to_file_if_changed().
+ */
+void inifile_forget_written_files(void);
+
 /*!
  * Free an INI file structure.
  *
  * Note that the memory \p inifile is pointing to is \e not freed by this
  * function. This allows callers to pass stack-allocated objects as
  * \p inifile.
+ *
+ * For structures using #INIFILE_FLAG_ARENA, only the arena blocks are freed,
+ * without visiting the sections and key/value pairs.
  */
 void inifile_free(struct ini_file *inifile);
 
+/*!
+ * Determine amount of heap memory occupied by an INI file structure.
+ *
+ * The memory occupied by the #ini_file structure itself, by a file kept
+ * mapped for #INIFILE_FLAG_BORROWED, and by names and keys interned in a
+ * string pool is not included.
+ */
+size_t inifile_get_memory_usage(const struct ini_file *inifile);
+
 /*!
  * Store a value with given key in given section.
  *
@@ -278,6 +913,42 @@ inifile_section_store_empty_value(struct ini_section *section,
 bool inifile_section_remove_value(struct ini_section *section,
                                   const char *key, size_t key_length);
 
+/*!
+ * Remove given key/value pair from the given section in constant time.
+ *
+ * \param section
+ *     The section the key/value pair should be removed from.
+ *
+ * \param kv
+ *     Key/value pair as returned by #inifile_section_store_value() or
+ *     #inifile_section_lookup_kv_pair() for \p section. Pointers returned by
+ *     #inifile_section_iterator_next() cannot be passed here.
+ */
+void inifile_section_remove_kv_pair(struct ini_section *section,
+                                    struct ini_key_value_pair *kv);
+
+/*!
+ * Remove all key/value pairs matching a predicate in a single pass.
+ *
+ * The predicate is called once for each key/value pair in file order. It
+ * must not modify \p section.
+ *
+ * \param section
+ *     The section the key/value pairs should be removed from.
+ *
+ * \param predicate
+ *     Function which decides whether or not to remove a key/value pair.
+ *
+ * \param user_data
+ *     Pointer passed to \p predicate.
+ *
+ * \returns
+ *     Number of removed key/value pairs.
+ */
+size_t inifile_section_remove_values_if(struct ini_section *section,
+                                        inifile_kv_pair_predicate_fn predicate,
+                                        void *user_data);
+
 /*!
  * Lookup value by key name.
  *
@@ -297,6 +968,25 @@ struct ini_key_value_pair *
 inifile_section_lookup_kv_pair(const struct ini_section *section,
                                const char *key, size_t key_length);
 
+/*!
+ * Set up iterator over the key/value pairs of a section.
+ *
+ * The section must not be modified while it is being iterated.
+ */
+void inifile_section_iterator_init(struct inifile_section_iterator *iter,
+                                   const struct ini_section *section);
+
+/*!
+ * Get next key/value pair of a section, in order of the linked list.
+ *
+ * \returns
+ *     The next key/value pair, or \c NULL at the end of the section. The
+ *     returned structure is only valid until the next call of this function,
+ *     and its \c next pointer must not be used.
+ */
+const struct ini_key_value_pair *
+inifile_section_iterator_next(struct inifile_section_iterator *iter);
+
 #ifdef __cplusplus
 }
 #endif
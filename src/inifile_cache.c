@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "inifile_cache.h"
+#include "messages.h"
+#include "os.h"
+
+struct file_identity
+{
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    struct timespec mtime;
+};
+
+struct cache_entry
+{
+    /*! Doubly linked LRU list, most recently used entry at the head. */
+    struct cache_entry *prev;
+    struct cache_entry *next;
+
+    struct file_identity identity;
+    struct ini_file inifile;
+    size_t memory_usage;
+
+    /*! Number of users, not counting the cache itself. */
+    unsigned int refcount;
+
+    /*! Whether or not the entry is in the LRU list. */
+    bool is_cached;
+};
+
+static struct
+{
+    pthread_mutex_t lock;
+    struct cache_entry *head;
+    struct cache_entry *tail;
+    size_t memory_usage;
+    size_t memory_limit;
+}
+cache =
+{
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static bool get_identity(const char *filename, struct file_identity *identity)
+{
+    struct stat buf;
+
+    if(os_stat(filename, &buf) < 0)
+        return false;
+
+    identity->device = buf.st_dev;
+    identity->inode = buf.st_ino;
+    identity->size = buf.st_size;
+    identity->mtime = buf.st_mtim;
+
+    return true;
+}
+
+static bool is_same_identity(const struct file_identity *a,
+                             const struct file_identity *b)
+{
+    return a->device == b->device && a->inode == b->inode &&
+           a->size == b->size &&
+           a->mtime.tv_sec == b->mtime.tv_sec &&
+           a->mtime.tv_nsec == b->mtime.tv_nsec;
+}
+
+static inline struct cache_entry *entry_from_inifile(const struct ini_file *inifile)
+{
+    return (struct cache_entry *)(uintptr_t)
+        ((const char *)inifile - offsetof(struct cache_entry, inifile));
+}
+
+static void free_entry(struct cache_entry *entry)
+{
+    inifile_free(&entry->inifile);
+    free(entry);
+}
+
+static void unlink_entry(struct cache_entry *entry)
+{
+    if(entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        cache.head = entry->next;
+
+    if(entry->next != NULL)
+        entry->next->prev = entry->prev;
+    else
+        cache.tail = entry->prev;
+
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void push_entry_front(struct cache_entry *entry)
+{
+    entry->prev = NULL;
+    entry->next = cache.head;
+
+    if(cache.head != NULL)
+        cache.head->prev = entry;
+    else
+        cache.tail = entry;
+
+    cache.head = entry;
+}
+
+/*!
+ * Remove entry from cache.
+ *
+ * Must be called with the cache locked. Entries which are still in use are
+ * freed later by #inifile_cache_release().
+ */
+static void drop_entry(struct cache_entry *entry)
+{
+    unlink_entry(entry);
+    entry->is_cached = false;
+    cache.memory_usage -= entry->memory_usage;
+
+    if(entry->refcount == 0)
+        free_entry(entry);
+}
+
+/*!
+ * Remove least recently used entries until the memory limit is met.
+ */
+static void evict_entries(void)
+{
+    while(cache.tail != NULL && cache.memory_usage > cache.memory_limit)
+        drop_entry(cache.tail);
+}
+
+static struct cache_entry *lookup_entry(const struct file_identity *identity)
+{
+    for(struct cache_entry *entry = cache.head; entry != NULL; entry = entry->next)
+    {
+        if(is_same_identity(&entry->identity, identity))
+            return entry;
+    }
+
+    return NULL;
+}
+
+void inifile_cache_set_limit(size_t max_bytes)
+{
+    pthread_mutex_lock(&cache.lock);
+    cache.memory_limit = max_bytes;
+    evict_entries();
+    pthread_mutex_unlock(&cache.lock);
+}
+
+const struct ini_file *inifile_cache_get(const char *filename, int *result)
+{
+    msg_log_assert(filename != NULL);
+
+    int dummy;
+
+    if(result == NULL)
+        result = &dummy;
+
+    struct file_identity identity;
+
+    if(!get_identity(filename, &identity))
+    {
+        *result = errno == ENOENT ? 1 : -1;
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache.lock);
+
+    struct cache_entry *entry =
+        cache.memory_limit > 0 ? lookup_entry(&identity) : NULL;
+
+    if(entry != NULL)
+    {
+        ++entry->refcount;
+        unlink_entry(entry);
+        push_entry_front(entry);
+        pthread_mutex_unlock(&cache.lock);
+
+        *result = 0;
+        return &entry->inifile;
+    }
+
+    pthread_mutex_unlock(&cache.lock);
+
+    /* parse without holding the lock, the file may be large */
+    entry = malloc(sizeof(*entry));
+
+    if(entry == NULL)
+    {
+        msg_out_of_memory("INI file cache entry");
+        *result = -1;
+        return NULL;
+    }
+
+    static const struct inifile_parse_options options =
+    {
+        .flags = INIFILE_FLAG_ARENA | INIFILE_FLAG_INDEX,
+    };
+
+    *result = inifile_parse_from_file_with_options(&entry->inifile, filename,
+                                                   &options);
+
+    if(*result != 0)
+    {
+        /* structure has been freed already in case of parse errors */
+        if(*result > 0)
+            inifile_free(&entry->inifile);
+
+        free(entry);
+        return NULL;
+    }
+
+    entry->prev = NULL;
+    entry->next = NULL;
+    entry->identity = identity;
+    entry->memory_usage = inifile_get_memory_usage(&entry->inifile);
+    entry->refcount = 1;
+    entry->is_cached = false;
+
+    /* the file may have been replaced while it was parsed, in which case
+     * the structure cannot be associated with either identity */
+    struct file_identity identity_after_parse;
+    const bool is_stable =
+        get_identity(filename, &identity_after_parse) &&
+        is_same_identity(&identity, &identity_after_parse);
+
+    pthread_mutex_lock(&cache.lock);
+
+    if(is_stable && entry->memory_usage <= cache.memory_limit)
+    {
+        /* replace entry inserted by another thread in the meantime */
+        struct cache_entry *other = lookup_entry(&identity);
+
+        if(other != NULL)
+            drop_entry(other);
+
+        push_entry_front(entry);
+        entry->is_cached = true;
+        cache.memory_usage += entry->memory_usage;
+        evict_entries();
+    }
+
+    pthread_mutex_unlock(&cache.lock);
+
+    return &entry->inifile;
+}
+
+void inifile_cache_release(const struct ini_file *inifile)
+{
+    if(inifile == NULL)
+        return;
+
+    struct cache_entry *entry = entry_from_inifile(inifile);
+
+    pthread_mutex_lock(&cache.lock);
+
+    msg_log_assert(entry->refcount > 0);
+
+    const bool is_unused = --entry->refcount == 0 && !entry->is_cached;
+
+    pthread_mutex_unlock(&cache.lock);
+
+    if(is_unused)
+        free_entry(entry);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#ifndef INIFILE_CACHE_H
+#define INIFILE_CACHE_H
+
+#include <stddef.h>
+
+#include "inifile.h"
+
+/*!
+ * \addtogroup inifile_cache Process-wide cache of parsed INI files
+ * \ingroup inifile
+ *
+ * Parsed INI files are cached by file identity, i.e., by device, inode,
+ * modification time, and size of the file. Users of the same unchanged file
+ * share a single read-only structure, so that the file is mapped and parsed
+ * only once. Any change to the file changes its identity, so that outdated
+ * structures are never returned.
+ *
+ * The cache is disabled by default. It is enabled by setting a memory limit
+ * with #inifile_cache_set_limit(). The least recently used structures are
+ * evicted from the cache when the limit is exceeded. Structures which are
+ * still in use when they are evicted are freed when they are released by
+ * their last user.
+ *
+ * All functions are thread-safe.
+ */
+/*!@{*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Set memory limit for cached structures, enable or disable cache.
+ *
+ * \param max_bytes
+ *     Maximum amount of memory occupied by cached structures as determined
+ *     by #inifile_get_memory_usage(). Pass 0 to disable the cache and drop
+ *     all cached structures.
+ */
+void inifile_cache_set_limit(size_t max_bytes);
+
+/*!
+ * Get parsed INI file, from cache if possible.
+ *
+ * The returned structure is indexed (see #INIFILE_FLAG_INDEX) and must not
+ * be modified. It must be released by #inifile_cache_release(), not by
+ * #inifile_free().
+ *
+ * If the cache is disabled, then the file is parsed each time and the
+ * structure is freed on release.
+ *
+ * \param filename
+ *     Name of an INI file.
+ *
+ * \param result
+ *     Result of parsing the file, 0 on success, 1 if the file does not
+ *     exist, -1 on error (as returned by #inifile_parse_from_file()). May be
+ *     \c NULL.
+ *
+ * \returns
+ *     The parsed INI file, or \c NULL if \p result is not 0.
+ */
+const struct ini_file *inifile_cache_get(const char *filename, int *result);
+
+/*!
+ * Release structure returned by #inifile_cache_get().
+ */
+void inifile_cache_release(const struct ini_file *inifile);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!@}*/
+
+#endif /* !INIFILE_CACHE_H */
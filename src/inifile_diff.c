@@ -0,0 +1,342 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "inifile_diff.h"
+#include "inifile_index.h"
+#include "messages.h"
+
+/*!
+ * Lists shorter than this are searched linearly.
+ *
+ * Same reasoning as for the temporary indices used by the parser.
+ */
+#define DIFF_INDEX_MIN_ITEMS    8
+
+/*!
+ * Lookup of sections of an INI file by name.
+ */
+struct sections_lookup
+{
+    const struct ini_file *inifile;
+    struct inifile_index index;
+};
+
+/*!
+ * Lookup of values of a section by key.
+ */
+struct values_lookup
+{
+    const struct ini_section *section;
+    struct inifile_index index;
+};
+
+static int sections_lookup_init(struct sections_lookup *lookup,
+                                const struct ini_file *inifile)
+{
+    lookup->inifile = inifile;
+    inifile_index_init(&lookup->index);
+
+    size_t count = 0;
+
+    for(const struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
+        ++count;
+
+    if(count < DIFF_INDEX_MIN_ITEMS)
+        return 0;
+
+    if(inifile_index_reserve(&lookup->index, count) < 0)
+        return -1;
+
+    for(const struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
+        inifile_index_insert(&lookup->index, inifile_hash(s->name, s->name_length),
+                             (void *)(uintptr_t)s);
+
+    return 0;
+}
+
+static const struct ini_section *
+sections_lookup_find(const struct sections_lookup *lookup,
+                     const char *name, size_t name_length)
+{
+    if(lookup->index.slots == NULL)
+        return inifile_find_section(lookup->inifile, name, name_length);
+
+    const uint32_t hash = inifile_hash(name, name_length);
+    size_t cursor;
+
+    for(const struct ini_section *s = inifile_index_find_first(&lookup->index, hash, &cursor);
+        s != NULL;
+        s = inifile_index_find_next(&lookup->index, hash, &cursor))
+    {
+        if(s->name_length == name_length &&
+           (s->name == name || memcmp(s->name, name, name_length) == 0))
+            return s;
+    }
+
+    return NULL;
+}
+
+static int values_lookup_init(struct values_lookup *lookup,
+                              const struct ini_section *section)
+{
+    lookup->section = section;
+    inifile_index_init(&lookup->index);
+
+    /* sections indexed by the INI file code are fast already */
+    if(section->values_index != NULL)
+        return 0;
+
+    size_t count = 0;
+
+    for(const struct ini_key_value_pair *kv = section->values_head; kv != NULL; kv = kv->next)
+        ++count;
+
+    if(count < DIFF_INDEX_MIN_ITEMS)
+        return 0;
+
+    if(inifile_index_reserve(&lookup->index, count) < 0)
+        return -1;
+
+    for(const struct ini_key_value_pair *kv = section->values_head; kv != NULL; kv = kv->next)
+        inifile_index_insert(&lookup->index, inifile_hash(kv->key, kv->key_length),
+                             (void *)(uintptr_t)kv);
+
+    return 0;
+}
+
+static const struct ini_key_value_pair *
+values_lookup_find(const struct values_lookup *lookup,
+                   const char *key, size_t key_length)
+{
+    if(lookup->index.slots == NULL)
+        return inifile_section_lookup_kv_pair(lookup->section, key, key_length);
+
+    const uint32_t hash = inifile_hash(key, key_length);
+    size_t cursor;
+
+    for(const struct ini_key_value_pair *kv = inifile_index_find_first(&lookup->index, hash, &cursor);
+        kv != NULL;
+        kv = inifile_index_find_next(&lookup->index, hash, &cursor))
+    {
+        if(kv->key_length == key_length &&
+           (kv->key == key || memcmp(kv->key, key, key_length) == 0))
+            return kv;
+    }
+
+    return NULL;
+}
+
+static int add_change(struct inifile_diff *diff, enum inifile_change_kind kind,
+                      const struct ini_section *old_section,
+                      const struct ini_section *new_section,
+                      const struct ini_key_value_pair *old_kv,
+                      const struct ini_key_value_pair *new_kv)
+{
+    if(diff->number_of_changes >= diff->capacity)
+    {
+        const size_t capacity = diff->capacity > 0 ? 2 * diff->capacity : 16;
+        struct inifile_change *changes =
+            realloc(diff->changes, capacity * sizeof(*changes));
+
+        if(changes == NULL)
+            return msg_out_of_memory("INI file differences");
+
+        diff->changes = changes;
+        diff->capacity = capacity;
+    }
+
+    struct inifile_change *change = &diff->changes[diff->number_of_changes++];
+
+    change->kind = kind;
+    change->old_section = old_section;
+    change->new_section = new_section;
+    change->old_kv = old_kv;
+    change->new_kv = new_kv;
+
+    return 0;
+}
+
+static bool is_same_value(const struct ini_key_value_pair *a,
+                          const struct ini_key_value_pair *b)
+{
+    return a->value_length == b->value_length &&
+           (a->value == b->value || memcmp(a->value, b->value, a->value_length) == 0);
+}
+
+/*!
+ * Add changes for all values of a section which exists in one file only.
+ */
+static int diff_whole_section(struct inifile_diff *diff,
+                              const struct ini_section *old_section,
+                              const struct ini_section *new_section)
+{
+    const struct ini_section *section =
+        old_section != NULL ? old_section : new_section;
+    const enum inifile_change_kind kind =
+        old_section != NULL
+        ? INIFILE_CHANGE_VALUE_REMOVED
+        : INIFILE_CHANGE_VALUE_ADDED;
+
+    if(add_change(diff,
+                  old_section != NULL
+                  ? INIFILE_CHANGE_SECTION_REMOVED
+                  : INIFILE_CHANGE_SECTION_ADDED,
+                  old_section, new_section, NULL, NULL) < 0)
+        return -1;
+
+    for(const struct ini_key_value_pair *kv = section->values_head; kv != NULL; kv = kv->next)
+    {
+        if(add_change(diff, kind, old_section, new_section,
+                      old_section != NULL ? kv : NULL,
+                      old_section != NULL ? NULL : kv) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/*!
+ * Add changes for values of a section which exists in both files.
+ */
+static int diff_sections(struct inifile_diff *diff,
+                         const struct ini_section *old_section,
+                         const struct ini_section *new_section)
+{
+    struct values_lookup old_values;
+    struct values_lookup new_values;
+    int ret = -1;
+
+    if(values_lookup_init(&old_values, old_section) < 0)
+        return -1;
+
+    if(values_lookup_init(&new_values, new_section) < 0)
+        goto exit_free_old;
+
+    for(const struct ini_key_value_pair *kv = new_section->values_head; kv != NULL; kv = kv->next)
+    {
+        const struct ini_key_value_pair *old_kv =
+            values_lookup_find(&old_values, kv->key, kv->key_length);
+
+        if(old_kv == NULL)
+        {
+            if(add_change(diff, INIFILE_CHANGE_VALUE_ADDED,
+                          old_section, new_section, NULL, kv) < 0)
+                goto exit_free_new;
+        }
+        else if(!is_same_value(old_kv, kv))
+        {
+            if(add_change(diff, INIFILE_CHANGE_VALUE_CHANGED,
+                          old_section, new_section, old_kv, kv) < 0)
+                goto exit_free_new;
+        }
+    }
+
+    for(const struct ini_key_value_pair *kv = old_section->values_head; kv != NULL; kv = kv->next)
+    {
+        if(values_lookup_find(&new_values, kv->key, kv->key_length) == NULL &&
+           add_change(diff, INIFILE_CHANGE_VALUE_REMOVED,
+                      old_section, new_section, kv, NULL) < 0)
+            goto exit_free_new;
+    }
+
+    ret = 0;
+
+exit_free_new:
+    inifile_index_free(&new_values.index);
+
+exit_free_old:
+    inifile_index_free(&old_values.index);
+
+    return ret;
+}
+
+int inifile_compute_diff(struct inifile_diff *diff,
+                         const struct ini_file *old_inifile,
+                         const struct ini_file *new_inifile)
+{
+    msg_log_assert(diff != NULL);
+    msg_log_assert(old_inifile != NULL);
+    msg_log_assert(new_inifile != NULL);
+
+    diff->changes = NULL;
+    diff->number_of_changes = 0;
+    diff->capacity = 0;
+
+    struct sections_lookup old_sections;
+    struct sections_lookup new_sections;
+    int ret = -1;
+
+    if(sections_lookup_init(&old_sections, old_inifile) < 0)
+        goto exit_error;
+
+    if(sections_lookup_init(&new_sections, new_inifile) < 0)
+        goto exit_free_old;
+
+    for(const struct ini_section *s = new_inifile->sections_head; s != NULL; s = s->next)
+    {
+        const struct ini_section *old_section =
+            sections_lookup_find(&old_sections, s->name, s->name_length);
+
+        if(old_section == NULL
+           ? diff_whole_section(diff, NULL, s) < 0
+           : diff_sections(diff, old_section, s) < 0)
+            goto exit_free_new;
+    }
+
+    for(const struct ini_section *s = old_inifile->sections_head; s != NULL; s = s->next)
+    {
+        if(sections_lookup_find(&new_sections, s->name, s->name_length) == NULL &&
+           diff_whole_section(diff, s, NULL) < 0)
+            goto exit_free_new;
+    }
+
+    ret = 0;
+
+exit_free_new:
+    inifile_index_free(&new_sections.index);
+
+exit_free_old:
+    inifile_index_free(&old_sections.index);
+
+exit_error:
+    if(ret < 0)
+        inifile_diff_free(diff);
+
+    return ret;
+}
+
+void inifile_diff_free(struct inifile_diff *diff)
+{
+    msg_log_assert(diff != NULL);
+
+    free(diff->changes);
+    diff->changes = NULL;
+    diff->number_of_changes = 0;
+    diff->capacity = 0;
+}
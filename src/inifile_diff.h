@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#ifndef INIFILE_DIFF_H
+#define INIFILE_DIFF_H
+
+#include "inifile.h"
+
+/*!
+ * \addtogroup inifile_diff Differences between INI files
+ * \ingroup inifile
+ *
+ * Structural comparison of two INI file structures. The comparison uses
+ * temporary hash indices where the structures do not have indices of their
+ * own, so it takes time linear in the size of both structures.
+ */
+/*!@{*/
+
+/*!
+ * Kinds of differences found by #inifile_compute_diff().
+ */
+enum inifile_change_kind
+{
+    /*! Section exists only in the new file. */
+    INIFILE_CHANGE_SECTION_ADDED,
+
+    /*! Section exists only in the old file. */
+    INIFILE_CHANGE_SECTION_REMOVED,
+
+    /*! Key exists only in the new file. */
+    INIFILE_CHANGE_VALUE_ADDED,
+
+    /*! Key exists only in the old file. */
+    INIFILE_CHANGE_VALUE_REMOVED,
+
+    /*! Key exists in both files, but with different values. */
+    INIFILE_CHANGE_VALUE_CHANGED,
+};
+
+/*!
+ * Single difference between two INI files.
+ *
+ * All pointers point into the compared structures. Pointers to objects which
+ * do not exist in one of the files are \c NULL.
+ */
+struct inifile_change
+{
+    enum inifile_change_kind kind;
+
+    const struct ini_section *old_section;
+    const struct ini_section *new_section;
+
+    /*! Only for changes of values, \c NULL for changes of sections. */
+    const struct ini_key_value_pair *old_kv;
+    const struct ini_key_value_pair *new_kv;
+};
+
+/*!
+ * List of differences between two INI files.
+ *
+ * Changes are ordered by section as found in the new file, followed by all
+ * sections removed from the old file. Within each section, added and changed
+ * values are listed in order of the new file, followed by removed values in
+ * order of the old file. Each added or removed section is followed by one
+ * added or removed value for each of its keys, so that users interested in
+ * keys only do not need to look at changes of sections at all.
+ */
+struct inifile_diff
+{
+    struct inifile_change *changes;
+    size_t number_of_changes;
+
+    /*! \internal Number of allocated elements in \c changes. */
+    size_t capacity;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Determine differences between two INI files.
+ *
+ * \param diff
+ *     Structure to be filled by this function, must be freed by
+ *     #inifile_diff_free() after successful return.
+ *
+ * \param old_inifile, new_inifile
+ *     The structures to be compared. They must not be modified while
+ *     \p diff is in use.
+ *
+ * \returns
+ *     0 on success, -1 on error (out of memory).
+ */
+int inifile_compute_diff(struct inifile_diff *diff,
+                         const struct ini_file *old_inifile,
+                         const struct ini_file *new_inifile);
+
+/*!
+ * Free list of differences.
+ */
+void inifile_diff_free(struct inifile_diff *diff);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!@}*/
+
+#endif /* !INIFILE_DIFF_H */
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "inifile_index.h"
+#include "messages.h"
+
+#define INDEX_MIN_CAPACITY      ((size_t)8)
+
+void inifile_index_init(struct inifile_index *index)
+{
+    msg_log_assert(index != NULL);
+
+    index->slots = NULL;
+    index->capacity = 0;
+    index->count = 0;
+}
+
+size_t inifile_index_required_capacity(const struct inifile_index *index,
+                                       size_t additional)
+{
+    const size_t required = index->count + additional;
+
+    /* keep load factor at or below 3/4 */
+    if(required * 4 <= index->capacity * 3)
+        return 0;
+
+    size_t capacity =
+        index->capacity > 0 ? index->capacity * 2 : INDEX_MIN_CAPACITY;
+
+    while(required * 4 > capacity * 3)
+        capacity *= 2;
+
+    return capacity;
+}
+
+static void insert_into_slots(struct inifile_index_slot *slots, size_t mask,
+                              uint32_t hash, void *item)
+{
+    size_t pos = hash & mask;
+
+    while(slots[pos].item != NULL)
+        pos = (pos + 1) & mask;
+
+    slots[pos].item = item;
+    slots[pos].hash = hash;
+}
+
+struct inifile_index_slot *inifile_index_rehash(struct inifile_index *index,
+                                                struct inifile_index_slot *slots,
+                                                size_t capacity)
+{
+    msg_log_assert(index != NULL);
+    msg_log_assert(slots != NULL);
+    msg_log_assert(capacity > 0);
+    msg_log_assert((capacity & (capacity - 1)) == 0);
+    msg_log_assert(index->count * 4 <= capacity * 3);
+
+    for(size_t i = 0; i < capacity; ++i)
+        slots[i].item = NULL;
+
+    for(size_t i = 0; i < index->capacity; ++i)
+    {
+        if(index->slots[i].item != NULL)
+            insert_into_slots(slots, capacity - 1,
+                              index->slots[i].hash, index->slots[i].item);
+    }
+
+    struct inifile_index_slot *const old_slots = index->slots;
+
+    index->slots = slots;
+    index->capacity = capacity;
+
+    return old_slots;
+}
+
+void inifile_index_insert(struct inifile_index *index, uint32_t hash,
+                          void *item)
+{
+    msg_log_assert(index != NULL);
+    msg_log_assert(item != NULL);
+    msg_log_assert((index->count + 1) * 4 <= index->capacity * 3);
+
+    insert_into_slots(index->slots, index->capacity - 1, hash, item);
+    ++index->count;
+}
+
+static void *find_from(const struct inifile_index *index, uint32_t hash,
+                       size_t pos, size_t *cursor)
+{
+    const size_t mask = index->capacity - 1;
+
+    for(/* nothing */; index->slots[pos].item != NULL; pos = (pos + 1) & mask)
+    {
+        if(index->slots[pos].hash == hash)
+        {
+            *cursor = pos;
+            return index->slots[pos].item;
+        }
+    }
+
+    return NULL;
+}
+
+void *inifile_index_find_first(const struct inifile_index *index,
+                               uint32_t hash, size_t *cursor)
+{
+    msg_log_assert(index != NULL);
+    msg_log_assert(cursor != NULL);
+
+    if(index->count == 0)
+        return NULL;
+
+    return find_from(index, hash, hash & (index->capacity - 1), cursor);
+}
+
+void *inifile_index_find_next(const struct inifile_index *index,
+                              uint32_t hash, size_t *cursor)
+{
+    msg_log_assert(index != NULL);
+    msg_log_assert(cursor != NULL);
+
+    return find_from(index, hash, (*cursor + 1) & (index->capacity - 1),
+                     cursor);
+}
+
+bool inifile_index_remove(struct inifile_index *index, uint32_t hash,
+                          const void *item)
+{
+    msg_log_assert(index != NULL);
+
+    if(index->count == 0)
+        return false;
+
+    const size_t mask = index->capacity - 1;
+    size_t pos = hash & mask;
+
+    while(index->slots[pos].item != item)
+    {
+        if(index->slots[pos].item == NULL)
+            return false;
+
+        pos = (pos + 1) & mask;
+    }
+
+    /* backward shift deletion keeps probe sequences intact without the need
+     * for tombstones */
+    size_t next = pos;
+
+    while(true)
+    {
+        next = (next + 1) & mask;
+
+        if(index->slots[next].item == NULL)
+            break;
+
+        const size_t home = index->slots[next].hash & mask;
+
+        /* can the item at next be moved to the hole at pos? */
+        if(((next - home) & mask) >= ((next - pos) & mask))
+        {
+            index->slots[pos] = index->slots[next];
+            pos = next;
+        }
+    }
+
+    index->slots[pos].item = NULL;
+    --index->count;
+
+    return true;
+}
+
+int inifile_index_reserve(struct inifile_index *index, size_t additional)
+{
+    msg_log_assert(index != NULL);
+
+    const size_t capacity = inifile_index_required_capacity(index, additional);
+
+    if(capacity == 0)
+        return 0;
+
+    struct inifile_index_slot *slots =
+        malloc(inifile_index_slots_size(capacity));
+
+    if(slots == NULL)
+        return msg_out_of_memory("INI file index");
+
+    free(inifile_index_rehash(index, slots, capacity));
+
+    return 0;
+}
+
+void inifile_index_free(struct inifile_index *index)
+{
+    msg_log_assert(index != NULL);
+
+    free(index->slots);
+    inifile_index_init(index);
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#ifndef INIFILE_INDEX_H
+#define INIFILE_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * \addtogroup inifile_index Hash index for INI file structures
+ * \ingroup inifile
+ *
+ * Open addressing hash table (linear probing) storing pointers to items along
+ * with their hash values.
+ *
+ * The table knows nothing about the items it stores, so lookups return all
+ * items stored under a given hash value and callers must compare their keys.
+ * Memory for the slots is managed by the caller so that the table can be
+ * placed into any kind of storage (see #inifile_index_required_capacity()
+ * and #inifile_index_rehash()), or by the table itself via
+ * #inifile_index_reserve() and #inifile_index_free().
+ */
+/*!@{*/
+
+struct inifile_index_slot
+{
+    void *item;
+    uint32_t hash;
+};
+
+struct inifile_index
+{
+    struct inifile_index_slot *slots;
+    size_t capacity;
+    size_t count;
+};
+
+/*!
+ * Hash function used for all INI file indices (32 bit FNV-1a).
+ */
+static inline uint32_t inifile_hash(const char *data, size_t length)
+{
+    uint32_t hash = 2166136261U;
+
+    for(size_t i = 0; i < length; ++i)
+    {
+        hash ^= (uint8_t)data[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Initialize empty index. This function does not allocate any memory.
+ */
+void inifile_index_init(struct inifile_index *index);
+
+/*!
+ * Determine slot array capacity required for adding more items.
+ *
+ * \returns
+ *     The capacity to be passed to #inifile_index_rehash() before adding
+ *     \p additional items, or 0 in case the current slot array is big
+ *     enough.
+ */
+size_t inifile_index_required_capacity(const struct inifile_index *index,
+                                       size_t additional);
+
+/*!
+ * Size of a slot array of given capacity in bytes.
+ */
+static inline size_t inifile_index_slots_size(size_t capacity)
+{
+    return capacity * sizeof(struct inifile_index_slot);
+}
+
+/*!
+ * Move all items into a new slot array.
+ *
+ * \param index
+ *     The index to be rehashed.
+ *
+ * \param slots
+ *     New slot array of #inifile_index_slots_size() bytes for \p capacity
+ *     slots. The array does not need to be initialized.
+ *
+ * \param capacity
+ *     Number of slots in \p slots, must be a power of 2 and large enough to
+ *     hold all items currently stored in \p index.
+ *
+ * \returns
+ *     The previously used slot array (may be \c NULL), to be freed by the
+ *     caller.
+ */
+struct inifile_index_slot *inifile_index_rehash(struct inifile_index *index,
+                                                struct inifile_index_slot *slots,
+                                                size_t capacity);
+
+/*!
+ * Add item to index.
+ *
+ * The slot array must be large enough to hold the new item, see
+ * #inifile_index_required_capacity(). Items are not checked for duplicates.
+ */
+void inifile_index_insert(struct inifile_index *index, uint32_t hash,
+                          void *item);
+
+/*!
+ * Find first item with given hash value.
+ *
+ * \param index
+ *     The index to search in.
+ *
+ * \param hash
+ *     The hash value to search for.
+ *
+ * \param cursor
+ *     Iteration state for #inifile_index_find_next(), set by this function.
+ *
+ * \returns
+ *     An item with the given hash value, or \c NULL if there is none.
+ */
+void *inifile_index_find_first(const struct inifile_index *index,
+                               uint32_t hash, size_t *cursor);
+
+/*!
+ * Find next item with given hash value.
+ *
+ * Parameters as for #inifile_index_find_first(), the \p cursor must have been
+ * set by a previous call of #inifile_index_find_first().
+ */
+void *inifile_index_find_next(const struct inifile_index *index,
+                              uint32_t hash, size_t *cursor);
+
+/*!
+ * Remove item from index.
+ *
+ * \returns
+ *     True if the item was removed, false if it was not found.
+ */
+bool inifile_index_remove(struct inifile_index *index, uint32_t hash,
+                          const void *item);
+
+/*!
+ * Make sure that \p additional items can be added, allocate slots on the
+ * heap.
+ *
+ * \returns
+ *     0 on success, -1 if memory could not be allocated.
+ */
+int inifile_index_reserve(struct inifile_index *index, size_t additional);
+
+/*!
+ * Free slots allocated by #inifile_index_reserve().
+ */
+void inifile_index_free(struct inifile_index *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!@}*/
+
+#endif /* !INIFILE_INDEX_H */
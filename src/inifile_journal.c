@@ -0,0 +1,467 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#include "inifile_journal.h"
+#include "messages.h"
+#include "os.h"
+
+#define JOURNAL_SUFFIX          ".journal"
+
+/*! Magic at the start of a journal file, includes format version. */
+static const char journal_magic[8] = { 'I', 'N', 'I', 'J', 'R', 'N', 'L', 1 };
+
+/*!
+ * Header of a journal record.
+ *
+ * The header is followed by section name, key, and value, without
+ * zero-terminators. The CRC covers the lengths and the strings.
+ */
+struct record_header
+{
+    uint32_t crc;
+    uint32_t section_length;
+    uint32_t key_length;
+    uint32_t value_length;
+};
+
+/*! Records up to this size are assembled on the stack. */
+#define RECORD_STACK_BUFFER_SIZE    256
+
+/*!
+ * CRC-32 as used by Ethernet and zlib, four bits at a time.
+ */
+static uint32_t crc32_update(uint32_t crc, const void *data, size_t length)
+{
+    static const uint32_t table[16] =
+    {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+        0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+        0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+    };
+
+    const uint8_t *p = data;
+
+    crc = ~crc;
+
+    for(size_t i = 0; i < length; ++i)
+    {
+        crc ^= p[i];
+        crc = (crc >> 4) ^ table[crc & 0x0f];
+        crc = (crc >> 4) ^ table[crc & 0x0f];
+    }
+
+    return ~crc;
+}
+
+static uint32_t compute_record_crc(const struct record_header *header,
+                                   const char *payload)
+{
+    const uint32_t crc =
+        crc32_update(0, &header->section_length,
+                     sizeof(*header) - offsetof(struct record_header, section_length));
+
+    return crc32_update(crc, payload,
+                        (size_t)header->section_length + header->key_length +
+                        header->value_length);
+}
+
+/*!
+ * Apply change to in-memory INI file.
+ */
+static int apply_change(struct ini_file *inifile,
+                        const char *section_name, size_t section_length,
+                        const char *key, size_t key_length,
+                        const char *value, size_t value_length)
+{
+    struct ini_section *section =
+        inifile_new_section(inifile, section_name, section_length);
+
+    if(section == NULL)
+        return -1;
+
+    const struct ini_key_value_pair *kv = value_length > 0
+        ? inifile_section_store_value(section, key, key_length,
+                                      value, value_length)
+        : inifile_section_store_empty_value(section, key, key_length);
+
+    return kv != NULL ? 0 : -1;
+}
+
+/*!
+ * Apply all intact records of a journal file to the INI file.
+ *
+ * \returns
+ *     Number of records applied, or -1 on error.
+ */
+static long replay_journal(struct ini_file *inifile, const char *data,
+                           size_t length, const char *journal_filename)
+{
+    if(length < sizeof(journal_magic) ||
+       memcmp(data, journal_magic, sizeof(journal_magic)) != 0)
+    {
+        msg_error(0, LOG_WARNING,
+                  "Ignoring journal \"%s\" of unknown format", journal_filename);
+        return 0;
+    }
+
+    size_t pos = sizeof(journal_magic);
+    long count = 0;
+
+    while(pos < length)
+    {
+        struct record_header header;
+
+        if(length - pos < sizeof(header))
+            break;
+
+        memcpy(&header, data + pos, sizeof(header));
+
+        const char *payload = data + pos + sizeof(header);
+        const size_t payload_length =
+            (size_t)header.section_length + header.key_length +
+            header.value_length;
+
+        if(header.section_length == 0 || header.key_length == 0 ||
+           payload_length > length - pos - sizeof(header) ||
+           compute_record_crc(&header, payload) != header.crc)
+            break;
+
+        if(apply_change(inifile,
+                        payload, header.section_length,
+                        payload + header.section_length, header.key_length,
+                        payload + header.section_length + header.key_length,
+                        header.value_length) < 0)
+            return -1;
+
+        pos += sizeof(header) + payload_length;
+        ++count;
+    }
+
+    /* likely the last record written before power failure */
+    if(pos < length)
+        msg_error(0, LOG_WARNING,
+                  "Ignoring %zu bytes of damaged records in journal \"%s\"",
+                  length - pos, journal_filename);
+
+    return count;
+}
+
+/*!
+ * Truncate journal file, open it for writing.
+ */
+static int create_journal(struct inifile_journal *journal)
+{
+    journal->fd = os_file_new(journal->journal_filename);
+
+    if(journal->fd < 0)
+        return -1;
+
+    if(os_write_from_buffer(journal_magic, sizeof(journal_magic), journal->fd) < 0)
+    {
+        msg_error(0, LOG_ERR, "Failed writing journal \"%s\"",
+                  journal->journal_filename);
+        os_file_close(journal->fd);
+        journal->fd = -1;
+        return -1;
+    }
+
+    journal->journal_size = sizeof(journal_magic);
+    journal->unsynced_records = 0;
+
+    return 0;
+}
+
+static int compact_journal(struct inifile_journal *journal)
+{
+    /* the journal is replayed again if we fail after writing the INI file,
+     * which is fine because replaying records twice is harmless */
+    if(inifile_write_to_file_atomically(&journal->inifile, journal->filename) < 0)
+        return -1;
+
+    journal->is_dirty = false;
+
+    if(journal->fd >= 0)
+        os_file_close(journal->fd);
+
+    return create_journal(journal);
+}
+
+static char *make_journal_filename(const char *filename)
+{
+    const size_t filename_length = strlen(filename);
+    char *name = malloc(filename_length + sizeof(JOURNAL_SUFFIX));
+
+    if(name == NULL)
+    {
+        msg_out_of_memory("journal file name");
+        return NULL;
+    }
+
+    memcpy(name, filename, filename_length);
+    memcpy(name + filename_length, JOURNAL_SUFFIX, sizeof(JOURNAL_SUFFIX));
+
+    return name;
+}
+
+int inifile_journal_open(struct inifile_journal *journal, const char *filename,
+                         size_t records_per_sync, size_t compaction_threshold)
+{
+    msg_log_assert(journal != NULL);
+    msg_log_assert(filename != NULL);
+
+    journal->fd = -1;
+    journal->is_dirty = false;
+    journal->journal_size = 0;
+    journal->unsynced_records = 0;
+    journal->records_per_sync = records_per_sync;
+    journal->compaction_threshold = compaction_threshold;
+    journal->filename = strdup(filename);
+    journal->journal_filename = make_journal_filename(filename);
+
+    if(journal->filename == NULL || journal->journal_filename == NULL)
+    {
+        if(journal->filename == NULL)
+            msg_out_of_memory("INI file name");
+
+        free(journal->filename);
+        free(journal->journal_filename);
+        return -1;
+    }
+
+    /* missing INI file and missing journal are not worth an error message */
+    bool was_suppressed = os_suppress_error_messages(true);
+    const int parse_result = inifile_parse_from_file(&journal->inifile, filename);
+    os_suppress_error_messages(was_suppressed);
+
+    /* structure has been freed already in case of parse errors */
+    if(parse_result < 0)
+        goto error_free_names;
+
+    struct os_mapped_file_data mapped;
+
+    was_suppressed = os_suppress_error_messages(true);
+    const bool have_journal =
+        os_map_file_to_memory(&mapped, journal->journal_filename) == 0;
+    os_suppress_error_messages(was_suppressed);
+
+    long replayed = 0;
+
+    if(have_journal)
+    {
+        replayed = replay_journal(&journal->inifile, mapped.ptr, mapped.length,
+                                  journal->journal_filename);
+        os_unmap_file(&mapped);
+
+        if(replayed < 0)
+            goto error_free_inifile;
+    }
+
+    /* old records must be in the INI file before the journal is truncated */
+    if(replayed > 0
+       ? compact_journal(journal) < 0
+       : create_journal(journal) < 0)
+        goto error_free_inifile;
+
+    return 0;
+
+error_free_inifile:
+    inifile_free(&journal->inifile);
+
+error_free_names:
+    free(journal->filename);
+    free(journal->journal_filename);
+
+    return -1;
+}
+
+int inifile_journal_store_value(struct inifile_journal *journal,
+                                const char *section, size_t section_length,
+                                const char *key, size_t key_length,
+                                const char *value, size_t value_length)
+{
+    msg_log_assert(journal != NULL);
+    msg_log_assert(section != NULL);
+    msg_log_assert(key != NULL);
+    msg_log_assert(value != NULL);
+
+    if(section_length == 0)
+        section_length = strlen(section);
+
+    if(key_length == 0)
+        key_length = strlen(key);
+
+    if(value_length == 0)
+        value_length = strlen(value);
+
+    const struct ini_section *existing_section =
+        inifile_find_section(&journal->inifile, section, section_length);
+    const struct ini_key_value_pair *existing_kv = existing_section != NULL
+        ? inifile_section_lookup_kv_pair(existing_section, key, key_length)
+        : NULL;
+
+    if(existing_kv != NULL && existing_kv->value_length == value_length &&
+       memcmp(existing_kv->value, value, value_length) == 0)
+        return 0;
+
+    if(section_length > UINT32_MAX || key_length > UINT32_MAX ||
+       value_length > UINT32_MAX)
+    {
+        msg_error(EFBIG, LOG_ERR, "Value too large for journal");
+        return -1;
+    }
+
+    /* the INI file is up-to-date if the journal could not be recreated
+     * after compaction, so we may simply try again; changes which could
+     * not be journaled must be written to the INI file first */
+    if(journal->fd < 0 &&
+       (journal->is_dirty
+        ? compact_journal(journal)
+        : create_journal(journal)) < 0)
+        return -1;
+
+    struct record_header header =
+    {
+        .section_length = (uint32_t)section_length,
+        .key_length = (uint32_t)key_length,
+        .value_length = (uint32_t)value_length,
+    };
+    const size_t record_size =
+        sizeof(header) + section_length + key_length + value_length;
+
+    char stack_buffer[RECORD_STACK_BUFFER_SIZE];
+    char *record = record_size <= sizeof(stack_buffer)
+        ? stack_buffer
+        : malloc(record_size);
+
+    if(record == NULL)
+        return msg_out_of_memory("journal record");
+
+    char *payload = record + sizeof(header);
+    memcpy(payload, section, section_length);
+    memcpy(payload + section_length, key, key_length);
+
+    memcpy(payload + section_length + key_length, value, value_length);
+
+    header.crc = compute_record_crc(&header, payload);
+    memcpy(record, &header, sizeof(header));
+
+    /* change is applied in memory first so that there is never a record in
+     * the journal for a change which has failed */
+    int write_result = -1;
+
+    if(apply_change(&journal->inifile, section, section_length,
+                    key, key_length, value, value_length) == 0)
+    {
+        write_result = os_write_from_buffer(record, record_size, journal->fd);
+
+        if(write_result < 0)
+        {
+            msg_error(0, LOG_ERR, "Failed writing journal \"%s\"",
+                      journal->journal_filename);
+
+            /* the record may be torn, and replay would stop there and drop
+             * all records appended after it */
+            os_file_close(journal->fd);
+            journal->fd = -1;
+            journal->is_dirty = true;
+        }
+    }
+
+    if(record != stack_buffer)
+        free(record);
+
+    if(write_result < 0)
+        return -1;
+
+    journal->journal_size += record_size;
+    ++journal->unsynced_records;
+
+    if(journal->compaction_threshold > 0 &&
+       journal->journal_size >= journal->compaction_threshold)
+    {
+        /* failure has been logged, but the record is in the journal */
+        if(compact_journal(journal) == 0)
+            return 0;
+    }
+
+    if(journal->records_per_sync > 0 &&
+       journal->unsynced_records >= journal->records_per_sync)
+        return inifile_journal_sync(journal);
+
+    return 0;
+}
+
+int inifile_journal_sync(struct inifile_journal *journal)
+{
+    msg_log_assert(journal != NULL);
+
+    if(journal->unsynced_records == 0 || journal->fd < 0)
+        return 0;
+
+    if(os_file_sync(journal->fd) < 0)
+        return -1;
+
+    journal->unsynced_records = 0;
+
+    return 0;
+}
+
+int inifile_journal_compact(struct inifile_journal *journal)
+{
+    msg_log_assert(journal != NULL);
+
+    if(!journal->is_dirty && journal->fd >= 0 &&
+       journal->journal_size <= sizeof(journal_magic))
+        return 0;
+
+    return compact_journal(journal);
+}
+
+void inifile_journal_close(struct inifile_journal *journal)
+{
+    msg_log_assert(journal != NULL);
+
+    /* failure has been logged, nothing else we could do */
+    if(journal->is_dirty)
+        compact_journal(journal);
+
+    if(journal->fd >= 0)
+        os_file_close(journal->fd);
+
+    inifile_free(&journal->inifile);
+    free(journal->filename);
+    free(journal->journal_filename);
+
+    journal->fd = -1;
+    journal->filename = NULL;
+    journal->journal_filename = NULL;
+}
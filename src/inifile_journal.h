@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#ifndef INIFILE_JOURNAL_H
+#define INIFILE_JOURNAL_H
+
+#include <stddef.h>
+
+#include "inifile.h"
+
+/*!
+ * \addtogroup inifile_journal Append-only journal of INI file changes
+ * \ingroup inifile
+ *
+ * For values which are changed frequently, rewriting the whole INI file on
+ * each change is expensive. A journal keeps the INI file in memory and
+ * appends each change as a small binary record to a journal file next to
+ * the INI file, named like the INI file with suffix \c .journal. Records are
+ * protected by a CRC-32 so that a record torn by power failure is detected
+ * and ignored, along with anything following it.
+ *
+ * The journal is synced to storage after a configurable number of records,
+ * so that the cost of \c fsync() is shared by several changes. Records
+ * written since the last sync may be lost in case of power failure.
+ *
+ * Compaction writes the in-memory INI file atomically to the INI file and
+ * starts a new, empty journal. It is done when the journal is opened, when
+ * the journal exceeds a configurable size, and on request by
+ * #inifile_journal_compact(), e.g., from an idle handler. On open, the INI
+ * file is parsed and the journal is replayed over it.
+ *
+ * Journals are not thread-safe.
+ */
+/*!@{*/
+
+/*!
+ * Opened journal.
+ *
+ * The structure is allocated by the caller and set up by
+ * #inifile_journal_open().
+ */
+struct inifile_journal
+{
+    /*!
+     * Current contents of the INI file, including all journaled changes.
+     *
+     * Read-only for users, changes must be made through
+     * #inifile_journal_store_value().
+     */
+    struct ini_file inifile;
+
+    /*! \internal Names of the INI file and of the journal file. */
+    char *filename;
+    char *journal_filename;
+
+    /*! \internal Journal file opened for writing, -1 after errors. */
+    int fd;
+
+    /*!
+     * \internal Set if a record could not be written to the journal.
+     *
+     * The in-memory INI file contains changes which are neither in the INI
+     * file nor in the journal, so that the INI file must be written before
+     * a new journal may be started.
+     */
+    bool is_dirty;
+
+    /*! \internal Size of the journal file in bytes. */
+    size_t journal_size;
+
+    /*! \internal Number of records written since the last sync. */
+    size_t unsynced_records;
+
+    /*! \internal Configuration passed to #inifile_journal_open(). */
+    size_t records_per_sync;
+    size_t compaction_threshold;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Open journal for an INI file.
+ *
+ * The INI file is parsed, a left over journal is replayed over it, and the
+ * journal is compacted.
+ *
+ * \param journal
+ *     Structure to be set up by this function, must be freed by
+ *     #inifile_journal_close() after successful return.
+ *
+ * \param filename
+ *     Name of the INI file. A missing file is treated as an empty file.
+ *
+ * \param records_per_sync
+ *     Sync the journal to storage after this many records. Pass 0 to sync
+ *     only on #inifile_journal_sync(), compaction, and close.
+ *
+ * \param compaction_threshold
+ *     Compact the journal when it grows to this many bytes. Pass 0 to
+ *     compact only on open and on #inifile_journal_compact().
+ *
+ * \returns
+ *     0 on success, -1 on error.
+ */
+int inifile_journal_open(struct inifile_journal *journal, const char *filename,
+                         size_t records_per_sync, size_t compaction_threshold);
+
+/*!
+ * Store value in the INI file, append change to the journal.
+ *
+ * Parameters \p section, \p key, and \p value are as for
+ * #inifile_new_section() and #inifile_section_store_value(), except that
+ * empty values may be passed as well. Storing a value equal to the current
+ * value does not write anything.
+ *
+ * \returns
+ *     0 on success, -1 on error. In case of error, the value is not in the
+ *     journal. The INI file structure may still contain the new value if
+ *     only writing the journal has failed, in which case the journal is
+ *     closed and the value is written to the INI file by the next
+ *     compaction, which is done by the next call of this function,
+ *     #inifile_journal_compact(), or #inifile_journal_close() at the latest.
+ */
+int inifile_journal_store_value(struct inifile_journal *journal,
+                                const char *section, size_t section_length,
+                                const char *key, size_t key_length,
+                                const char *value, size_t value_length);
+
+/*!
+ * Sync records written since the last sync to storage.
+ *
+ * \returns
+ *     0 on success, -1 on error.
+ */
+int inifile_journal_sync(struct inifile_journal *journal);
+
+/*!
+ * Write INI file, start with an empty journal.
+ *
+ * Nothing is done if the journal is empty.
+ *
+ * \returns
+ *     0 on success, -1 on error. In case of error, the journal is kept.
+ */
+int inifile_journal_compact(struct inifile_journal *journal);
+
+/*!
+ * Sync and close journal, free the INI file structure.
+ *
+ * The journal is not compacted, this is done next time it is opened.
+ * Changes which could not be written to the journal are written to the INI
+ * file, though.
+ */
+void inifile_journal_close(struct inifile_journal *journal);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!@}*/
+
+#endif /* !INIFILE_JOURNAL_H */
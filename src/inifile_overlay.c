@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "inifile_overlay.h"
+#include "messages.h"
+
+static struct inifile_overlay_section *
+find_section(const struct inifile_overlay *overlay,
+             const char *name, size_t name_length)
+{
+    const uint32_t hash = inifile_hash(name, name_length);
+    size_t cursor;
+
+    for(struct inifile_overlay_section *s =
+            inifile_index_find_first(&overlay->sections_index, hash, &cursor);
+        s != NULL;
+        s = inifile_index_find_next(&overlay->sections_index, hash, &cursor))
+    {
+        if(s->name_length == name_length && memcmp(s->name, name, name_length) == 0)
+            return s;
+    }
+
+    return NULL;
+}
+
+static struct inifile_overlay_value *
+find_value(const struct inifile_overlay_section *section,
+           const char *key, size_t key_length)
+{
+    const uint32_t hash = inifile_hash(key, key_length);
+    size_t cursor;
+
+    for(struct inifile_overlay_value *v =
+            inifile_index_find_first(&section->values_index, hash, &cursor);
+        v != NULL;
+        v = inifile_index_find_next(&section->values_index, hash, &cursor))
+    {
+        if(v->kv->key_length == key_length &&
+           memcmp(v->kv->key, key, key_length) == 0)
+            return v;
+    }
+
+    return NULL;
+}
+
+static size_t count_values(const struct ini_section *section)
+{
+    size_t count = 0;
+
+    for(const struct ini_key_value_pair *kv = section->values_head; kv != NULL; kv = kv->next)
+        ++count;
+
+    return count;
+}
+
+/*!
+ * Set up merged sections, determine maximum number of values for each.
+ *
+ * Sections are stored in \p sections, their maximum numbers of values are
+ * temporarily stored in their \c number_of_values fields.
+ */
+static void merge_sections(struct inifile_overlay *overlay,
+                           struct inifile_overlay_section *sections,
+                           const struct ini_file *const *layers,
+                           size_t number_of_layers)
+{
+    for(size_t l = 0; l < number_of_layers; ++l)
+    {
+        if(layers[l] == NULL)
+            continue;
+
+        for(const struct ini_section *s = layers[l]->sections_head; s != NULL; s = s->next)
+        {
+            struct inifile_overlay_section *merged =
+                find_section(overlay, s->name, s->name_length);
+
+            if(merged == NULL)
+            {
+                merged = &sections[overlay->number_of_sections++];
+                merged->name = s->name;
+                merged->name_length = s->name_length;
+                merged->values = NULL;
+                merged->number_of_values = 0;
+                inifile_index_init(&merged->values_index);
+
+                inifile_index_insert(&overlay->sections_index,
+                                     inifile_hash(s->name, s->name_length),
+                                     merged);
+            }
+
+            merged->number_of_values += count_values(s);
+        }
+    }
+}
+
+/*!
+ * Fill in winning values of all sections.
+ */
+static void merge_values(struct inifile_overlay *overlay,
+                         const struct ini_file *const *layers,
+                         size_t number_of_layers)
+{
+    for(size_t l = 0; l < number_of_layers; ++l)
+    {
+        if(layers[l] == NULL)
+            continue;
+
+        for(const struct ini_section *s = layers[l]->sections_head; s != NULL; s = s->next)
+        {
+            struct inifile_overlay_section *merged =
+                find_section(overlay, s->name, s->name_length);
+
+            msg_log_assert(merged != NULL);
+
+            struct inifile_overlay_value *values =
+                (struct inifile_overlay_value *)(uintptr_t)merged->values;
+
+            for(const struct ini_key_value_pair *kv = s->values_head; kv != NULL; kv = kv->next)
+            {
+                struct inifile_overlay_value *v =
+                    find_value(merged, kv->key, kv->key_length);
+
+                if(v == NULL)
+                {
+                    v = &values[merged->number_of_values++];
+                    inifile_index_insert(&merged->values_index,
+                                         inifile_hash(kv->key, kv->key_length),
+                                         v);
+                }
+
+                v->kv = kv;
+                v->layer = l;
+            }
+        }
+    }
+}
+
+int inifile_overlay_init(struct inifile_overlay *overlay,
+                         const struct ini_file *const *layers,
+                         size_t number_of_layers)
+{
+    msg_log_assert(overlay != NULL);
+    msg_log_assert(layers != NULL || number_of_layers == 0);
+
+    overlay->sections = NULL;
+    overlay->number_of_sections = 0;
+    inifile_index_init(&overlay->sections_index);
+
+    size_t max_sections = 0;
+    size_t max_values = 0;
+
+    for(size_t l = 0; l < number_of_layers; ++l)
+    {
+        if(layers[l] == NULL)
+            continue;
+
+        for(const struct ini_section *s = layers[l]->sections_head; s != NULL; s = s->next)
+        {
+            ++max_sections;
+            max_values += count_values(s);
+        }
+    }
+
+    if(max_sections == 0)
+        return 0;
+
+    /* sections and values in one block */
+    struct inifile_overlay_section *sections =
+        malloc(max_sections * sizeof(*sections) +
+               max_values * sizeof(struct inifile_overlay_value));
+
+    if(sections == NULL)
+        return msg_out_of_memory("INI file overlay");
+
+    overlay->sections = sections;
+
+    if(inifile_index_reserve(&overlay->sections_index, max_sections) < 0)
+    {
+        inifile_overlay_free(overlay);
+        return -1;
+    }
+
+    merge_sections(overlay, sections, layers, number_of_layers);
+
+    struct inifile_overlay_value *values =
+        (struct inifile_overlay_value *)&sections[max_sections];
+
+    for(size_t i = 0; i < overlay->number_of_sections; ++i)
+    {
+        struct inifile_overlay_section *s = &sections[i];
+
+        if(inifile_index_reserve(&s->values_index, s->number_of_values) < 0)
+        {
+            inifile_overlay_free(overlay);
+            return -1;
+        }
+
+        s->values = values;
+        values += s->number_of_values;
+        s->number_of_values = 0;
+    }
+
+    merge_values(overlay, layers, number_of_layers);
+
+    return 0;
+}
+
+void inifile_overlay_free(struct inifile_overlay *overlay)
+{
+    msg_log_assert(overlay != NULL);
+
+    struct inifile_overlay_section *sections =
+        (struct inifile_overlay_section *)(uintptr_t)overlay->sections;
+
+    for(size_t i = 0; i < overlay->number_of_sections; ++i)
+        inifile_index_free(&sections[i].values_index);
+
+    inifile_index_free(&overlay->sections_index);
+    free(sections);
+
+    overlay->sections = NULL;
+    overlay->number_of_sections = 0;
+}
+
+const struct inifile_overlay_section *
+inifile_overlay_find_section(const struct inifile_overlay *overlay,
+                             const char *section_name,
+                             size_t section_name_length)
+{
+    msg_log_assert(overlay != NULL);
+    msg_log_assert(section_name != NULL);
+
+    if(section_name_length == 0)
+        section_name_length = strlen(section_name);
+
+    return find_section(overlay, section_name, section_name_length);
+}
+
+const struct inifile_overlay_value *
+inifile_overlay_section_lookup_value(const struct inifile_overlay_section *section,
+                                     const char *key, size_t key_length)
+{
+    msg_log_assert(section != NULL);
+    msg_log_assert(key != NULL);
+
+    if(key_length == 0)
+        key_length = strlen(key);
+
+    return find_value(section, key, key_length);
+}
+
+const struct ini_key_value_pair *
+inifile_overlay_lookup_kv_pair(const struct inifile_overlay *overlay,
+                               const char *section_name,
+                               size_t section_name_length,
+                               const char *key, size_t key_length)
+{
+    const struct inifile_overlay_section *section =
+        inifile_overlay_find_section(overlay, section_name, section_name_length);
+
+    if(section == NULL)
+        return NULL;
+
+    const struct inifile_overlay_value *value =
+        inifile_overlay_section_lookup_value(section, key, key_length);
+
+    return value != NULL ? value->kv : NULL;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#ifndef INIFILE_OVERLAY_H
+#define INIFILE_OVERLAY_H
+
+#include <stddef.h>
+
+#include "inifile.h"
+#include "inifile_index.h"
+
+/*!
+ * \addtogroup inifile_overlay Layered view of multiple INI files
+ * \ingroup inifile
+ *
+ * An overlay stacks several parsed INI files, e.g., factory defaults, OEM
+ * settings, and user settings. Values in upper layers hide values with the
+ * same section and key in lower layers.
+ *
+ * When the overlay is set up, the winning value of each key is determined
+ * once and stored in hash indices, so that lookups take constant time
+ * regardless of the number of layers. The overlay only points to the
+ * sections and key/value pairs of the layers, nothing is copied. The layers
+ * must therefore not be modified or freed while the overlay is in use.
+ */
+/*!@{*/
+
+/*!
+ * Winning value of a key in an overlay.
+ */
+struct inifile_overlay_value
+{
+    /*! The key/value pair in the layer it was taken from. */
+    const struct ini_key_value_pair *kv;
+
+    /*! Index of the layer the value was taken from, 0 for the bottom layer. */
+    size_t layer;
+};
+
+/*!
+ * Merged section of an overlay.
+ *
+ * Values are in order of first appearance of their keys, starting with the
+ * bottom layer.
+ */
+struct inifile_overlay_section
+{
+    const char *name;
+    size_t name_length;
+    const struct inifile_overlay_value *values;
+    size_t number_of_values;
+
+    /*! \internal Index of values by key. */
+    struct inifile_index values_index;
+};
+
+/*!
+ * Layered view of multiple INI files.
+ *
+ * Sections are in order of first appearance of their names, starting with
+ * the bottom layer. All fields are read-only for users.
+ */
+struct inifile_overlay
+{
+    const struct inifile_overlay_section *sections;
+    size_t number_of_sections;
+
+    /*! \internal Index of sections by name. */
+    struct inifile_index sections_index;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Set up overlay of INI files.
+ *
+ * \param overlay
+ *     Structure to be set up by this function, must be freed by
+ *     #inifile_overlay_free() after successful return.
+ *
+ * \param layers
+ *     Parsed INI files, bottom layer first. Entries may be \c NULL for
+ *     missing layers.
+ *
+ * \param number_of_layers
+ *     Number of entries in \p layers.
+ *
+ * \returns
+ *     0 on success, -1 on error (out of memory).
+ */
+int inifile_overlay_init(struct inifile_overlay *overlay,
+                         const struct ini_file *const *layers,
+                         size_t number_of_layers);
+
+/*!
+ * Free resources associated with an overlay.
+ *
+ * The layers are not touched.
+ */
+void inifile_overlay_free(struct inifile_overlay *overlay);
+
+/*!
+ * Find merged section by name.
+ *
+ * \returns
+ *     The section, or \c NULL if none of the layers contains the section.
+ */
+const struct inifile_overlay_section *
+inifile_overlay_find_section(const struct inifile_overlay *overlay,
+                             const char *section_name,
+                             size_t section_name_length);
+
+/*!
+ * Look up winning value of a key in a merged section.
+ *
+ * \returns
+ *     The value, or \c NULL if none of the layers contains the key in this
+ *     section.
+ */
+const struct inifile_overlay_value *
+inifile_overlay_section_lookup_value(const struct inifile_overlay_section *section,
+                                     const char *key, size_t key_length);
+
+/*!
+ * Look up winning key/value pair by section name and key.
+ *
+ * Combination of #inifile_overlay_find_section() and
+ * #inifile_overlay_section_lookup_value(). Lengths may be 0, in which case
+ * they are determined by \c strlen().
+ *
+ * \returns
+ *     The key/value pair in the topmost layer containing the key, or
+ *     \c NULL if there is no such layer.
+ */
+const struct ini_key_value_pair *
+inifile_overlay_lookup_kv_pair(const struct inifile_overlay *overlay,
+                               const char *section_name,
+                               size_t section_name_length,
+                               const char *key, size_t key_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!@}*/
+
+#endif /* !INIFILE_OVERLAY_H */
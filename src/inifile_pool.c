@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "inifile_pool.h"
+#include "messages.h"
+
+#define POOL_MIN_BLOCK_SIZE     ((size_t)4 * 1024)
+#define POOL_MAX_BLOCK_SIZE     ((size_t)256 * 1024)
+
+struct inifile_pool_block
+{
+    struct inifile_pool_block *next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+};
+
+/*!
+ * String stored in the pool.
+ */
+struct pooled_string
+{
+    size_t length;
+    char string[];
+};
+
+void inifile_string_pool_init(struct inifile_string_pool *pool)
+{
+    msg_log_assert(pool != NULL);
+
+    inifile_index_init(&pool->index);
+    pool->blocks = NULL;
+    pool->next_block_size = POOL_MIN_BLOCK_SIZE;
+    pthread_mutex_init(&pool->lock, NULL);
+}
+
+void inifile_string_pool_free(struct inifile_string_pool *pool)
+{
+    msg_log_assert(pool != NULL);
+
+    inifile_index_free(&pool->index);
+
+    while(pool->blocks != NULL)
+    {
+        struct inifile_pool_block *next = pool->blocks->next;
+        free(pool->blocks);
+        pool->blocks = next;
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+}
+
+static struct pooled_string *find_string(const struct inifile_string_pool *pool,
+                                         uint32_t hash,
+                                         const char *string, size_t length)
+{
+    size_t cursor;
+
+    for(struct pooled_string *ps = inifile_index_find_first(&pool->index, hash, &cursor);
+        ps != NULL;
+        ps = inifile_index_find_next(&pool->index, hash, &cursor))
+    {
+        if(ps->length == length && memcmp(ps->string, string, length) == 0)
+            return ps;
+    }
+
+    return NULL;
+}
+
+/*!
+ * Allocate string from pool blocks, same strategy as the INI file arena.
+ */
+static struct pooled_string *alloc_string(struct inifile_string_pool *pool,
+                                          size_t length)
+{
+    const size_t alignment = _Alignof(struct pooled_string);
+    const size_t size = sizeof(struct pooled_string) + length + 1;
+    struct inifile_pool_block *block = pool->blocks;
+
+    if(block != NULL)
+    {
+        const size_t offset = (block->used + alignment - 1) & ~(alignment - 1);
+
+        if(offset <= block->size && block->size - offset >= size)
+        {
+            block->used = offset + size;
+            return (struct pooled_string *)((char *)block->data + offset);
+        }
+    }
+
+    const bool is_large = size > pool->next_block_size / 4;
+    const size_t block_size = is_large ? size : pool->next_block_size;
+
+    struct inifile_pool_block *new_block =
+        malloc(sizeof(*new_block) + block_size);
+
+    if(new_block == NULL)
+    {
+        msg_error(errno, LOG_ERR, "malloc() failed for %zu bytes",
+                  sizeof(*new_block) + block_size);
+        return NULL;
+    }
+
+    new_block->size = block_size;
+    new_block->used = size;
+
+    if(is_large && block != NULL)
+    {
+        new_block->next = block->next;
+        block->next = new_block;
+    }
+    else
+    {
+        new_block->next = block;
+        pool->blocks = new_block;
+
+        pool->next_block_size *= 2;
+
+        if(pool->next_block_size > POOL_MAX_BLOCK_SIZE)
+            pool->next_block_size = POOL_MAX_BLOCK_SIZE;
+    }
+
+    return (struct pooled_string *)new_block->data;
+}
+
+const char *inifile_string_pool_intern(struct inifile_string_pool *pool,
+                                       const char *string, size_t length)
+{
+    msg_log_assert(pool != NULL);
+    msg_log_assert(string != NULL);
+
+    if(length == 0)
+        length = strlen(string);
+
+    const uint32_t hash = inifile_hash(string, length);
+
+    pthread_mutex_lock(&pool->lock);
+
+    struct pooled_string *ps = find_string(pool, hash, string, length);
+
+    if(ps == NULL && inifile_index_reserve(&pool->index, 1) == 0)
+    {
+        ps = alloc_string(pool, length);
+
+        if(ps != NULL)
+        {
+            ps->length = length;
+            memcpy(ps->string, string, length);
+            ps->string[length] = '\0';
+            inifile_index_insert(&pool->index, hash, ps);
+        }
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return ps != NULL ? ps->string : NULL;
+}
+
+const char *inifile_string_pool_find(struct inifile_string_pool *pool,
+                                     const char *string, size_t length)
+{
+    msg_log_assert(pool != NULL);
+    msg_log_assert(string != NULL);
+
+    if(length == 0)
+        length = strlen(string);
+
+    const uint32_t hash = inifile_hash(string, length);
+
+    pthread_mutex_lock(&pool->lock);
+    const struct pooled_string *ps = find_string(pool, hash, string, length);
+    pthread_mutex_unlock(&pool->lock);
+
+    return ps != NULL ? ps->string : NULL;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#ifndef INIFILE_POOL_H
+#define INIFILE_POOL_H
+
+#include <pthread.h>
+
+#include "inifile_index.h"
+
+/*!
+ * \addtogroup inifile_pool Interned strings shared by INI files
+ * \ingroup inifile
+ *
+ * A string pool stores each distinct string exactly once. INI file
+ * structures set up with a pool take their section names and keys from the
+ * pool instead of copying them, so that files with many sections holding
+ * the same set of keys (or several files with the same keys) share a single
+ * copy of each name. Names and keys taken from the same pool are equal if
+ * and only if their pointers are equal.
+ *
+ * Strings are never removed from a pool, they are freed along with the
+ * whole pool. The pool must outlive all INI file structures using it. A
+ * pool may be used from several threads at the same time.
+ */
+/*!@{*/
+
+/*!
+ * \internal
+ * Memory block holding interned strings.
+ */
+struct inifile_pool_block;
+
+/*!
+ * Pool of interned strings.
+ *
+ * All fields are internal. The structure is allocated by the caller and set
+ * up by #inifile_string_pool_init().
+ */
+struct inifile_string_pool
+{
+    /*! \internal Index of all strings in the pool. */
+    struct inifile_index index;
+
+    /*! \internal Memory blocks, block with free space is at the head. */
+    struct inifile_pool_block *blocks;
+
+    /*! \internal Size of next block allocated for strings. */
+    size_t next_block_size;
+
+    /*! \internal Protects all other fields. */
+    pthread_mutex_t lock;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Set up empty string pool. This function does not allocate any memory.
+ */
+void inifile_string_pool_init(struct inifile_string_pool *pool);
+
+/*!
+ * Free all strings in the pool.
+ *
+ * There must be no INI file structure left using the pool.
+ */
+void inifile_string_pool_free(struct inifile_string_pool *pool);
+
+/*!
+ * Get interned copy of a string, add it to the pool if necessary.
+ *
+ * \param pool
+ *     The pool the string should be taken from.
+ *
+ * \param string, length
+ *     String and its length in number of characters, without the trailing
+ *     zero-terminator. The function will call \c strlen() for \p string in
+ *     case 0 is passed as \p length. The string does not need to be
+ *     zero-terminated if its length is passed.
+ *
+ * \returns
+ *     The zero-terminated copy of \p string owned by \p pool, or \c NULL in
+ *     case no memory could be allocated.
+ */
+const char *inifile_string_pool_intern(struct inifile_string_pool *pool,
+                                       const char *string, size_t length);
+
+/*!
+ * Get interned copy of a string without adding it to the pool.
+ *
+ * Parameters as for #inifile_string_pool_intern().
+ *
+ * \returns
+ *     The copy of \p string owned by \p pool, or \c NULL in case the string
+ *     is not in the pool. In the latter case, the string is not used as
+ *     section name or key by any INI file structure using the pool.
+ */
+const char *inifile_string_pool_find(struct inifile_string_pool *pool,
+                                     const char *string, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!@}*/
+
+#endif /* !INIFILE_POOL_H */
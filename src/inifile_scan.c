@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "inifile_scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_WITH_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SCAN_WITH_NEON 1
+#include <arm_neon.h>
+#endif
+
+typedef size_t (*scan_either_fn)(const char *buffer, size_t size, char a, char b);
+typedef size_t (*scan_nonblank_fn)(const char *buffer, size_t size);
+
+static inline bool is_blank(char ch)
+{
+    return ch == ' ' || ch == '\t';
+}
+
+static size_t scan_either_scalar(const char *buffer, size_t size, char a, char b)
+{
+    size_t i;
+
+    for(i = 0; i < size; ++i)
+    {
+        if(buffer[i] == a || buffer[i] == b)
+            break;
+    }
+
+    return i;
+}
+
+static size_t scan_nonblank_scalar(const char *buffer, size_t size)
+{
+    size_t i;
+
+    for(i = 0; i < size; ++i)
+    {
+        if(!is_blank(buffer[i]))
+            break;
+    }
+
+    return i;
+}
+
+#ifdef SCAN_WITH_X86
+
+__attribute__((target("sse2")))
+static size_t scan_either_sse2(const char *buffer, size_t size, char a, char b)
+{
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    size_t i;
+
+    for(i = 0; i + 16 <= size; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *)(buffer + i));
+        const unsigned int mask =
+            (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va),
+                                                         _mm_cmpeq_epi8(v, vb)));
+
+        if(mask != 0)
+            return i + (unsigned int)__builtin_ctz(mask);
+    }
+
+    return i + scan_either_scalar(buffer + i, size - i, a, b);
+}
+
+__attribute__((target("sse2")))
+static size_t scan_nonblank_sse2(const char *buffer, size_t size)
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    size_t i;
+
+    for(i = 0; i + 16 <= size; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *)(buffer + i));
+        const unsigned int mask =
+            ~(unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, space),
+                                                          _mm_cmpeq_epi8(v, tab))) & 0xffffU;
+
+        if(mask != 0)
+            return i + (unsigned int)__builtin_ctz(mask);
+    }
+
+    return i + scan_nonblank_scalar(buffer + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_either_avx2(const char *buffer, size_t size, char a, char b)
+{
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    size_t i;
+
+    for(i = 0; i + 32 <= size; i += 32)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i *)(buffer + i));
+        const unsigned int mask =
+            (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va),
+                                                               _mm256_cmpeq_epi8(v, vb)));
+
+        if(mask != 0)
+            return i + (unsigned int)__builtin_ctz(mask);
+    }
+
+    return i + scan_either_sse2(buffer + i, size - i, a, b);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_nonblank_avx2(const char *buffer, size_t size)
+{
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    size_t i;
+
+    for(i = 0; i + 32 <= size; i += 32)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i *)(buffer + i));
+        const unsigned int mask =
+            ~(unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                                                                _mm256_cmpeq_epi8(v, tab)));
+
+        if(mask != 0)
+            return i + (unsigned int)__builtin_ctz(mask);
+    }
+
+    return i + scan_nonblank_sse2(buffer + i, size - i);
+}
+
+#endif /* SCAN_WITH_X86 */
+
+#ifdef SCAN_WITH_NEON
+
+/*!
+ * Turn result of a byte-wise NEON comparison into a 64 bit mask with four
+ * bits per byte.
+ */
+static inline uint64_t neon_to_mask(uint8x16_t matches)
+{
+    const uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+static size_t scan_either_neon(const char *buffer, size_t size, char a, char b)
+{
+    const uint8x16_t va = vdupq_n_u8((uint8_t)a);
+    const uint8x16_t vb = vdupq_n_u8((uint8_t)b);
+    size_t i;
+
+    for(i = 0; i + 16 <= size; i += 16)
+    {
+        const uint8x16_t v = vld1q_u8((const uint8_t *)buffer + i);
+        const uint64_t mask =
+            neon_to_mask(vorrq_u8(vceqq_u8(v, va), vceqq_u8(v, vb)));
+
+        if(mask != 0)
+            return i + (__builtin_ctzll(mask) >> 2);
+    }
+
+    return i + scan_either_scalar(buffer + i, size - i, a, b);
+}
+
+static size_t scan_nonblank_neon(const char *buffer, size_t size)
+{
+    const uint8x16_t space = vdupq_n_u8(' ');
+    const uint8x16_t tab = vdupq_n_u8('\t');
+    size_t i;
+
+    for(i = 0; i + 16 <= size; i += 16)
+    {
+        const uint8x16_t v = vld1q_u8((const uint8_t *)buffer + i);
+        const uint64_t mask =
+            neon_to_mask(vmvnq_u8(vorrq_u8(vceqq_u8(v, space),
+                                           vceqq_u8(v, tab))));
+
+        if(mask != 0)
+            return i + (__builtin_ctzll(mask) >> 2);
+    }
+
+    return i + scan_nonblank_scalar(buffer + i, size - i);
+}
+
+#endif /* SCAN_WITH_NEON */
+
+static size_t scan_either_dispatch(const char *buffer, size_t size, char a, char b);
+static size_t scan_nonblank_dispatch(const char *buffer, size_t size);
+
+/*!
+ * Implementations selected by #select_implementations() on first use.
+ *
+ * Concurrent first calls from several threads store the same values, so
+ * relaxed atomic accesses are sufficient.
+ */
+static scan_either_fn scan_either = scan_either_dispatch;
+static scan_nonblank_fn scan_nonblank = scan_nonblank_dispatch;
+
+static void select_implementations(void)
+{
+    scan_either_fn either = scan_either_scalar;
+    scan_nonblank_fn nonblank = scan_nonblank_scalar;
+
+#ifdef SCAN_WITH_X86
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2"))
+    {
+        either = scan_either_avx2;
+        nonblank = scan_nonblank_avx2;
+    }
+    else if(__builtin_cpu_supports("sse2"))
+    {
+        either = scan_either_sse2;
+        nonblank = scan_nonblank_sse2;
+    }
+#elif defined(SCAN_WITH_NEON)
+    /* NEON is guaranteed to be present if the compiler is allowed to use it */
+    either = scan_either_neon;
+    nonblank = scan_nonblank_neon;
+#endif
+
+    __atomic_store_n(&scan_either, either, __ATOMIC_RELAXED);
+    __atomic_store_n(&scan_nonblank, nonblank, __ATOMIC_RELAXED);
+}
+
+static size_t scan_either_dispatch(const char *buffer, size_t size, char a, char b)
+{
+    select_implementations();
+    return inifile_scan_for_either(buffer, size, a, b);
+}
+
+static size_t scan_nonblank_dispatch(const char *buffer, size_t size)
+{
+    select_implementations();
+    return inifile_scan_for_nonblank(buffer, size);
+}
+
+size_t inifile_scan_for_either(const char *buffer, size_t size, char a, char b)
+{
+    return __atomic_load_n(&scan_either, __ATOMIC_RELAXED)(buffer, size, a, b);
+}
+
+size_t inifile_scan_for_nonblank(const char *buffer, size_t size)
+{
+    return __atomic_load_n(&scan_nonblank, __ATOMIC_RELAXED)(buffer, size);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#ifndef INIFILE_SCAN_H
+#define INIFILE_SCAN_H
+
+#include <stddef.h>
+
+/*!
+ * \addtogroup inifile_scan Fast character scanning for the INI file parser
+ * \ingroup inifile
+ *
+ * The functions in this module process 16 or 32 bytes per step using SSE2
+ * or AVX2 on x86 and NEON on ARM. The best implementation supported by the
+ * CPU is selected at runtime on first use, with a plain scalar
+ * implementation as fallback.
+ */
+/*!@{*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Find first occurrence of either of two characters.
+ *
+ * \param buffer
+ *     Data to be scanned.
+ * \param size
+ *     Number of bytes in \p buffer.
+ * \param a, b
+ *     The characters to search for.
+ *
+ * \returns
+ *     Offset of the first byte in \p buffer which is equal to \p a or \p b,
+ *     or \p size if there is no such byte.
+ */
+size_t inifile_scan_for_either(const char *buffer, size_t size, char a, char b);
+
+/*!
+ * Find first character which is neither space nor tab.
+ *
+ * \param buffer
+ *     Data to be scanned.
+ * \param size
+ *     Number of bytes in \p buffer.
+ *
+ * \returns
+ *     Offset of the first byte in \p buffer which is not blank, or \p size
+ *     if there is no such byte.
+ */
+size_t inifile_scan_for_nonblank(const char *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!@}*/
+
+#endif /* !INIFILE_SCAN_H */
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "inifile_shared.h"
+#include "messages.h"
+#include "os.h"
+
+struct inifile_shared_version
+{
+    struct ini_file inifile;
+
+    /*! Number of readers, plus one while this is the current version. */
+    unsigned int refcount;
+};
+
+static inline struct inifile_shared_version *
+version_from_inifile(const struct ini_file *inifile)
+{
+    return (struct inifile_shared_version *)(uintptr_t)
+        ((const char *)inifile - offsetof(struct inifile_shared_version, inifile));
+}
+
+static void release_version(struct inifile_shared_version *version)
+{
+    if(__atomic_sub_fetch(&version->refcount, 1, __ATOMIC_ACQ_REL) > 0)
+        return;
+
+    inifile_free(&version->inifile);
+    free(version);
+}
+
+static int copy_inifile(struct ini_file *dst, const struct ini_file *src)
+{
+    /* #INIFILE_FLAG_ARENA is still set if it was implied by borrowing */
+    inifile_new_with_string_pool(dst,
+                                 src->flags & ~(unsigned int)INIFILE_FLAG_BORROWED,
+                                 src->string_pool);
+
+    for(const struct ini_section *s = src->sections_head; s != NULL; s = s->next)
+    {
+        struct ini_section *section =
+            inifile_new_section(dst, s->name, s->name_length);
+
+        if(section == NULL)
+            goto error_exit;
+
+        struct inifile_section_iterator iter;
+        inifile_section_iterator_init(&iter, s);
+
+        for(const struct ini_key_value_pair *kv = inifile_section_iterator_next(&iter);
+            kv != NULL;
+            kv = inifile_section_iterator_next(&iter))
+        {
+            const struct ini_key_value_pair *copy = kv->value_length > 0
+                ? inifile_section_store_value(section, kv->key, kv->key_length,
+                                              kv->value, kv->value_length)
+                : inifile_section_store_empty_value(section, kv->key,
+                                                    kv->key_length);
+
+            if(copy == NULL)
+                goto error_exit;
+        }
+    }
+
+    /* failure is not fatal, iteration falls back to the linked lists */
+    if((dst->flags & INIFILE_FLAG_COMPACT) != 0)
+        (void)inifile_compact(dst);
+
+    return 0;
+
+error_exit:
+    msg_out_of_memory("INI file copy");
+    inifile_free(dst);
+
+    return -1;
+}
+
+int inifile_shared_init(struct inifile_shared *shared, struct ini_file *inifile)
+{
+    msg_log_assert(shared != NULL);
+
+    struct inifile_shared_version *version = malloc(sizeof(*version));
+
+    if(version == NULL)
+    {
+        if(inifile != NULL)
+            inifile_free(inifile);
+
+        return msg_out_of_memory("shared INI file");
+    }
+
+    if(inifile != NULL)
+        version->inifile = *inifile;
+    else
+        inifile_new(&version->inifile);
+
+    version->refcount = 1;
+
+    shared->current = version;
+    shared->acquiring[0] = 0;
+    shared->acquiring[1] = 0;
+    shared->phase = 0;
+    pthread_mutex_init(&shared->write_lock, NULL);
+
+    return 0;
+}
+
+void inifile_shared_free(struct inifile_shared *shared)
+{
+    msg_log_assert(shared != NULL);
+
+    release_version(shared->current);
+    shared->current = NULL;
+    pthread_mutex_destroy(&shared->write_lock);
+}
+
+const struct ini_file *inifile_shared_acquire(struct inifile_shared *shared)
+{
+    msg_log_assert(shared != NULL);
+
+    /* the writer toggles the phase after exchanging the version pointer, and
+     * then waits for the counter of the previous phase to drop to zero, so
+     * the version we load cannot be freed before we have taken our
+     * reference; if the phase has changed before we could count ourselves
+     * in, the writer may not wait for us, so try again */
+    unsigned int phase;
+
+    while(true)
+    {
+        phase = __atomic_load_n(&shared->phase, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&shared->acquiring[phase], 1, __ATOMIC_SEQ_CST);
+
+        if(__atomic_load_n(&shared->phase, __ATOMIC_SEQ_CST) == phase)
+            break;
+
+        __atomic_sub_fetch(&shared->acquiring[phase], 1, __ATOMIC_SEQ_CST);
+    }
+
+    struct inifile_shared_version *version =
+        __atomic_load_n(&shared->current, __ATOMIC_SEQ_CST);
+
+    __atomic_add_fetch(&version->refcount, 1, __ATOMIC_SEQ_CST);
+    __atomic_sub_fetch(&shared->acquiring[phase], 1, __ATOMIC_SEQ_CST);
+
+    return &version->inifile;
+}
+
+void inifile_shared_release(const struct ini_file *inifile)
+{
+    if(inifile != NULL)
+        release_version(version_from_inifile(inifile));
+}
+
+struct ini_file *inifile_shared_begin_update(struct inifile_shared *shared)
+{
+    msg_log_assert(shared != NULL);
+
+    pthread_mutex_lock(&shared->write_lock);
+
+    struct inifile_shared_version *version = malloc(sizeof(*version));
+
+    if(version == NULL)
+    {
+        msg_out_of_memory("shared INI file version");
+        pthread_mutex_unlock(&shared->write_lock);
+        return NULL;
+    }
+
+    /* no need to acquire, only writers replace the current version */
+    if(copy_inifile(&version->inifile, &shared->current->inifile) < 0)
+    {
+        free(version);
+        pthread_mutex_unlock(&shared->write_lock);
+        return NULL;
+    }
+
+    version->refcount = 1;
+
+    return &version->inifile;
+}
+
+void inifile_shared_commit_update(struct inifile_shared *shared,
+                                  struct ini_file *inifile)
+{
+    msg_log_assert(shared != NULL);
+    msg_log_assert(inifile != NULL);
+
+    struct inifile_shared_version *previous =
+        __atomic_exchange_n(&shared->current, version_from_inifile(inifile),
+                            __ATOMIC_SEQ_CST);
+
+    /* new readers count themselves in the other counter from now on, so
+     * this one drops to zero even under steady reader traffic; readers
+     * which have loaded the previous pointer are about to take their
+     * references, this takes only a few instructions */
+    const unsigned int previous_phase =
+        __atomic_fetch_xor(&shared->phase, 1U, __ATOMIC_SEQ_CST);
+
+    while(__atomic_load_n(&shared->acquiring[previous_phase], __ATOMIC_SEQ_CST) != 0)
+        os_sched_yield();
+
+    pthread_mutex_unlock(&shared->write_lock);
+
+    release_version(previous);
+}
+
+void inifile_shared_abort_update(struct inifile_shared *shared,
+                                 struct ini_file *inifile)
+{
+    msg_log_assert(shared != NULL);
+    msg_log_assert(inifile != NULL);
+
+    release_version(version_from_inifile(inifile));
+    pthread_mutex_unlock(&shared->write_lock);
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#ifndef INIFILE_SHARED_H
+#define INIFILE_SHARED_H
+
+#include <pthread.h>
+
+#include "inifile.h"
+
+/*!
+ * \addtogroup inifile_shared INI files shared between threads
+ * \ingroup inifile
+ *
+ * A shared INI file is a sequence of immutable, reference counted versions
+ * of an INI file structure. Readers acquire the current version without
+ * taking any lock and may use it for as long as they like. A writer obtains
+ * a private copy of the current version, modifies it, and publishes it as
+ * the new current version by an atomic pointer exchange. Readers never wait
+ * for writers, so a writer may take its time, e.g., for writing the file to
+ * storage before or after publishing it.
+ *
+ * Each update copies the whole structure, so writers should combine
+ * related changes into a single update.
+ */
+/*!@{*/
+
+/*!
+ * \internal
+ * Version of a shared INI file.
+ */
+struct inifile_shared_version;
+
+/*!
+ * INI file shared between threads.
+ *
+ * All fields are internal. The structure is allocated by the caller and set
+ * up by #inifile_shared_init().
+ */
+struct inifile_shared
+{
+    /*! \internal Current version, exchanged atomically. */
+    struct inifile_shared_version *current;
+
+    /*!
+     * \internal
+     * Number of readers between loading \c current and taking a reference,
+     * counted separately for each value of \c phase.
+     */
+    unsigned int acquiring[2];
+
+    /*!
+     * \internal
+     * Selects the counter in \c acquiring used by new readers, toggled by
+     * each update.
+     */
+    unsigned int phase;
+
+    /*! \internal Serializes writers. */
+    pthread_mutex_t write_lock;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Set up shared INI file.
+ *
+ * \param shared
+ *     Structure to be set up by this function, must be freed by
+ *     #inifile_shared_free() after successful return.
+ *
+ * \param inifile
+ *     Initial version. The structure is moved into the shared INI file and
+ *     must not be used or freed by the caller anymore. Pass \c NULL to start
+ *     with an empty structure.
+ *
+ * \returns
+ *     0 on success, -1 on error (out of memory). In case of error,
+ *     \p inifile is freed.
+ */
+int inifile_shared_init(struct inifile_shared *shared, struct ini_file *inifile);
+
+/*!
+ * Free shared INI file.
+ *
+ * There must be no update in progress. Versions still acquired by readers
+ * are freed when they are released.
+ */
+void inifile_shared_free(struct inifile_shared *shared);
+
+/*!
+ * Get current version for reading, never blocks.
+ *
+ * \returns
+ *     The current version, which must not be modified and must be released
+ *     by #inifile_shared_release().
+ */
+const struct ini_file *inifile_shared_acquire(struct inifile_shared *shared);
+
+/*!
+ * Release version returned by #inifile_shared_acquire().
+ */
+void inifile_shared_release(const struct ini_file *inifile);
+
+/*!
+ * Begin update of shared INI file.
+ *
+ * Other writers are blocked until the update is finished by
+ * #inifile_shared_commit_update() or #inifile_shared_abort_update().
+ * Readers are not affected.
+ *
+ * \returns
+ *     A private copy of the current version to be modified by the caller,
+ *     or \c NULL on error (out of memory). Borrowed strings are copied, so
+ *     the copy does not use #INIFILE_FLAG_BORROWED.
+ */
+struct ini_file *inifile_shared_begin_update(struct inifile_shared *shared);
+
+/*!
+ * Publish copy returned by #inifile_shared_begin_update().
+ *
+ * Readers acquire the new version from now on. The previous version is
+ * freed when it has been released by all readers.
+ */
+void inifile_shared_commit_update(struct inifile_shared *shared,
+                                  struct ini_file *inifile);
+
+/*!
+ * Discard copy returned by #inifile_shared_begin_update().
+ */
+void inifile_shared_abort_update(struct inifile_shared *shared,
+                                 struct ini_file *inifile);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!@}*/
+
+#endif /* !INIFILE_SHARED_H */
@@ -0,0 +1,676 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "inifile_snapshot.h"
+#include "inifile.h"
+#include "inifile_index.h"
+#include "messages.h"
+
+#define SNAPSHOT_MAGIC          "INISNAP"
+#define SNAPSHOT_BYTE_ORDER     0x01020304U
+#define SNAPSHOT_VERSION        1U
+#define SNAPSHOT_TEMP_SUFFIX    ".tmp"
+
+/*
+ * Image layout: header, section table, key/value table, bucket table,
+ * string table. All offsets are relative to the beginning of the image,
+ * all tables are 8 byte aligned.
+ */
+struct snapshot_header
+{
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint64_t image_size;
+
+    /* stat(2) data of the text file the image was compiled from */
+    uint64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+
+    uint32_t number_of_sections;
+    uint32_t number_of_values;
+    uint32_t number_of_buckets;
+    uint32_t number_of_section_buckets;
+    uint32_t sections_offset;
+    uint32_t values_offset;
+    uint32_t buckets_offset;
+    uint32_t strings_offset;
+    uint32_t strings_size;
+    uint32_t reserved;
+};
+
+/* offsets into the string table */
+struct inifile_snapshot_section
+{
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t first_value;
+    uint32_t number_of_values;
+    uint32_t first_bucket;
+    uint32_t number_of_buckets;
+};
+
+struct snapshot_value
+{
+    uint32_t key_offset;
+    uint32_t key_length;
+    uint32_t value_offset;
+    uint32_t value_length;
+};
+
+/*
+ * Section buckets refer to the section table, value buckets refer to the
+ * key/value table. Index 0 marks an empty bucket, so indices are stored
+ * plus one.
+ */
+struct snapshot_bucket
+{
+    uint32_t hash;
+    uint32_t index;
+};
+
+static inline const struct snapshot_header *
+get_header(const struct inifile_snapshot *snapshot)
+{
+    return (const struct snapshot_header *)(const void *)snapshot->image;
+}
+
+static inline const struct inifile_snapshot_section *
+get_sections(const struct inifile_snapshot *snapshot)
+{
+    return (const struct inifile_snapshot_section *)(const void *)
+        (snapshot->image + get_header(snapshot)->sections_offset);
+}
+
+static inline const struct snapshot_value *
+get_values(const struct inifile_snapshot *snapshot)
+{
+    return (const struct snapshot_value *)(const void *)
+        (snapshot->image + get_header(snapshot)->values_offset);
+}
+
+static inline const struct snapshot_bucket *
+get_buckets(const struct inifile_snapshot *snapshot)
+{
+    return (const struct snapshot_bucket *)(const void *)
+        (snapshot->image + get_header(snapshot)->buckets_offset);
+}
+
+/*!
+ * Return string from string table if the reference is valid.
+ */
+static const char *get_string(const struct inifile_snapshot *snapshot,
+                              uint32_t offset, uint32_t length)
+{
+    const struct snapshot_header *header = get_header(snapshot);
+
+    if((uint64_t)offset + length >= header->strings_size)
+        return NULL;
+
+    const char *str = snapshot->image + header->strings_offset + offset;
+
+    return str[length] == '\0' ? str : NULL;
+}
+
+static size_t bucket_count(size_t number_of_items)
+{
+    if(number_of_items == 0)
+        return 0;
+
+    /* load factor at most 1/2, so that there is always an empty bucket */
+    size_t count = 4;
+
+    while(count < 2 * number_of_items)
+        count <<= 1;
+
+    return count;
+}
+
+static void insert_into_buckets(struct snapshot_bucket *buckets, size_t count,
+                                uint32_t hash, uint32_t index)
+{
+    const size_t mask = count - 1;
+
+    for(size_t i = hash & mask; /* nothing */; i = (i + 1) & mask)
+    {
+        if(buckets[i].index == 0)
+        {
+            buckets[i].hash = hash;
+            buckets[i].index = index + 1;
+            return;
+        }
+    }
+}
+
+static inline size_t align8(size_t size)
+{
+    return (size + 7) & ~(size_t)7;
+}
+
+/*!
+ * Narrow size or offset to the 32 bits stored in the image.
+ *
+ * All sizes, counts, and offsets are bounded by the size of the image, which
+ * is checked against \c UINT32_MAX before anything is written to it.
+ */
+static inline uint32_t to_image_u32(size_t value)
+{
+    msg_log_assert(value <= UINT32_MAX);
+    return (uint32_t)value;
+}
+
+/*!
+ * Compile parsed INI file into a snapshot image allocated on the heap.
+ */
+static char *compile_image(const struct ini_file *inifile,
+                           const struct stat *source_info,
+                           size_t *image_size)
+{
+    size_t number_of_sections = 0;
+    size_t number_of_values = 0;
+    size_t number_of_section_buckets = 0;
+    size_t number_of_buckets = 0;
+    size_t strings_size = 0;
+
+    for(const struct ini_section *s = inifile->sections_head; s != NULL; s = s->next)
+    {
+        size_t values_in_section = 0;
+
+        for(const struct ini_key_value_pair *kv = s->values_head; kv != NULL; kv = kv->next)
+        {
+            ++values_in_section;
+            strings_size += kv->key_length + 1 + kv->value_length + 1;
+        }
+
+        ++number_of_sections;
+        number_of_values += values_in_section;
+        number_of_buckets += bucket_count(values_in_section);
+        strings_size += s->name_length + 1;
+    }
+
+    number_of_section_buckets = bucket_count(number_of_sections);
+    number_of_buckets += number_of_section_buckets;
+
+    const size_t sections_offset = sizeof(struct snapshot_header);
+    const size_t values_offset =
+        sections_offset + number_of_sections * sizeof(struct inifile_snapshot_section);
+    const size_t buckets_offset =
+        values_offset + number_of_values * sizeof(struct snapshot_value);
+    const size_t strings_offset =
+        buckets_offset + number_of_buckets * sizeof(struct snapshot_bucket);
+    const size_t total_size = align8(strings_offset + strings_size);
+
+    /* all narrowing conversions below rely on this check */
+    if(total_size > UINT32_MAX)
+    {
+        msg_error(EFBIG, LOG_ERR, "INI file too large for snapshot");
+        return NULL;
+    }
+
+    char *image = calloc(1, total_size);
+
+    if(image == NULL)
+    {
+        msg_out_of_memory("INI file snapshot");
+        return NULL;
+    }
+
+    struct snapshot_header *header = (struct snapshot_header *)(void *)image;
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->byte_order = SNAPSHOT_BYTE_ORDER;
+    header->version = SNAPSHOT_VERSION;
+    header->image_size = total_size;
+    header->source_size = (uint64_t)source_info->st_size;
+    header->source_mtime_sec = source_info->st_mtim.tv_sec;
+    header->source_mtime_nsec = source_info->st_mtim.tv_nsec;
+    header->number_of_sections = to_image_u32(number_of_sections);
+    header->number_of_values = to_image_u32(number_of_values);
+    header->number_of_buckets = to_image_u32(number_of_buckets);
+    header->number_of_section_buckets = to_image_u32(number_of_section_buckets);
+    header->sections_offset = to_image_u32(sections_offset);
+    header->values_offset = to_image_u32(values_offset);
+    header->buckets_offset = to_image_u32(buckets_offset);
+    header->strings_offset = to_image_u32(strings_offset);
+    header->strings_size = to_image_u32(total_size - strings_offset);
+
+    struct inifile_snapshot_section *sections =
+        (struct inifile_snapshot_section *)(void *)(image + sections_offset);
+    struct snapshot_value *values =
+        (struct snapshot_value *)(void *)(image + values_offset);
+    struct snapshot_bucket *buckets =
+        (struct snapshot_bucket *)(void *)(image + buckets_offset);
+    char *const strings = image + strings_offset;
+
+    uint32_t value_index = 0;
+    uint32_t bucket_index = to_image_u32(number_of_section_buckets);
+    uint32_t string_pos = 0;
+    uint32_t section_index = 0;
+
+#define ADD_STRING(OFFSET, STR, LEN) \
+    do \
+    { \
+        (OFFSET) = string_pos; \
+        if((LEN) > 0) \
+            memcpy(strings + string_pos, (STR), (LEN)); \
+        string_pos += to_image_u32(LEN) + 1; \
+    } \
+    while(0)
+
+    for(const struct ini_section *s = inifile->sections_head;
+        s != NULL;
+        s = s->next, ++section_index)
+    {
+        struct inifile_snapshot_section *sec = &sections[section_index];
+
+        ADD_STRING(sec->name_offset, s->name, s->name_length);
+        sec->name_length = to_image_u32(s->name_length);
+        sec->first_value = value_index;
+
+        insert_into_buckets(buckets, number_of_section_buckets,
+                            inifile_hash(s->name, s->name_length),
+                            section_index);
+
+        for(const struct ini_key_value_pair *kv = s->values_head; kv != NULL; kv = kv->next)
+        {
+            struct snapshot_value *val = &values[value_index++];
+
+            ADD_STRING(val->key_offset, kv->key, kv->key_length);
+            val->key_length = to_image_u32(kv->key_length);
+            ADD_STRING(val->value_offset, kv->value, kv->value_length);
+            val->value_length = to_image_u32(kv->value_length);
+        }
+
+        sec->number_of_values = value_index - sec->first_value;
+        sec->first_bucket = bucket_index;
+        sec->number_of_buckets = to_image_u32(bucket_count(sec->number_of_values));
+
+        for(uint32_t i = 0; i < sec->number_of_values; ++i)
+        {
+            const struct snapshot_value *val = &values[sec->first_value + i];
+            insert_into_buckets(buckets + bucket_index, sec->number_of_buckets,
+                                inifile_hash(strings + val->key_offset,
+                                             val->key_length),
+                                sec->first_value + i);
+        }
+
+        bucket_index += sec->number_of_buckets;
+    }
+
+#undef ADD_STRING
+
+    *image_size = total_size;
+
+    return image;
+}
+
+static bool is_table_in_image(uint64_t image_size, uint32_t offset,
+                              uint32_t count, size_t entry_size)
+{
+    return (offset & 7) == 0 && offset + (uint64_t)count * entry_size <= image_size;
+}
+
+/*!
+ * Check image structure, tell whether or not it matches the text file.
+ *
+ * Contents of the key/value and bucket tables are checked on access.
+ */
+static bool is_image_valid(const struct inifile_snapshot *snapshot,
+                           const struct stat *source_info)
+{
+    if(snapshot->image_size < sizeof(struct snapshot_header))
+        return false;
+
+    const struct snapshot_header *header = get_header(snapshot);
+
+    if(memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+       header->byte_order != SNAPSHOT_BYTE_ORDER ||
+       header->version != SNAPSHOT_VERSION ||
+       header->image_size != snapshot->image_size)
+        return false;
+
+    if(header->source_size != (uint64_t)source_info->st_size ||
+       header->source_mtime_sec != source_info->st_mtim.tv_sec ||
+       header->source_mtime_nsec != source_info->st_mtim.tv_nsec)
+        return false;
+
+    if(!is_table_in_image(header->image_size, header->sections_offset,
+                          header->number_of_sections,
+                          sizeof(struct inifile_snapshot_section)) ||
+       !is_table_in_image(header->image_size, header->values_offset,
+                          header->number_of_values,
+                          sizeof(struct snapshot_value)) ||
+       !is_table_in_image(header->image_size, header->buckets_offset,
+                          header->number_of_buckets,
+                          sizeof(struct snapshot_bucket)) ||
+       !is_table_in_image(header->image_size, header->strings_offset,
+                          header->strings_size, 1))
+        return false;
+
+    if(header->number_of_section_buckets > header->number_of_buckets ||
+       (header->number_of_section_buckets & (header->number_of_section_buckets - 1)) != 0)
+        return false;
+
+    const struct inifile_snapshot_section *sections = get_sections(snapshot);
+
+    for(uint32_t i = 0; i < header->number_of_sections; ++i)
+    {
+        const struct inifile_snapshot_section *s = &sections[i];
+
+        if((uint64_t)s->first_value + s->number_of_values > header->number_of_values ||
+           (uint64_t)s->first_bucket + s->number_of_buckets > header->number_of_buckets ||
+           (s->number_of_buckets & (s->number_of_buckets - 1)) != 0 ||
+           get_string(snapshot, s->name_offset, s->name_length) == NULL)
+            return false;
+    }
+
+    return true;
+}
+
+static void delete_temporary_file(const char *filename)
+{
+    const bool was_suppressed = os_suppress_error_messages(true);
+
+    if(os_file_delete(filename) < 0)
+        msg_error(errno, LOG_ERR, "Failed to delete incomplete file");
+
+    os_suppress_error_messages(was_suppressed);
+}
+
+static int write_image(const char *image, size_t image_size,
+                       const char *snapshot_filename)
+{
+    const size_t filename_length = strlen(snapshot_filename);
+    char *temp_name = malloc(filename_length + sizeof(SNAPSHOT_TEMP_SUFFIX));
+
+    if(temp_name == NULL)
+        return msg_out_of_memory("temporary file name");
+
+    memcpy(temp_name, snapshot_filename, filename_length);
+    memcpy(temp_name + filename_length, SNAPSHOT_TEMP_SUFFIX,
+           sizeof(SNAPSHOT_TEMP_SUFFIX));
+
+    int ret = -1;
+    int fd = os_file_new(temp_name);
+
+    if(fd < 0)
+        goto exit_free;
+
+    if(os_write_from_buffer(image, image_size, fd) < 0)
+    {
+        msg_error(0, LOG_ERR, "Failed writing INI file snapshot \"%s\"",
+                  snapshot_filename);
+        os_file_close(fd);
+        delete_temporary_file(temp_name);
+        goto exit_free;
+    }
+
+    os_file_close(fd);
+
+    /* no need to sync the directory, a lost snapshot is simply regenerated */
+    if(!os_file_rename(temp_name, snapshot_filename))
+    {
+        delete_temporary_file(temp_name);
+        goto exit_free;
+    }
+
+    ret = 0;
+
+exit_free:
+    free(temp_name);
+
+    return ret;
+}
+
+/*!
+ * Parse text file and compile it into a heap image.
+ */
+static int compile_text_file(const char *text_filename,
+                             const struct stat *source_info,
+                             char **image, size_t *image_size)
+{
+    static const struct inifile_parse_options options =
+    {
+        .flags = INIFILE_FLAG_BORROWED,
+    };
+
+    struct ini_file inifile;
+    int ret = inifile_parse_from_file_with_options(&inifile, text_filename,
+                                                   &options);
+
+    /* structure has been freed already in case of parse errors */
+    if(ret < 0)
+        return ret;
+
+    if(ret == 0)
+    {
+        *image = compile_image(&inifile, source_info, image_size);
+        if(*image == NULL)
+            ret = -1;
+    }
+
+    inifile_free(&inifile);
+
+    return ret;
+}
+
+int inifile_snapshot_compile(const char *text_filename,
+                             const char *snapshot_filename)
+{
+    msg_log_assert(text_filename != NULL);
+    msg_log_assert(snapshot_filename != NULL);
+
+    struct stat source_info;
+
+    if(os_stat(text_filename, &source_info) < 0)
+        return errno == ENOENT ? 1 : -1;
+
+    char *image;
+    size_t image_size;
+    int ret = compile_text_file(text_filename, &source_info, &image, &image_size);
+
+    if(ret != 0)
+        return ret;
+
+    ret = write_image(image, image_size, snapshot_filename);
+    free(image);
+
+    return ret;
+}
+
+int inifile_snapshot_open(struct inifile_snapshot *snapshot,
+                          const char *text_filename,
+                          const char *snapshot_filename)
+{
+    msg_log_assert(snapshot != NULL);
+    msg_log_assert(text_filename != NULL);
+    msg_log_assert(snapshot_filename != NULL);
+
+    snapshot->image = NULL;
+    snapshot->image_size = 0;
+    snapshot->mapped.fd = -1;
+
+    struct stat source_info;
+
+    if(os_stat(text_filename, &source_info) < 0)
+        return errno == ENOENT ? 1 : -1;
+
+    /* a missing snapshot is not worth an error message */
+    const bool was_suppressed = os_suppress_error_messages(true);
+    const int map_result = os_map_file_to_memory(&snapshot->mapped,
+                                                 snapshot_filename);
+    os_suppress_error_messages(was_suppressed);
+
+    if(map_result == 0)
+    {
+        snapshot->image = snapshot->mapped.ptr;
+        snapshot->image_size = snapshot->mapped.length;
+
+        if(is_image_valid(snapshot, &source_info))
+            return 0;
+
+        os_unmap_file(&snapshot->mapped);
+        snapshot->mapped.fd = -1;
+    }
+
+    char *image;
+    size_t image_size;
+    int ret = compile_text_file(text_filename, &source_info, &image, &image_size);
+
+    if(ret != 0)
+    {
+        snapshot->image = NULL;
+        snapshot->image_size = 0;
+        return ret;
+    }
+
+    /* failure has been logged, but the image is still good */
+    (void)write_image(image, image_size, snapshot_filename);
+
+    snapshot->image = image;
+    snapshot->image_size = image_size;
+
+    return 0;
+}
+
+void inifile_snapshot_close(struct inifile_snapshot *snapshot)
+{
+    msg_log_assert(snapshot != NULL);
+
+    if(snapshot->mapped.fd >= 0)
+        os_unmap_file(&snapshot->mapped);
+    else
+        free((void *)(uintptr_t)snapshot->image);
+
+    snapshot->image = NULL;
+    snapshot->image_size = 0;
+    snapshot->mapped.fd = -1;
+}
+
+const struct inifile_snapshot_section *
+inifile_snapshot_find_section(const struct inifile_snapshot *snapshot,
+                              const char *name, size_t name_length)
+{
+    msg_log_assert(snapshot != NULL);
+    msg_log_assert(snapshot->image != NULL);
+    msg_log_assert(name != NULL);
+
+    if(name_length == 0)
+        name_length = strlen(name);
+
+    const struct snapshot_header *header = get_header(snapshot);
+    const size_t count = header->number_of_section_buckets;
+
+    if(count == 0)
+        return NULL;
+
+    const uint32_t hash = inifile_hash(name, name_length);
+    const size_t mask = count - 1;
+    const struct snapshot_bucket *buckets = get_buckets(snapshot);
+    const struct inifile_snapshot_section *sections = get_sections(snapshot);
+
+    for(size_t i = hash & mask, n = 0; n < count; i = (i + 1) & mask, ++n)
+    {
+        const struct snapshot_bucket *b = &buckets[i];
+
+        if(b->index == 0 || b->index > header->number_of_sections)
+            break;
+
+        if(b->hash != hash)
+            continue;
+
+        const struct inifile_snapshot_section *s = &sections[b->index - 1];
+
+        /* section table has been checked on open */
+        if(s->name_length == name_length &&
+           memcmp(snapshot->image + header->strings_offset + s->name_offset,
+                  name, name_length) == 0)
+            return s;
+    }
+
+    return NULL;
+}
+
+const char *
+inifile_snapshot_lookup_value(const struct inifile_snapshot *snapshot,
+                              const struct inifile_snapshot_section *section,
+                              const char *key, size_t key_length,
+                              size_t *value_length)
+{
+    msg_log_assert(snapshot != NULL);
+    msg_log_assert(snapshot->image != NULL);
+    msg_log_assert(section != NULL);
+    msg_log_assert(key != NULL);
+
+    if(key_length == 0)
+        key_length = strlen(key);
+
+    const size_t count = section->number_of_buckets;
+
+    if(count == 0)
+        return NULL;
+
+    const struct snapshot_header *header = get_header(snapshot);
+    const uint32_t hash = inifile_hash(key, key_length);
+    const size_t mask = count - 1;
+    const struct snapshot_bucket *buckets = get_buckets(snapshot) + section->first_bucket;
+    const struct snapshot_value *values = get_values(snapshot);
+
+    for(size_t i = hash & mask, n = 0; n < count; i = (i + 1) & mask, ++n)
+    {
+        const struct snapshot_bucket *b = &buckets[i];
+
+        if(b->index == 0 || b->index > header->number_of_values)
+            break;
+
+        if(b->hash != hash)
+            continue;
+
+        const struct snapshot_value *kv = &values[b->index - 1];
+
+        if(kv->key_length != key_length)
+            continue;
+
+        const char *k = get_string(snapshot, kv->key_offset, kv->key_length);
+
+        if(k == NULL || memcmp(k, key, key_length) != 0)
+            continue;
+
+        const char *v = get_string(snapshot, kv->value_offset, kv->value_length);
+
+        if(v != NULL && value_length != NULL)
+            *value_length = kv->value_length;
+
+        return v;
+    }
+
+    return NULL;
+}
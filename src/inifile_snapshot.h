@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#ifndef INIFILE_SNAPSHOT_H
+#define INIFILE_SNAPSHOT_H
+
+#include <stddef.h>
+
+#include "os.h"
+
+/*!
+ * \addtogroup inifile_snapshot Precompiled binary INI file snapshots
+ * \ingroup inifile
+ *
+ * A snapshot is a binary image of a parsed INI file. It holds a string
+ * table, tables of sections and key/value pairs referring to it by offset,
+ * and hash buckets for sections and for the keys in each section. The image
+ * is mapped into memory as is and lookups are served directly from the
+ * mapping, without any parsing or memory allocation.
+ *
+ * The image records size and modification time of the text file it was
+ * compiled from. If these do not match the text file anymore, the text file
+ * is parsed again and the snapshot is regenerated.
+ *
+ * Images are written in native byte order and are not meant to be moved
+ * between machines. Images of a different byte order or format version are
+ * treated as outdated.
+ */
+/*!@{*/
+
+/*!
+ * \internal
+ * Section entry in a snapshot image.
+ */
+struct inifile_snapshot_section;
+
+/*!
+ * Opened snapshot.
+ *
+ * All fields are internal. The structure is allocated by the caller and set
+ * up by #inifile_snapshot_open().
+ */
+struct inifile_snapshot
+{
+    /*! \internal The image, either mapped or on the heap. */
+    const char *image;
+    size_t image_size;
+
+    /*! \internal Mapped snapshot file, \c fd is -1 for heap images. */
+    struct os_mapped_file_data mapped;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Compile a text INI file into a snapshot file.
+ *
+ * The snapshot file is written to a temporary file first, which is then
+ * renamed to \p snapshot_filename.
+ *
+ * \retval 0 on success
+ * \retval 1 if the text file does not exist
+ * \retval -1 on error
+ */
+int inifile_snapshot_compile(const char *text_filename,
+                             const char *snapshot_filename);
+
+/*!
+ * Open snapshot of a text INI file, regenerate it if necessary.
+ *
+ * If \p snapshot_filename is a valid snapshot of the current version of
+ * \p text_filename, then it is mapped into memory. Otherwise, the text file
+ * is parsed and compiled into a new image, and an attempt is made to write
+ * the image to \p snapshot_filename. Failure to write the snapshot file is
+ * not an error; the image is used from memory in this case.
+ *
+ * \param snapshot
+ *     Structure to be set up by this function, must be freed by
+ *     #inifile_snapshot_close() after successful return.
+ *
+ * \param text_filename
+ *     Name of the INI file.
+ *
+ * \param snapshot_filename
+ *     Name of the snapshot file.
+ *
+ * \retval 0 on success
+ * \retval 1 if the text file does not exist
+ * \retval -1 on error
+ */
+int inifile_snapshot_open(struct inifile_snapshot *snapshot,
+                          const char *text_filename,
+                          const char *snapshot_filename);
+
+/*!
+ * Free resources associated with a snapshot.
+ */
+void inifile_snapshot_close(struct inifile_snapshot *snapshot);
+
+/*!
+ * Find section by name.
+ *
+ * \param snapshot
+ *     Opened snapshot.
+ *
+ * \param name
+ *     Name of the section to search for.
+ *
+ * \param name_length
+ *     Length of \p name, or 0 to have it determined by this function.
+ *
+ * \returns
+ *     The section, or \c NULL if the section was not found.
+ */
+const struct inifile_snapshot_section *
+inifile_snapshot_find_section(const struct inifile_snapshot *snapshot,
+                              const char *name, size_t name_length);
+
+/*!
+ * Look up value by key.
+ *
+ * \param snapshot
+ *     Opened snapshot.
+ *
+ * \param section
+ *     Section returned by #inifile_snapshot_find_section().
+ *
+ * \param key
+ *     Key to search for.
+ *
+ * \param key_length
+ *     Length of \p key, or 0 to have it determined by this function.
+ *
+ * \param value_length
+ *     Length of the returned value, may be \c NULL.
+ *
+ * \returns
+ *     Zero-terminated value stored in the image, or \c NULL if the key was
+ *     not found.
+ */
+const char *
+inifile_snapshot_lookup_value(const struct inifile_snapshot *snapshot,
+                              const struct inifile_snapshot_section *section,
+                              const char *key, size_t key_length,
+                              size_t *value_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*!@}*/
+
+#endif /* !INIFILE_SNAPSHOT_H */
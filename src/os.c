@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2015--2020, 2022, 2024  T+A elektroakustik GmbH & Co. KG
+ * Copyright (C) 2015--2020, 2022, 2024, 2026  T+A elektroakustik GmbH & Co. KG
  *
  * This file is part of the T+A Streaming Board software stack ("StrBoWare").
  *
@@ -525,13 +525,13 @@ int os_file_new(const char *filename)
     return fd;
 }
 
-static void safe_close_fd(int fd)
+static void close_fd(int fd, bool do_sync)
 {
     SAVE_ERRNO(previous_errno);
 
     errno = 0;
 
-    if(fsync(fd) < 0 && errno != EINVAL && !verbosity.suppress_errors)
+    if(do_sync && fsync(fd) < 0 && errno != EINVAL && !verbosity.suppress_errors)
         msg_error(errno, LOG_ERR, "fsync() fd %d", fd);
 
     int ret;
@@ -548,6 +548,11 @@ static void safe_close_fd(int fd)
     }
 }
 
+static void safe_close_fd(int fd)
+{
+    close_fd(fd, true);
+}
+
 void os_file_close(int fd)
 {
     if(fd < 0)
@@ -560,6 +565,37 @@ void os_file_close(int fd)
         safe_close_fd(fd);
 }
 
+void os_file_close_without_sync(int fd)
+{
+    if(fd < 0)
+    {
+        msg_error(EBADF, LOG_ERR,
+                  "Passed invalid file descriptor %d to %s()", fd, __func__);
+        errno = EBADF;
+    }
+    else
+        close_fd(fd, false);
+}
+
+int os_file_sync(int fd)
+{
+    errno = 0;
+
+    if(fdatasync(fd) < 0)
+    {
+        if(!verbosity.suppress_errors)
+        {
+            SAVE_ERRNO(temp);
+            msg_error(errno, LOG_ERR, "fdatasync() fd %d", fd);
+            RESTORE_ERRNO(temp);
+        }
+
+        return -1;
+    }
+
+    return 0;
+}
+
 int os_file_delete(const char *filename)
 {
     msg_log_assert(filename != NULL);
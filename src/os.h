@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2015, 2017--2019, 2024  T+A elektroakustik GmbH & Co. KG
+ * Copyright (C) 2015, 2017--2019, 2024, 2026  T+A elektroakustik GmbH & Co. KG
  *
  * This file is part of the T+A Streaming Board software stack ("StrBoWare").
  *
@@ -124,6 +124,16 @@ bool os_rmdir(const char *path, bool must_exist);
 
 int os_file_new(const char *filename);
 void os_file_close(int fd);
+
+/*!
+ * Close file without syncing it, for use after #os_file_sync().
+ */
+void os_file_close_without_sync(int fd);
+
+/*!
+ * Flush data written to a file to storage, keep the file open.
+ */
+int os_file_sync(int fd);
 int os_file_delete(const char *filename);
 bool os_file_rename(const char *oldpath, const char *newpath);
 
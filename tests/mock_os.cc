@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2015, 2017, 2018, 2019  T+A elektroakustik GmbH & Co. KG
+ * Copyright (C) 2015, 2017, 2018, 2019, 2026  T+A elektroakustik GmbH & Co. KG
  *
  * This file is part of the T+A Streaming Board software stack ("StrBoWare").
  *
@@ -39,12 +39,15 @@ enum class OsFn
     foreach_in_path,
     path_get_type,
     path_get_number_of_hard_links,
+    unix_stat,
     resolve_symlink,
     mkdir_hierarchy,
     unix_mkdir,
     unix_rmdir,
     file_new,
     file_close,
+    file_close_without_sync,
+    file_sync,
     file_delete,
     file_rename,
     link_new,
@@ -103,6 +106,10 @@ static std::ostream &operator<<(std::ostream &os, const OsFn id)
         os << "path_get_number_of_hard_links";
         break;
 
+      case OsFn::unix_stat:
+        os << "unix_stat";
+        break;
+
       case OsFn::resolve_symlink:
         os << "resolve_symlink";
         break;
@@ -127,6 +134,14 @@ static std::ostream &operator<<(std::ostream &os, const OsFn id)
         os << "file_close";
         break;
 
+      case OsFn::file_close_without_sync:
+        os << "file_close_without_sync";
+        break;
+
+      case OsFn::file_sync:
+        os << "file_sync";
+        break;
+
       case OsFn::file_delete:
         os << "file_delete";
         break;
@@ -190,6 +205,7 @@ class MockOs::Expectation
         void *arg_dest_pointer_;
         struct os_mapped_file_data *arg_mapped_pointer_;
         const struct os_mapped_file_data *arg_mapped_template_;
+        const struct stat *arg_stat_template_;
         bool arg_pointer_expect_concrete_value_;
         bool arg_pointer_shall_be_null_;
         size_t arg_count_;
@@ -219,6 +235,7 @@ class MockOs::Expectation
             arg_dest_pointer_(nullptr),
             arg_mapped_pointer_(nullptr),
             arg_mapped_template_(nullptr),
+            arg_stat_template_(nullptr),
             arg_pointer_expect_concrete_value_(false),
             arg_pointer_shall_be_null_(false),
             arg_count_(0),
@@ -346,6 +363,12 @@ class MockOs::Expectation
         return *this;
     }
 
+    Expectation &expect_arg_stat_template(const struct stat *buf)
+    {
+        data_.arg_stat_template_ = buf;
+        return *this;
+    }
+
     Expectation &expect_arg_mapped_template(const struct os_mapped_file_data *mapped)
     {
         data_.arg_mapped_pointer_ = nullptr;
@@ -576,6 +599,16 @@ void MockOs::expect_os_path_get_number_of_hard_links(size_t retval, int ret_errn
             .expect_arg_string(path)));
 }
 
+void MockOs::expect_os_stat(int retval, int ret_errno, const char *path,
+                            const struct stat *buf)
+{
+    expectations_->add(std::move(
+        Expectation(OsFn::unix_stat, retval)
+            .expect_ret_errno(ret_errno)
+            .expect_arg_string(path)
+            .expect_arg_stat_template(buf)));
+}
+
 void MockOs::expect_os_resolve_symlink(const char *retval, int ret_errno, const char *link)
 {
     expectations_->add(std::move(
@@ -628,6 +661,22 @@ void MockOs::expect_os_file_close(int ret_errno, int fd)
             .expect_arg_fd(fd)));
 }
 
+void MockOs::expect_os_file_close_without_sync(int ret_errno, int fd)
+{
+    expectations_->add(std::move(
+        Expectation(OsFn::file_close_without_sync)
+            .expect_ret_errno(ret_errno)
+            .expect_arg_fd(fd)));
+}
+
+void MockOs::expect_os_file_sync(int ret, int ret_errno, int fd)
+{
+    expectations_->add(std::move(
+        Expectation(OsFn::file_sync, ret)
+            .expect_ret_errno(ret_errno)
+            .expect_arg_fd(fd)));
+}
+
 void MockOs::expect_os_file_delete(int ret, int ret_errno, const char *filename)
 {
     expectations_->add(std::move(
@@ -995,6 +1044,21 @@ size_t os_path_get_number_of_hard_links(const char *path)
     return expect.d.ret_size_;
 }
 
+int os_stat(const char *path, struct stat *buf)
+{
+    const auto &expect(mock_os_singleton->expectations_->get_next_expectation(__func__));
+
+    cppcut_assert_equal(expect.d.function_id_, OsFn::unix_stat);
+    cppcut_assert_equal(expect.d.arg_string_, std::string(path));
+
+    if(expect.d.arg_stat_template_ != nullptr)
+        *buf = *expect.d.arg_stat_template_;
+
+    errno = expect.d.ret_errno_;
+
+    return expect.d.ret_int_;
+}
+
 int os_file_new(const char *filename)
 {
     const auto &expect(mock_os_singleton->expectations_->get_next_expectation(__func__));
@@ -1017,6 +1081,28 @@ void os_file_close(int fd)
     errno = expect.d.ret_errno_;
 }
 
+void os_file_close_without_sync(int fd)
+{
+    const auto &expect(mock_os_singleton->expectations_->get_next_expectation(__func__));
+
+    cppcut_assert_equal(expect.d.function_id_, OsFn::file_close_without_sync);
+    cppcut_assert_equal(expect.d.arg_fd_, fd);
+
+    errno = expect.d.ret_errno_;
+}
+
+int os_file_sync(int fd)
+{
+    const auto &expect(mock_os_singleton->expectations_->get_next_expectation(__func__));
+
+    cppcut_assert_equal(expect.d.function_id_, OsFn::file_sync);
+    cppcut_assert_equal(expect.d.arg_fd_, fd);
+
+    errno = expect.d.ret_errno_;
+
+    return expect.d.ret_int_;
+}
+
 int os_file_delete(const char *filename)
 {
     const auto &expect(mock_os_singleton->expectations_->get_next_expectation(__func__));
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2015, 2017, 2018, 2019  T+A elektroakustik GmbH & Co. KG
+ * Copyright (C) 2015, 2017, 2018, 2019, 2026  T+A elektroakustik GmbH & Co. KG
  *
  * This file is part of the T+A Streaming Board software stack ("StrBoWare").
  *
@@ -83,12 +83,16 @@ class MockOs
                                    const std::vector<ForeachItemData> &items);
     void expect_os_path_get_type(enum os_path_type retval, int ret_errno, const char *path);
     void expect_os_path_get_number_of_hard_links(size_t retval, int ret_errno, const char *path);
+    void expect_os_stat(int retval, int ret_errno, const char *path,
+                        const struct stat *buf);
     void expect_os_resolve_symlink(const char *retval, int ret_errno, const char *link);
     void expect_os_mkdir_hierarchy(bool retval, int ret_errno, const char *path, bool must_not_exist);
     void expect_os_mkdir(bool retval, int ret_errno, const char *path, bool must_not_exist);
     void expect_os_rmdir(bool retval, int ret_errno, const char *path, bool must_exist);
     void expect_os_file_new(int ret, int ret_errno, const char *filename);
     void expect_os_file_close(int ret_errno, int fd);
+    void expect_os_file_close_without_sync(int ret_errno, int fd);
+    void expect_os_file_sync(int ret, int ret_errno, int fd);
     void expect_os_file_delete(int ret, int ret_errno, const char *filename);
     void expect_os_file_rename(bool retval, int ret_errno, const char *oldpath, const char *newpath);
     void expect_os_link_new(bool retval, int ret_errno, const char *oldpath, const char *newpath);
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2018--2022  T+A elektroakustik GmbH & Co. KG
+ * Copyright (C) 2018--2022, 2026  T+A elektroakustik GmbH & Co. KG
  *
  * This file is part of the T+A Streaming Board software stack ("StrBoWare").
  *
@@ -58,6 +58,12 @@ enum os_path_type os_path_get_type(const char *path)
     return MockOS::singleton->check_next<MockOS::PathGetType>(path);
 }
 
+int os_stat(const char *path, struct stat *buf)
+{
+    REQUIRE(MockOS::singleton != nullptr);
+    return MockOS::singleton->check_next<MockOS::Stat>(path, buf);
+}
+
 int os_file_new(const char *filename)
 {
     REQUIRE(MockOS::singleton != nullptr);
@@ -70,12 +76,30 @@ void os_file_close(int fd)
     MockOS::singleton->check_next<MockOS::FileClose>(fd);
 }
 
+void os_file_close_without_sync(int fd)
+{
+    REQUIRE(MockOS::singleton != nullptr);
+    MockOS::singleton->check_next<MockOS::FileCloseWithoutSync>(fd);
+}
+
+int os_file_sync(int fd)
+{
+    REQUIRE(MockOS::singleton != nullptr);
+    return MockOS::singleton->check_next<MockOS::FileSync>(fd);
+}
+
 int os_file_delete(const char *filename)
 {
     REQUIRE(MockOS::singleton != nullptr);
     return MockOS::singleton->check_next<MockOS::FileDelete>(filename);
 }
 
+bool os_file_rename(const char *oldpath, const char *newpath)
+{
+    REQUIRE(MockOS::singleton != nullptr);
+    return MockOS::singleton->check_next<MockOS::FileRename>(oldpath, newpath);
+}
+
 int os_map_file_to_memory(struct os_mapped_file_data *mapped,
                           const char *filename)
 {
@@ -102,7 +126,13 @@ int os_foreach_in_path(const char *path,
 void os_sync_dir(const char *path)
 {
     REQUIRE(MockOS::singleton != nullptr);
-    FAIL("Not implemented yet");
+    MockOS::singleton->check_next<MockOS::SyncDir>(path);
+}
+
+void os_sched_yield(void)
+{
+    REQUIRE(MockOS::singleton != nullptr);
+    MockOS::singleton->check_next<MockOS::SchedYield>();
 }
 
 int os_system_formatted(bool is_verbose, const char *format_string, ...)
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2018--2020, 2022, 2023  T+A elektroakustik GmbH & Co. KG
+ * Copyright (C) 2018--2020, 2022, 2023, 2026  T+A elektroakustik GmbH & Co. KG
  *
  * This file is part of the T+A Streaming Board software stack ("StrBoWare").
  *
@@ -307,6 +307,43 @@ class PathGetType: public Expectation
     }
 };
 
+class Stat: public Expectation
+{
+  private:
+    const int retval_;
+    const int ret_errno_;
+    const std::string pathname_;
+    const struct stat *buf_template_;
+
+  public:
+    explicit Stat(int retval, int ret_errno, const char *pathname,
+                  const struct stat *buf_template):
+        Expectation("Stat"),
+        retval_(retval),
+        ret_errno_(ret_errno),
+        pathname_(pathname),
+        buf_template_(buf_template)
+    {}
+
+    int check(const char *pathname, struct stat *buf) const
+    {
+        REQUIRE(pathname != nullptr);
+        REQUIRE(buf != nullptr);
+        CHECK(pathname == pathname_);
+
+        if(buf_template_ != nullptr)
+            *buf = *buf_template_;
+
+        errno = ret_errno_;
+        return retval_;
+    }
+
+    static auto make_from_check_parameters(const char *pathname, struct stat *buf)
+    {
+        return std::make_unique<Stat>(0, 0, pathname, nullptr);
+    }
+};
+
 class FileNew: public Expectation
 {
   private:
@@ -361,6 +398,59 @@ class FileClose: public Expectation
     }
 };
 
+class FileCloseWithoutSync: public Expectation
+{
+  private:
+    const int ret_errno_;
+    const int fd_;
+
+  public:
+    explicit FileCloseWithoutSync(int ret_errno, int fd):
+        Expectation("FileCloseWithoutSync"),
+        ret_errno_(ret_errno),
+        fd_(fd)
+    {}
+
+    void check(int fd) const
+    {
+        CHECK(fd == fd_);
+        errno = ret_errno_;
+    }
+
+    static auto make_from_check_parameters(int fd)
+    {
+        return std::make_unique<FileCloseWithoutSync>(0, fd);
+    }
+};
+
+class FileSync: public Expectation
+{
+  private:
+    const int retval_;
+    const int ret_errno_;
+    const int fd_;
+
+  public:
+    explicit FileSync(int retval, int ret_errno, int fd):
+        Expectation("FileSync"),
+        retval_(retval),
+        ret_errno_(ret_errno),
+        fd_(fd)
+    {}
+
+    int check(int fd) const
+    {
+        CHECK(fd == fd_);
+        errno = ret_errno_;
+        return retval_;
+    }
+
+    static auto make_from_check_parameters(int fd)
+    {
+        return std::make_unique<FileSync>(0, 0, fd);
+    }
+};
+
 class FileDelete: public Expectation
 {
   private:
@@ -390,6 +480,66 @@ class FileDelete: public Expectation
     }
 };
 
+class FileRename: public Expectation
+{
+  private:
+    const bool retval_;
+    const int ret_errno_;
+    const std::string oldpath_;
+    const std::string newpath_;
+
+  public:
+    explicit FileRename(bool retval, int ret_errno,
+                        const char *oldpath, const char *newpath):
+        Expectation("FileRename"),
+        retval_(retval),
+        ret_errno_(ret_errno),
+        oldpath_(oldpath),
+        newpath_(newpath)
+    {}
+
+    bool check(const char *oldpath, const char *newpath) const
+    {
+        REQUIRE(oldpath != nullptr);
+        REQUIRE(newpath != nullptr);
+        CHECK(oldpath == oldpath_);
+        CHECK(newpath == newpath_);
+        errno = ret_errno_;
+        return retval_;
+    }
+
+    static auto make_from_check_parameters(const char *oldpath, const char *newpath)
+    {
+        return std::make_unique<FileRename>(true, 0, oldpath, newpath);
+    }
+};
+
+class SyncDir: public Expectation
+{
+  private:
+    const int ret_errno_;
+    const std::string path_;
+
+  public:
+    explicit SyncDir(int ret_errno, const char *path):
+        Expectation("SyncDir"),
+        ret_errno_(ret_errno),
+        path_(path)
+    {}
+
+    void check(const char *path) const
+    {
+        REQUIRE(path != nullptr);
+        CHECK(path == path_);
+        errno = ret_errno_;
+    }
+
+    static auto make_from_check_parameters(const char *path)
+    {
+        return std::make_unique<SyncDir>(0, path);
+    }
+};
+
 class UnmapFile: public Expectation
 {
   private:
@@ -397,6 +547,11 @@ class UnmapFile: public Expectation
     const struct os_mapped_file_data *mapped_;
 
   public:
+    /*!
+     * Expect unmapping of given structure, or of any structure if
+     * \p mapped is \c nullptr (for structures internal to the code under
+     * test).
+     */
     explicit UnmapFile(int ret_errno, const struct os_mapped_file_data *mapped):
         Expectation("UnmapFile"),
         ret_errno_(ret_errno),
@@ -406,7 +561,8 @@ class UnmapFile: public Expectation
     void check(struct os_mapped_file_data *mapped) const
     {
         CHECK(mapped != nullptr);
-        CHECK(mapped == mapped_);
+        if(mapped_ != nullptr)
+            CHECK(mapped == mapped_);
         errno = ret_errno_;
     }
 
@@ -416,6 +572,21 @@ class UnmapFile: public Expectation
     }
 };
 
+class SchedYield: public Expectation
+{
+  public:
+    explicit SchedYield():
+        Expectation("SchedYield")
+    {}
+
+    void check() const {}
+
+    static auto make_from_check_parameters()
+    {
+        return std::make_unique<SchedYield>();
+    }
+};
+
 extern Mock *singleton;
 
 }
@@ -0,0 +1,663 @@
+/*
+ * Copyright (C) 2026  T+A elektroakustik GmbH & Co. KG
+ *
+ * This file is part of the T+A Streaming Board software stack ("StrBoWare").
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301, USA.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <doctest.h>
+
+#include "configuration.hh"
+#include "configuration_settings.hh"
+
+#include "mock_messages.hh"
+#include "mock_os.hh"
+#include "mock_timebase.hh"
+
+#include <vector>
+#include <string>
+
+/*!
+ * \addtogroup configuration_tests Unit tests
+ * \ingroup configuration
+ *
+ * Configuration management unit tests.
+ */
+/*!@{*/
+
+TEST_SUITE_BEGIN("Configuration key name index");
+
+class KeyNameIndexTestsFixture
+{
+  protected:
+    std::unique_ptr<MockMessages::Mock> mock_messages;
+
+  public:
+    explicit KeyNameIndexTestsFixture():
+        mock_messages(std::make_unique<MockMessages::Mock>())
+    {
+        MockMessages::singleton = mock_messages.get();
+    }
+
+    ~KeyNameIndexTestsFixture()
+    {
+        try
+        {
+            mock_messages->done();
+        }
+        catch(...)
+        {
+            /* no throwing from dtors */
+        }
+
+        MockMessages::singleton = nullptr;
+    }
+};
+
+static std::vector<Configuration::KeyNameIndex::Name>
+to_names(const std::vector<std::string> &strings)
+{
+    std::vector<Configuration::KeyNameIndex::Name> names;
+
+    for(const auto &s : strings)
+        names.emplace_back(s.c_str(), s.length());
+
+    return names;
+}
+
+/*!\test
+ * Each name is found at its position in the table the index was built
+ * from, by length and as zero-terminated string.
+ */
+TEST_CASE_FIXTURE(KeyNameIndexTestsFixture, "Look up all names in key name index")
+{
+    std::vector<std::string> strings;
+
+    for(size_t i = 0; i < 300; ++i)
+        strings.emplace_back("@drcpd:settings:key_" + std::to_string(i));
+
+    for(size_t count : {0, 1, 2, 3, 17, 300})
+    {
+        const std::vector<std::string> subset(strings.begin(), strings.begin() + count);
+        const Configuration::KeyNameIndex index(to_names(subset));
+
+        for(size_t i = 0; i < subset.size(); ++i)
+        {
+            CHECK(index.find(subset[i].c_str(), subset[i].length()) == i);
+            CHECK(index.find(subset[i].c_str()) == i);
+        }
+    }
+}
+
+/*!\test
+ * Unknown names are not found, neither in a filled nor in an empty index.
+ */
+TEST_CASE_FIXTURE(KeyNameIndexTestsFixture, "Unknown names are not found in key name index")
+{
+    const std::vector<std::string> strings { "volume", "balance", "name" };
+    const Configuration::KeyNameIndex index(to_names(strings));
+    const Configuration::KeyNameIndex empty_index(to_names({}));
+
+    CHECK(index.find("bass") == Configuration::KeyNameIndex::NOT_FOUND);
+    CHECK(index.find("Volume") == Configuration::KeyNameIndex::NOT_FOUND);
+    CHECK(index.find("", 0) == Configuration::KeyNameIndex::NOT_FOUND);
+    CHECK(index.find("") == Configuration::KeyNameIndex::NOT_FOUND);
+
+    for(const auto &s : strings)
+    {
+        CHECK(empty_index.find(s.c_str(), s.length()) == Configuration::KeyNameIndex::NOT_FOUND);
+        CHECK(empty_index.find(s.c_str()) == Configuration::KeyNameIndex::NOT_FOUND);
+    }
+}
+
+/*!\test
+ * Prefixes and extensions of known names are not found, and names which
+ * are not zero-terminated are compared by length.
+ */
+TEST_CASE_FIXTURE(KeyNameIndexTestsFixture, "Key name index compares names by length")
+{
+    const std::vector<std::string> strings { "volume", "volume_max", "vol" };
+    const Configuration::KeyNameIndex index(to_names(strings));
+
+    CHECK(index.find("volume_max", 6) == 0);
+    CHECK(index.find("volume_max", 3) == 2);
+    CHECK(index.find("volume_max", 10) == 1);
+    CHECK(index.find("volume_max", 7) == Configuration::KeyNameIndex::NOT_FOUND);
+    CHECK(index.find("volume_max", 5) == Configuration::KeyNameIndex::NOT_FOUND);
+    CHECK(index.find("volumes") == Configuration::KeyNameIndex::NOT_FOUND);
+    CHECK(index.find("volu") == Configuration::KeyNameIndex::NOT_FOUND);
+}
+
+/*!\test
+ * Duplicate names are reported once, the first occurrence is found.
+ */
+TEST_CASE_FIXTURE(KeyNameIndexTestsFixture, "Duplicate names in key name index are reported")
+{
+    expect<MockMessages::MsgError>(mock_messages, 0, LOG_CRIT,
+        "BUG: Duplicate configuration key name \"balance\"", false);
+
+    std::vector<std::string> strings { "volume", "balance", "name", "balance" };
+
+    for(size_t i = 0; i < 500; ++i)
+        strings.emplace_back("key_" + std::to_string(i));
+
+    const Configuration::KeyNameIndex index(to_names(strings));
+
+    CHECK(index.find("balance") == 1);
+    CHECK(index.find("name") == 2);
+    CHECK(index.find("key_499") == strings.size() - 1);
+}
+
+TEST_SUITE_END();
+
+struct TestValues
+{
+    static constexpr char OWNER_NAME[] = "test";
+    static constexpr char CONFIGURATION_SECTION_NAME[] = "settings";
+    static constexpr char DATABASE_NAME[] = "values";
+
+    enum class KeyID
+    {
+        NAME,
+        VOLUME,
+        IS_ENABLED,
+
+        LAST_ID = IS_ENABLED,
+    };
+
+    static constexpr size_t NUMBER_OF_KEYS = static_cast<size_t>(KeyID::LAST_ID) + 1;
+
+    std::string name_;
+    uint32_t volume_;
+    bool is_enabled_;
+
+    explicit TestValues(): volume_(0), is_enabled_(false) {}
+
+    explicit TestValues(const char *name, uint32_t volume, bool is_enabled):
+        name_(name),
+        volume_(volume),
+        is_enabled_(is_enabled)
+    {}
+
+    class Key;
+    static const std::array<Key, NUMBER_OF_KEYS> all_keys;
+};
+
+namespace Configuration
+{
+
+template <>
+class UpdateSettings<TestValues>
+{
+  private:
+    Settings<TestValues> &settings_;
+
+  public:
+    UpdateSettings(const UpdateSettings &) = delete;
+    UpdateSettings &operator=(const UpdateSettings &) = delete;
+
+    explicit UpdateSettings(Settings<TestValues> &settings):
+        settings_(settings)
+    {}
+
+    template <TestValues::KeyID ID> struct UpdateTraits;
+
+    void name(const std::string &name);
+    void volume(uint32_t volume);
+};
+
+CONFIGURATION_UPDATE_TRAITS(UpdateSettings<TestValues>::UpdateTraits, TestValues, NAME, name_);
+CONFIGURATION_UPDATE_TRAITS(UpdateSettings<TestValues>::UpdateTraits, TestValues, VOLUME, volume_);
+CONFIGURATION_UPDATE_TRAITS(UpdateSettings<TestValues>::UpdateTraits, TestValues, IS_ENABLED, is_enabled_);
+
+void UpdateSettings<TestValues>::name(const std::string &name)
+{
+    settings_.update<TestValues::KeyID::NAME,
+                     UpdateTraits<TestValues::KeyID::NAME>>(name);
+}
+
+void UpdateSettings<TestValues>::volume(uint32_t volume)
+{
+    settings_.update<TestValues::KeyID::VOLUME,
+                     UpdateTraits<TestValues::KeyID::VOLUME>>(volume);
+}
+
+}
+
+class TestValues::Key: public Configuration::ConfigKeyBase<TestValues>
+{
+  private:
+    const Serializer serialize_;
+    const Deserializer deserialize_;
+
+  public:
+    explicit Key(KeyID id, const char *name,
+                 Serializer &&serializer, Deserializer &&deserializer):
+        ConfigKeyBase(id, name, Configuration::find_varname_offset_in_keyname(name)),
+        serialize_(std::move(serializer)),
+        deserialize_(std::move(deserializer))
+    {}
+
+    void read(char *dest, size_t dest_size, const TestValues &src) const override
+    {
+        serialize_(dest, dest_size, src);
+    }
+
+    bool write(TestValues &dest, const char *src) const override
+    {
+        return deserialize_(dest, src);
+    }
+
+    GVariantWrapper box(const TestValues &) const override
+    {
+        return GVariantWrapper();
+    }
+
+    Configuration::InsertResult unbox(Configuration::UpdateSettings<TestValues> &,
+                                      GVariantWrapper &&) const override
+    {
+        return Configuration::InsertResult::VALUE_TYPE_INVALID;
+    }
+};
+
+template <TestValues::KeyID ID>
+static TestValues::Key mk_key(const char *name)
+{
+    using Traits = Configuration::UpdateSettings<TestValues>::UpdateTraits<ID>;
+    return TestValues::Key(ID, name,
+                           Configuration::serialize_value<TestValues, Traits>,
+                           Configuration::deserialize_value<TestValues, Traits>);
+}
+
+const std::array<TestValues::Key, TestValues::NUMBER_OF_KEYS> TestValues::all_keys
+{
+    mk_key<TestValues::KeyID::NAME>("@test:settings:name"),
+    mk_key<TestValues::KeyID::VOLUME>("@test:settings:volume"),
+    mk_key<TestValues::KeyID::IS_ENABLED>("@test:settings:enabled"),
+};
+
+TEST_SUITE_BEGIN("Configuration management");
+
+class ConfigManagerTestsFixture
+{
+  protected:
+    std::unique_ptr<MockMessages::Mock> mock_messages;
+    std::unique_ptr<MockOS::Mock> mock_os;
+    MockTimebase::Mock mock_timebase;
+    const TestValues defaults;
+
+    std::string written_;
+
+  public:
+    explicit ConfigManagerTestsFixture():
+        mock_messages(std::make_unique<MockMessages::Mock>()),
+        mock_os(std::make_unique<MockOS::Mock>()),
+        defaults("default", 10, false)
+    {
+        MockMessages::singleton = mock_messages.get();
+        MockOS::singleton = mock_os.get();
+    }
+
+    ~ConfigManagerTestsFixture()
+    {
+        try
+        {
+            mock_messages->done();
+            mock_os->done();
+        }
+        catch(...)
+        {
+            /* no throwing from dtors */
+        }
+
+        MockMessages::singleton = nullptr;
+        MockOS::singleton = nullptr;
+    }
+
+  protected:
+    void expect_file_mapped(const struct os_mapped_file_data &mapped)
+    {
+        expect<MockOS::MapFileToMemory>(mock_os, 0, 0, &mapped, "/etc/test.ini");
+        expect<MockOS::UnmapFile>(mock_os, 0, nullptr);
+    }
+
+    /*!
+     * Expect the configuration file to be stored from scratch.
+     *
+     * Syncing the temporary file fails if \p is_successful is false.
+     */
+    void expect_file_stored(bool is_successful = true)
+    {
+        expect<MockOS::MapFileToMemory>(mock_os, -1, ENOENT, false, "/etc/test.ini");
+        expect<MockOS::Stat>(mock_os, -1, ENOENT, "/etc/test.ini", nullptr);
+        expect<MockOS::FileNew>(mock_os, 123, 0, "/etc/test.ini.tmp");
+        expect<MockOS::WriteFromBuffer>(mock_os, 0,
+            [this] (const void *src, size_t count, int fd)
+            {
+                CHECK(fd == 123);
+                written_.append(static_cast<const char *>(src), count);
+                return 0;
+            });
+
+        if(!is_successful)
+        {
+            expect<MockOS::FileSync>(mock_os, -1, EIO, 123);
+            expect<MockOS::FileClose>(mock_os, 0, 123);
+            expect<MockOS::FileDelete>(mock_os, 0, 0, "/etc/test.ini.tmp");
+            expect<MockMessages::MsgError>(mock_messages, 0, LOG_ERR,
+                "Failed writing INI file \"/etc/test.ini\", keeping previous file",
+                false);
+            expect<MockMessages::MsgError>(mock_messages, 0, LOG_ERR,
+                "Failed storing configuration file \"/etc/test.ini\", will retry",
+                false);
+            return;
+        }
+
+        expect<MockOS::FileSync>(mock_os, 0, 0, 123);
+        expect<MockOS::FileCloseWithoutSync>(mock_os, 0, 123);
+        expect<MockOS::FileRename>(mock_os, true, 0, "/etc/test.ini.tmp", "/etc/test.ini");
+        expect<MockOS::SyncDir>(mock_os, 0, "/etc");
+        expect<MockOS::Stat>(mock_os, -1, ENOENT, "/etc/test.ini", nullptr);
+    }
+};
+
+/*!\test
+ * Values from a repeated configuration section are merged into the values
+ * from the first one, later assignments win.
+ */
+TEST_CASE_FIXTURE(ConfigManagerTestsFixture, "Load values from repeated configuration section")
+{
+    static const char text[] =
+        "[settings]\n"
+        "name = first\n"
+        "volume = 20\n"
+        "[other]\n"
+        "volume = 30\n"
+        "[settings]\n"
+        "volume = 40\n"
+        "enabled = true\n"
+        ;
+    const struct os_mapped_file_data mapped
+    {
+        20, const_cast<char *>(text), sizeof(text) - 1
+    };
+
+    Configuration::ConfigManager<TestValues> cm("/etc/test.ini", defaults);
+
+    expect_file_mapped(mapped);
+    REQUIRE(cm.load());
+
+    CHECK(cm.values().name_ == "first");
+    CHECK(cm.values().volume_ == 40);
+    CHECK(cm.values().is_enabled_);
+}
+
+static const char reload_base_text[] =
+    "[settings]\n"
+    "name = first\n"
+    "volume = 20\n"
+    "enabled = true\n"
+    ;
+
+/*!
+ * Load #reload_base_text, then reload from given text.
+ */
+class ConfigManagerReloadTestsFixture: public ConfigManagerTestsFixture
+{
+  protected:
+    Configuration::ConfigManager<TestValues> cm;
+    std::vector<std::pair<std::string, std::array<bool, TestValues::NUMBER_OF_KEYS>>> notifications_;
+
+  public:
+    explicit ConfigManagerReloadTestsFixture():
+        cm("/etc/test.ini", defaults)
+    {
+        const struct os_mapped_file_data mapped
+        {
+            20, const_cast<char *>(reload_base_text), sizeof(reload_base_text) - 1
+        };
+
+        expect_file_mapped(mapped);
+        REQUIRE(cm.load());
+        mock_os->done();
+
+        cm.set_updated_notification_callback(
+            [this] (const char *origin,
+                    const std::array<bool, TestValues::NUMBER_OF_KEYS> &changed)
+            {
+                notifications_.emplace_back(origin, changed);
+            });
+    }
+
+  protected:
+    bool reload(const char *text)
+    {
+        const struct os_mapped_file_data mapped
+        {
+            20, const_cast<char *>(text), strlen(text)
+        };
+
+        expect_file_mapped(mapped);
+        const bool result = cm.reload("reload");
+        mock_os->done();
+
+        return result;
+    }
+};
+
+/*!\test
+ * Only values which have really changed are updated and notified, values
+ * which are spelled differently but are equivalent are not.
+ */
+TEST_CASE_FIXTURE(ConfigManagerReloadTestsFixture, "Reload notifies about changed values only")
+{
+    REQUIRE(reload("[settings]\n"
+                   "enabled = true\n"
+                   "volume = 020\n"
+                   "name = second\n"
+                   "[other]\n"
+                   "volume = 5\n"));
+
+    CHECK(cm.values().name_ == "second");
+    CHECK(cm.values().volume_ == 20);
+    CHECK(cm.values().is_enabled_);
+
+    REQUIRE(notifications_.size() == 1);
+    CHECK(notifications_[0].first == "reload");
+    CHECK(notifications_[0].second[0]);
+    CHECK_FALSE(notifications_[0].second[1]);
+    CHECK_FALSE(notifications_[0].second[2]);
+}
+
+/*!\test
+ * Reloading an unchanged file does not send any notification.
+ */
+TEST_CASE_FIXTURE(ConfigManagerReloadTestsFixture, "Reload of unchanged file does not notify")
+{
+    REQUIRE(reload(reload_base_text));
+
+    CHECK(cm.values().name_ == "first");
+    CHECK(cm.values().volume_ == 20);
+    CHECK(cm.values().is_enabled_);
+    CHECK(notifications_.empty());
+}
+
+/*!\test
+ * Values removed from the file are reset to their defaults.
+ */
+TEST_CASE_FIXTURE(ConfigManagerReloadTestsFixture, "Reload resets removed values to defaults")
+{
+    REQUIRE(reload("[settings]\n"
+                   "name = first\n"));
+
+    CHECK(cm.values().name_ == "first");
+    CHECK(cm.values().volume_ == 10);
+    CHECK_FALSE(cm.values().is_enabled_);
+
+    REQUIRE(notifications_.size() == 1);
+    CHECK_FALSE(notifications_[0].second[0]);
+    CHECK(notifications_[0].second[1]);
+    CHECK(notifications_[0].second[2]);
+}
+
+/*!\test
+ * All values are reset to their defaults if the configuration section has
+ * been removed from the file.
+ */
+TEST_CASE_FIXTURE(ConfigManagerReloadTestsFixture, "Reload resets values from removed section to defaults")
+{
+    REQUIRE(reload("[other]\n"
+                   "name = second\n"));
+
+    CHECK(cm.values().name_ == "default");
+    CHECK(cm.values().volume_ == 10);
+    CHECK_FALSE(cm.values().is_enabled_);
+
+    REQUIRE(notifications_.size() == 1);
+    CHECK(notifications_[0].second[0]);
+    CHECK(notifications_[0].second[1]);
+    CHECK(notifications_[0].second[2]);
+}
+
+/*!\test
+ * Values remain unchanged if the file cannot be read.
+ */
+TEST_CASE_FIXTURE(ConfigManagerReloadTestsFixture, "Failed reload leaves values unchanged")
+{
+    expect<MockOS::MapFileToMemory>(mock_os, -1, EIO, false, "/etc/test.ini");
+    CHECK_FALSE(cm.reload("reload"));
+
+    CHECK(cm.values().name_ == "first");
+    CHECK(cm.values().volume_ == 20);
+    CHECK(cm.values().is_enabled_);
+    CHECK(notifications_.empty());
+}
+
+/*!\test
+ * In write-behind mode, all changes made within the debounce window are
+ * stored at once when the window has passed.
+ */
+TEST_CASE_FIXTURE(ConfigManagerTestsFixture, "Write-behind stores several updates once")
+{
+    Configuration::ConfigManager<TestValues> cm("/etc/test.ini", defaults);
+    cm.enable_write_behind(std::chrono::milliseconds(100), mock_timebase, false);
+
+    cm.get_update_scope("test")().name("first");
+    mock_timebase.step(50);
+    cm.get_update_scope("test")().volume(20);
+    mock_timebase.step(20);
+    cm.get_update_scope("test")().name("second");
+
+    mock_timebase.step(29);
+    CHECK(cm.process_write_behind());
+    mock_os->done();
+
+    mock_timebase.step(1);
+    expect_file_stored();
+    CHECK(cm.process_write_behind());
+    mock_os->done();
+    CHECK(written_ == "[settings]\nname = second\nvolume = 20\nenabled = false\n");
+
+    mock_timebase.step(1000);
+    CHECK(cm.process_write_behind());
+}
+
+/*!\test
+ * Pending changes are stored by #Configuration::ConfigManager::flush()
+ * without waiting for the debounce window to pass.
+ */
+TEST_CASE_FIXTURE(ConfigManagerTestsFixture, "Write-behind changes are stored on flush")
+{
+    Configuration::ConfigManager<TestValues> cm("/etc/test.ini", defaults);
+    cm.enable_write_behind(std::chrono::milliseconds(100), mock_timebase, false);
+
+    CHECK(cm.flush());
+
+    cm.get_update_scope("test")().volume(30);
+    mock_timebase.step(10);
+
+    expect_file_stored();
+    CHECK(cm.flush());
+    mock_os->done();
+    CHECK(written_ == "[settings]\nname = \nvolume = 30\nenabled = false\n");
+
+    CHECK(cm.flush());
+    mock_timebase.step(1000);
+    CHECK(cm.process_write_behind());
+}
+
+/*!\test
+ * Pending changes are stored by #Configuration::ConfigManager::shutdown(),
+ * later changes are stored immediately.
+ */
+TEST_CASE_FIXTURE(ConfigManagerTestsFixture, "Write-behind changes are stored on shutdown")
+{
+    Configuration::ConfigManager<TestValues> cm("/etc/test.ini", defaults);
+    cm.enable_write_behind(std::chrono::milliseconds(100), mock_timebase, false);
+
+    cm.get_update_scope("test")().name("pending");
+
+    expect_file_stored();
+    CHECK(cm.shutdown());
+    mock_os->done();
+    CHECK(written_ == "[settings]\nname = pending\nvolume = 0\nenabled = false\n");
+
+    written_.clear();
+    expect_file_stored();
+    cm.get_update_scope("test")().volume(5);
+    mock_os->done();
+    CHECK(written_ == "[settings]\nname = pending\nvolume = 5\nenabled = false\n");
+}
+
+/*!\test
+ * Changes remain pending if they cannot be stored, and storing them is
+ * retried after another debounce window.
+ */
+TEST_CASE_FIXTURE(ConfigManagerTestsFixture, "Write-behind changes are kept if storing fails")
+{
+    Configuration::ConfigManager<TestValues> cm("/etc/test.ini", defaults);
+    cm.enable_write_behind(std::chrono::milliseconds(100), mock_timebase, false);
+
+    cm.get_update_scope("test")().volume(40);
+    mock_timebase.step(100);
+
+    expect_file_stored(false);
+    CHECK_FALSE(cm.process_write_behind());
+    mock_os->done();
+    mock_messages->done();
+
+    mock_timebase.step(99);
+    CHECK(cm.process_write_behind());
+    mock_os->done();
+
+    written_.clear();
+    mock_timebase.step(1);
+    expect_file_stored();
+    CHECK(cm.process_write_behind());
+    mock_os->done();
+    CHECK(written_ == "[settings]\nname = \nvolume = 40\nenabled = false\n");
+
+    CHECK(cm.flush());
+}
+
+TEST_SUITE_END();
+
+/*!@}*/
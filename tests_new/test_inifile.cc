@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2018, 2019  T+A elektroakustik GmbH & Co. KG
+ * Copyright (C) 2018, 2019, 2026  T+A elektroakustik GmbH & Co. KG
  *
  * This file is part of the T+A Streaming Board software stack ("StrBoWare").
  *
@@ -26,6 +26,13 @@
 #include <doctest.h>
 
 #include "inifile.h"
+#include "inifile_snapshot.h"
+#include "inifile_cache.h"
+#include "inifile_journal.h"
+#include "inifile_overlay.h"
+#include "inifile_shared.h"
+#include "inifile_pool.h"
+#include "inifile_diff.h"
 
 #include "mock_messages.hh"
 #include "mock_os.hh"
@@ -33,6 +40,7 @@
 #include <iostream>
 #include <algorithm>
 #include <vector>
+#include <string>
 
 /*!
  * \addtogroup inifile_tests Unit tests
@@ -825,518 +833,2683 @@ TEST_CASE_FIXTURE(InifileParserTestsFixture, "Multiple assignments to a key name
     CHECK(pair->value == "foobar");
 }
 
-TEST_SUITE_END();
+/*!\test
+ * Parsing into an arena yields the same structure as parsing into separately
+ * allocated nodes.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Parse file into arena")
+{
+    static const char text[] =
+        "[section 1]\n"
+        "key 1 = value 1\n"
+        "key 2 = value 2\n"
+        "[section 2]\n"
+        "key = value\n"
+        "empty =\n"
+        "[section 1]\n"
+        "key 1 = value 3\n"
+        ;
 
+    const struct inifile_parse_options options { INIFILE_FLAG_ARENA, nullptr, 0, nullptr };
 
-TEST_SUITE_BEGIN("INI file manipulation");
+    REQUIRE(inifile_parse_from_memory_with_options(&ini, "test", text,
+                                                   sizeof(text) - 1,
+                                                   &options) == 0);
+    CHECK(ini.flags == INIFILE_FLAG_ARENA);
+    CHECK(ini.storage != nullptr);
+    REQUIRE(ini.sections_head != nullptr);
+    CHECK(ini.sections_head->next == ini.sections_tail);
 
-class InifileManipulationTestsFixture
+    const auto *section = inifile_find_section(&ini, "section 1", 0);
+    REQUIRE(section != nullptr);
+
+    const auto *pair = inifile_section_lookup_kv_pair(section, "key 1", 0);
+    REQUIRE(pair != nullptr);
+    CHECK(pair->value == "value 3");
+
+    pair = inifile_section_lookup_kv_pair(section, "key 2", 0);
+    REQUIRE(pair != nullptr);
+    CHECK(pair->value == "value 2");
+
+    section = inifile_find_section(&ini, "section 2", 0);
+    REQUIRE(section != nullptr);
+
+    pair = inifile_section_lookup_kv_pair(section, "empty", 0);
+    REQUIRE(pair != nullptr);
+    CHECK(pair->value == "");
+}
+
+/*!\test
+ * Structures allocated from an arena may be modified after parsing.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Modify file parsed into arena")
 {
-  protected:
-    std::unique_ptr<MockMessages::Mock> mock_messages;
-    std::unique_ptr<MockOS::Mock> mock_os;
-    struct ini_file ini;
+    static const char text[] =
+        "[section]\n"
+        "key 1 = value 1\n"
+        "key 2 = value 2\n"
+        ;
 
-    std::vector<uint8_t> os_write_buffer;
-    static constexpr int expected_os_write_fd = 123;
+    const struct inifile_parse_options options { INIFILE_FLAG_ARENA, nullptr, 0, nullptr };
 
-  public:
-    explicit InifileManipulationTestsFixture():
-        mock_messages(std::make_unique<MockMessages::Mock>()),
-        mock_os(std::make_unique<MockOS::Mock>())
+    REQUIRE(inifile_parse_from_memory_with_options(&ini, "test", text,
+                                                   sizeof(text) - 1,
+                                                   &options) == 0);
+
+    auto *section = inifile_find_section(&ini, "section", 0);
+    REQUIRE(section != nullptr);
+
+    /* large value to enforce allocation of a dedicated block */
+    const std::string long_value(64 * 1024, 'x');
+
+    CHECK(inifile_section_store_value(section, "key 1", 0, "changed", 0) != nullptr);
+    CHECK(inifile_section_store_value(section, "key 3", 0, long_value.c_str(), 0) != nullptr);
+    CHECK(inifile_section_remove_value(section, "key 2", 0));
+
+    CHECK(inifile_section_lookup_kv_pair(section, "key 1", 0)->value == "changed");
+    CHECK(inifile_section_lookup_kv_pair(section, "key 2", 0) == nullptr);
+    CHECK(inifile_section_lookup_kv_pair(section, "key 3", 0)->value == long_value.c_str());
+
+    section = inifile_new_section(&ini, "new section", 0);
+    REQUIRE(section != nullptr);
+    CHECK(inifile_section_store_value(section, "key", 0, "value", 0) != nullptr);
+
+    CHECK(inifile_remove_section_by_name(&ini, "section", 0));
+    CHECK(ini.sections_head == section);
+    CHECK(ini.sections_tail == section);
+}
+
+/*!\test
+ * Sections can be added to empty arena-backed structures.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Fill empty arena-backed file structure")
+{
+    inifile_new_with_flags(&ini, INIFILE_FLAG_ARENA);
+    CHECK(ini.storage == nullptr);
+
+    for(int i = 0; i < 100; ++i)
     {
-        MockMessages::singleton = mock_messages.get();
-        MockOS::singleton = mock_os.get();
+        const std::string name("section " + std::to_string(i));
+        auto *section = inifile_new_section(&ini, name.c_str(), 0);
+        REQUIRE(section != nullptr);
 
-        os_write_buffer.clear();
+        for(int j = 0; j < 50; ++j)
+        {
+            const std::string key("key " + std::to_string(j));
+            REQUIRE(inifile_section_store_value(section, key.c_str(), 0,
+                                                name.c_str(), 0) != nullptr);
+        }
+    }
 
-        /* allow #inifile_free() to work in dtor in case of early test
-         * failures */
-        inifile_new(&ini);
+    CHECK(ini.storage != nullptr);
+
+    const auto *section = inifile_find_section(&ini, "section 42", 0);
+    REQUIRE(section != nullptr);
+
+    const auto *pair = inifile_section_lookup_kv_pair(section, "key 49", 0);
+    REQUIRE(pair != nullptr);
+    CHECK(pair->value == "section 42");
+}
+
+/*!\test
+ * Lookups in indexed structures find the same entries as lookups in plain
+ * structures, and the order of sections and keys is preserved.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Parse file with index")
+{
+    std::string text;
+
+    for(int i = 0; i < 50; ++i)
+    {
+        text += "[section " + std::to_string(i) + "]\n";
+
+        for(int j = 0; j < 40; ++j)
+            text += "key " + std::to_string(j) + " = value " +
+                    std::to_string(i) + "/" + std::to_string(j) + "\n";
     }
 
-    ~InifileManipulationTestsFixture()
+    text += "[section 7]\nkey 3 = overwritten\n";
+
+    const struct inifile_parse_options options
     {
-        try
-        {
-            inifile_free(&ini);
+        INIFILE_FLAG_ARENA | INIFILE_FLAG_INDEX, nullptr, 0, nullptr
+    };
 
-            os_write_buffer.clear();
-            os_write_buffer.shrink_to_fit();
+    REQUIRE(inifile_parse_from_memory_with_options(&ini, "test",
+                                                   text.c_str(), text.size(),
+                                                   &options) == 0);
 
-            mock_messages->done();
-            mock_os->done();
+    int i = 0;
+    for(const auto *s = ini.sections_head; s != nullptr; s = s->next, ++i)
+    {
+        CHECK(std::string(s->name) == "section " + std::to_string(i));
+
+        int j = 0;
+        for(const auto *kv = s->values_head; kv != nullptr; kv = kv->next, ++j)
+            CHECK(std::string(kv->key) == "key " + std::to_string(j));
+
+        CHECK(j == 40);
+    }
+
+    CHECK(i == 50);
+
+    const auto *section = inifile_find_section(&ini, "section 7", 0);
+    REQUIRE(section != nullptr);
+    CHECK(inifile_section_lookup_kv_pair(section, "key 3", 0)->value == "overwritten");
+    CHECK(inifile_section_lookup_kv_pair(section, "key 39", 0)->value == "value 7/39");
+    CHECK(inifile_section_lookup_kv_pair(section, "key 40", 0) == nullptr);
+
+    section = inifile_find_section(&ini, "section 49", 0);
+    REQUIRE(section != nullptr);
+    CHECK(inifile_section_lookup_kv_pair(section, "key 0", 0)->value == "value 49/0");
+
+    CHECK(inifile_find_section(&ini, "section 50", 0) == nullptr);
+}
+
+/*!\test
+ * Indices are maintained while sections and keys are removed and added.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Modify indexed file structure")
+{
+    inifile_new_with_flags(&ini, INIFILE_FLAG_INDEX);
+
+    for(int i = 0; i < 20; ++i)
+    {
+        auto *section = inifile_new_section(&ini, ("s" + std::to_string(i)).c_str(), 0);
+        REQUIRE(section != nullptr);
+
+        for(int j = 0; j < 100; ++j)
+            REQUIRE(inifile_section_store_value(section, ("k" + std::to_string(j)).c_str(), 0,
+                                                "v", 0) != nullptr);
+    }
+
+    for(int i = 0; i < 20; i += 2)
+        CHECK(inifile_remove_section_by_name(&ini, ("s" + std::to_string(i)).c_str(), 0));
+
+    for(int i = 0; i < 20; ++i)
+    {
+        auto *section = inifile_find_section(&ini, ("s" + std::to_string(i)).c_str(), 0);
+
+        if(i % 2 == 0)
+        {
+            CHECK(section == nullptr);
+            continue;
         }
-        catch(...)
+
+        REQUIRE(section != nullptr);
+
+        for(int j = 0; j < 100; j += 3)
+            CHECK(inifile_section_remove_value(section, ("k" + std::to_string(j)).c_str(), 0));
+
+        CHECK_FALSE(inifile_section_remove_value(section, "k0", 0));
+
+        for(int j = 0; j < 100; ++j)
         {
-            /* no throwing from dtors */
+            const auto *kv = inifile_section_lookup_kv_pair(section, ("k" + std::to_string(j)).c_str(), 0);
+            CHECK((kv == nullptr) == (j % 3 == 0));
         }
+    }
+
+    CHECK(inifile_new_section(&ini, "s0", 0) != nullptr);
+    CHECK(ini.sections_tail == inifile_find_section(&ini, "s0", 0));
+}
+
+/*!\test
+ * Indices can be added to existing structures.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Build index for existing file structure")
+{
+    static const char text[] =
+        "[section 1]\n"
+        "key 1 = value 1\n"
+        "key 2 = value 2\n"
+        "[section 2]\n"
+        "key 1 = value 3\n"
+        ;
+
+    REQUIRE(inifile_parse_from_memory(&ini, "test", text, sizeof(text) - 1) == 0);
+    CHECK(ini.storage == nullptr);
+
+    REQUIRE(inifile_build_index(&ini) == 0);
+    CHECK(ini.flags == INIFILE_FLAG_INDEX);
+    CHECK(ini.storage != nullptr);
+
+    auto *section = inifile_find_section(&ini, "section 2", 0);
+    REQUIRE(section != nullptr);
+    CHECK(section->values_index != nullptr);
+    CHECK(inifile_section_lookup_kv_pair(section, "key 1", 0)->value == "value 3");
+
+    CHECK(inifile_section_store_value(section, "key 2", 0, "value 4", 0) != nullptr);
+    CHECK(inifile_section_lookup_kv_pair(section, "key 2", 0)->value == "value 4");
+
+    CHECK(inifile_remove_section_by_name(&ini, "section 1", 0));
+    CHECK(inifile_find_section(&ini, "section 1", 0) == nullptr);
+    CHECK(ini.sections_head == section);
+}
+
+static std::vector<std::string> iterate_section(const struct ini_section *section)
+{
+    std::vector<std::string> result;
+    struct inifile_section_iterator iter;
+
+    inifile_section_iterator_init(&iter, section);
+
+    for(const auto *kv = inifile_section_iterator_next(&iter);
+        kv != nullptr;
+        kv = inifile_section_iterator_next(&iter))
+        result.emplace_back(std::string(kv->key, kv->key_length) + "=" +
+                            std::string(kv->value, kv->value_length));
+
+    return result;
+}
+
+/*!	est
+ * Sections parsed with compact copies are iterated from the copies.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Parse file with compact copies of values")
+{
+    static const char text[] =
+        "[section 1]\n"
+        "key 1 = value 1\n"
+        "key 2 =\n"
+        "key 1 = value 3\n"
+        "[section 2]\n"
+        "[section 3]\n"
+        "a = b\n"
+        ;
+
+    const struct inifile_parse_options options { INIFILE_FLAG_COMPACT, nullptr, 0, nullptr };
+
+    REQUIRE(inifile_parse_from_memory_with_options(&ini, "test", text,
+                                                   sizeof(text) - 1,
+                                                   &options) == 0);
+
+    const auto *section = inifile_find_section(&ini, "section 1", 0);
+    REQUIRE(section != nullptr);
+    REQUIRE(section->values_compact != nullptr);
+    CHECK(iterate_section(section) ==
+          std::vector<std::string>({"key 1=value 3", "key 2="}));
+
+    section = inifile_find_section(&ini, "section 2", 0);
+    REQUIRE(section != nullptr);
+    CHECK(section->values_compact != nullptr);
+    CHECK(iterate_section(section).empty());
+
+    section = inifile_find_section(&ini, "section 3", 0);
+    REQUIRE(section != nullptr);
+    CHECK(section->values_compact != nullptr);
+    CHECK(iterate_section(section) == std::vector<std::string>({"a=b"}));
+}
+
+/*!\test
+ * Compact copies are dropped on modification and restored on request.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Modify file with compact copies of values")
+{
+    static const char text[] =
+        "[section 1]\n"
+        "key 1 = value 1\n"
+        "key 2 = value 2\n"
+        "[section 2]\n"
+        "key 1 = value 3\n"
+        ;
+
+    REQUIRE(inifile_parse_from_memory(&ini, "test", text, sizeof(text) - 1) == 0);
+
+    auto *section1 = inifile_find_section(&ini, "section 1", 0);
+    auto *section2 = inifile_find_section(&ini, "section 2", 0);
+    REQUIRE(section1 != nullptr);
+    REQUIRE(section2 != nullptr);
+    CHECK(section1->values_compact == nullptr);
+
+    const size_t usage_before = inifile_get_memory_usage(&ini);
+
+    REQUIRE(inifile_compact(&ini) == 0);
+    CHECK(ini.flags == INIFILE_FLAG_COMPACT);
+    CHECK(section1->values_compact != nullptr);
+    CHECK(section2->values_compact != nullptr);
+    CHECK(inifile_get_memory_usage(&ini) > usage_before);
+
+    CHECK(inifile_section_store_value(section1, "key 3", 0, "value 4", 0) != nullptr);
+    CHECK(section1->values_compact == nullptr);
+    CHECK(section2->values_compact != nullptr);
+    CHECK(iterate_section(section1) ==
+          std::vector<std::string>({"key 1=value 1", "key 2=value 2", "key 3=value 4"}));
+
+    CHECK(inifile_section_remove_value(section2, "key 1", 0));
+    CHECK(section2->values_compact == nullptr);
+    CHECK(iterate_section(section2).empty());
+
+    REQUIRE(inifile_compact(&ini) == 0);
+    CHECK(section1->values_compact != nullptr);
+    CHECK(section2->values_compact != nullptr);
+    CHECK(iterate_section(section1) ==
+          std::vector<std::string>({"key 1=value 1", "key 2=value 2", "key 3=value 4"}));
+}
+
+static std::vector<std::string> dump_inifile(const struct ini_file *inifile)
+{
+    std::vector<std::string> result;
+
+    for(const auto *s = inifile->sections_head; s != nullptr; s = s->next)
+    {
+        result.emplace_back("[" + std::string(s->name, s->name_length) + "]");
+
+        for(const auto *kv = s->values_head; kv != nullptr; kv = kv->next)
+            result.emplace_back(std::string(kv->key, kv->key_length) + "=" +
+                                std::string(kv->value, kv->value_length));
+    }
+
+    return result;
+}
+
+/*!\test
+ * Parsing in parallel yields the same structure as parsing sequentially,
+ * including sections which occur in more than one part of the input.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Parse large file in parallel")
+{
+    std::string text;
+
+    for(int i = 0; i < 4000; ++i)
+    {
+        text += "[section " + std::to_string(i % 1500) + "]\n";
+
+        for(int j = 0; j < 10; ++j)
+            text += "key " + std::to_string((i + j) % 13) + " = value " +
+                    std::to_string(i) + "/" + std::to_string(j) + "\n";
+    }
+
+    REQUIRE(text.size() > 4 * 64 * 1024);
+
+    const struct inifile_parse_options options
+    {
+        INIFILE_FLAG_ARENA | INIFILE_FLAG_INDEX, nullptr, 0, nullptr
+    };
+
+    REQUIRE(inifile_parse_from_memory_with_options(&ini, "test",
+                                                   text.c_str(), text.size(),
+                                                   &options) == 0);
+
+    struct ini_file parallel_ini;
+    REQUIRE(inifile_parse_from_memory_parallel(&parallel_ini, "test",
+                                               text.c_str(), text.size(),
+                                               &options, 4) == 0);
+
+    CHECK(dump_inifile(&parallel_ini) == dump_inifile(&ini));
+    CHECK(parallel_ini.flags == (INIFILE_FLAG_ARENA | INIFILE_FLAG_INDEX));
+
+    auto *section = inifile_find_section(&parallel_ini, "section 1499", 0);
+    REQUIRE(section != nullptr);
+    CHECK(inifile_section_lookup_kv_pair(section, "key 0", 0)->value == "value 2999/4");
+
+    CHECK(inifile_section_store_value(section, "key 0", 0, "changed", 0) != nullptr);
+    CHECK(inifile_remove_section_by_name(&parallel_ini, "section 0", 0));
+    CHECK(inifile_find_section(&parallel_ini, "section 0", 0) == nullptr);
+
+    inifile_free(&parallel_ini);
+}
+
+static int log_section_event(const char *name, size_t name_length,
+                             void *user_data)
+{
+    auto &log = *static_cast<std::vector<std::string> *>(user_data);
+    log.emplace_back("[" + std::string(name, name_length) + "]");
+    return log.back() == "[stop]" ? 1 : (log.back() == "[abort]" ? -1 : 0);
+}
+
+static int log_value_event(const char *key, size_t key_length,
+                           const char *value, size_t value_length,
+                           void *user_data)
+{
+    auto &log = *static_cast<std::vector<std::string> *>(user_data);
+    log.emplace_back(std::string(key, key_length) + "=" +
+                     std::string(value, value_length));
+    return 0;
+}
+
+/*!\test
+ * The event-based parser reports sections and assignments in file order,
+ * without merging anything.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Parse file into events")
+{
+    static const char text[] =
+        "[section 1]\n"
+        "key 1 = value 1\n"
+        "empty =\n"
+        "[section 2]\n"
+        "key 1 = value 2\n"
+        "[section 1]\n"
+        "key 1 = value 3\n"
+        "[stop]\n"
+        "key 1 = value 4\n"
+        ;
+
+    std::vector<std::string> log;
+
+    CHECK(inifile_parse_events_from_memory("test", text, sizeof(text) - 1,
+                                           log_section_event, log_value_event,
+                                           &log) == 0);
+
+    const std::vector<std::string> expected
+    {
+        "[section 1]", "key 1=value 1", "empty=",
+        "[section 2]", "key 1=value 2",
+        "[section 1]", "key 1=value 3",
+        "[stop]",
+    };
+
+    CHECK(log == expected);
+}
+
+/*!\test
+ * Callbacks may abort the event-based parser.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Abort parsing file into events")
+{
+    static const char text[] =
+        "[section]\n"
+        "key = value\n"
+        "[abort]\n"
+        "key = value\n"
+        ;
+
+    std::vector<std::string> log;
+
+    CHECK(inifile_parse_events_from_memory("test", text, sizeof(text) - 1,
+                                           log_section_event, log_value_event,
+                                           &log) == -1);
+    CHECK(log.size() == 3);
+}
+
+/*!\test
+ * Data fed to the push parser in chunks of any size yields the same
+ * structure as parsing the whole buffer at once.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Parse file in chunks")
+{
+    static const char text[] =
+        "[section 1]\n"
+        "key 1 = value 1\n"
+        "  key 2=value 2  \n"
+        "\n"
+        "[section 2]\n"
+        "empty =\n"
+        "key = a somewhat longer value\n"
+        "[section 1]\n"
+        "key 1 = value 3\n"
+        "last = no line feed"
+        ;
+
+    struct ini_file expected;
+    REQUIRE(inifile_parse_from_memory(&expected, "test", text, sizeof(text) - 1) == 0);
+
+    for(size_t chunk_size = 1; chunk_size < sizeof(text); ++chunk_size)
+    {
+        struct inifile_push_parser parser;
+
+        inifile_free(&ini);
+        REQUIRE(inifile_push_parser_init(&parser, &ini, "test", nullptr) == 0);
+
+        for(size_t pos = 0; pos < sizeof(text) - 1; pos += chunk_size)
+            REQUIRE(inifile_push_parser_feed(&parser, text + pos,
+                                             std::min(chunk_size, sizeof(text) - 1 - pos)) == 0);
+
+        REQUIRE(inifile_push_parser_finish(&parser) == 0);
+        CHECK(ini.storage == nullptr);
+
+        const auto *s = ini.sections_head;
+
+        for(const auto *es = expected.sections_head; es != nullptr; es = es->next, s = s->next)
+        {
+            REQUIRE(s != nullptr);
+            CHECK(s->name == es->name);
+
+            const auto *kv = s->values_head;
+
+            for(const auto *ekv = es->values_head; ekv != nullptr; ekv = ekv->next, kv = kv->next)
+            {
+                REQUIRE(kv != nullptr);
+                CHECK(kv->key == ekv->key);
+                CHECK(kv->value == ekv->value);
+                CHECK(kv->value_length == ekv->value_length);
+            }
+
+            CHECK(kv == nullptr);
+        }
+
+        CHECK(s == nullptr);
+    }
+
+    inifile_free(&expected);
+}
+
+/*!\test
+ * Sections not in the list of wanted sections are skipped without parsing
+ * their contents.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Parse only selected sections")
+{
+    static const char text[] =
+        "[unwanted]\n"
+        "key = value\n"
+        "this is junk which would cause an error message\n"
+        "[wanted]\n"
+        "key 1 = value 1\n"
+        "[also unwanted]\n"
+        "\n"
+        "   more junk ] =\n"
+        "  [also wanted]  \n"
+        "key = value\n"
+        "[wanted]\n"
+        "key 2 = value 2\n"
+        "[unwanted]\n"
+        "key = value"
+        ;
+
+    static const char *const sections[] = { "wanted", "also wanted", "missing" };
+    const struct inifile_parse_options options { INIFILE_FLAG_NONE, sections, 3, nullptr };
+
+    for(size_t chunk_size = 0; chunk_size < 8; ++chunk_size)
+    {
+        inifile_free(&ini);
+
+        if(chunk_size == 0)
+            REQUIRE(inifile_parse_from_memory_with_options(&ini, "test", text,
+                                                           sizeof(text) - 1,
+                                                           &options) == 0);
+        else
+        {
+            struct inifile_push_parser parser;
+
+            REQUIRE(inifile_push_parser_init(&parser, &ini, "test", &options) == 0);
+
+            for(size_t pos = 0; pos < sizeof(text) - 1; pos += chunk_size)
+                REQUIRE(inifile_push_parser_feed(&parser, text + pos,
+                                                 std::min(chunk_size, sizeof(text) - 1 - pos)) == 0);
+
+            REQUIRE(inifile_push_parser_finish(&parser) == 0);
+        }
+
+        const auto *section = ini.sections_head;
+        REQUIRE(section != nullptr);
+        CHECK(section->name == "wanted");
+        REQUIRE(section->values_head != nullptr);
+        CHECK(section->values_head->key == "key 1");
+        REQUIRE(section->values_head->next != nullptr);
+        CHECK(section->values_head->next->key == "key 2");
+
+        section = section->next;
+        REQUIRE(section != nullptr);
+        CHECK(section->name == "also wanted");
+        REQUIRE(section->values_head != nullptr);
+        CHECK(section->values_head->key == "key");
+        CHECK(section->next == nullptr);
+    }
+}
+
+/*!\test
+ * Long tokens and long runs of blanks are scanned in blocks, make sure the
+ * block boundaries do not matter.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Long lines are parsed correctly")
+{
+    for(size_t length = 1; length <= 70; ++length)
+    {
+        const std::string blanks(length, length % 3 == 0 ? '\t' : ' ');
+        const std::string key(length, 'k');
+        const std::string value(length, 'v');
+        const std::string name("section " + std::string(length, 's'));
+        const std::string text =
+            blanks + "[" + name + "]" + blanks + "\n" +
+            blanks + key + blanks + "=" + blanks + value + blanks + "\n" +
+            "x" + blanks + "=" + blanks + "\n" +
+            "y" + blanks + "=" + value;
+
+        inifile_free(&ini);
+        REQUIRE(inifile_parse_from_memory(&ini, "test", text.c_str(), text.size()) == 0);
+
+        const auto *section = inifile_find_section(&ini, name.c_str(), 0);
+        REQUIRE(section != nullptr);
+
+        const auto *pair = inifile_section_lookup_kv_pair(section, key.c_str(), 0);
+        REQUIRE(pair != nullptr);
+        CHECK(pair->value == value);
+
+        pair = inifile_section_lookup_kv_pair(section, "x", 0);
+        REQUIRE(pair != nullptr);
+        CHECK(pair->value == "");
+
+        pair = inifile_section_lookup_kv_pair(section, "y", 0);
+        REQUIRE(pair != nullptr);
+        CHECK(pair->value == value);
+    }
+}
+
+/*!\test
+ * Strings in borrowed mode point into the parsed input, stored strings are
+ * copied.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Parse file with borrowed strings")
+{
+    static const char text[] =
+        "[section 1]\n"
+        "key 1 = value 1\n"
+        "key 2 = value 2\n"
+        "empty =\n"
+        "[section 1]\n"
+        "key 1 = value 3\n"
+        ;
+
+    const struct inifile_parse_options options { INIFILE_FLAG_BORROWED, nullptr, 0, nullptr };
+
+    REQUIRE(inifile_parse_from_memory_with_options(&ini, "test", text,
+                                                   sizeof(text) - 1,
+                                                   &options) == 0);
+    CHECK(ini.flags == (INIFILE_FLAG_BORROWED | INIFILE_FLAG_ARENA));
+    CHECK(ini.storage != nullptr);
+
+    auto *section = inifile_find_section(&ini, "section 1", 0);
+    REQUIRE(section != nullptr);
+    CHECK(section->name - text == 1);
+    CHECK(section->name_length == 9);
+
+    auto *pair = inifile_section_lookup_kv_pair(section, "key 1", 0);
+    REQUIRE(pair != nullptr);
+    CHECK(pair->key - text == 12);
+    CHECK(pair->value - text == ptrdiff_t(sizeof(text) - 1 - 8));
+    CHECK(pair->value_length == 7);
+    CHECK(std::string(pair->value, pair->value_length) == "value 3");
+
+    pair = inifile_section_lookup_kv_pair(section, "empty", 0);
+    REQUIRE(pair != nullptr);
+    CHECK(pair->value_length == 0);
+
+    pair = inifile_section_store_value(section, "key 2", 0, "new value", 0);
+    REQUIRE(pair != nullptr);
+    CHECK(pair->key - text == 28);
+    CHECK(pair->value_length == 9);
+    CHECK(pair->value == "new value");
+
+    pair = inifile_section_store_value(section, "key 3", 0, "value 4", 0);
+    REQUIRE(pair != nullptr);
+    CHECK(pair->key == "key 3");
+    CHECK(pair->value == "value 4");
+
+    section = inifile_new_section(&ini, "section 2", 0);
+    REQUIRE(section != nullptr);
+    CHECK(section->name == "section 2");
+}
+
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Many duplicate keys in large file keep last assignments")
+{
+    static constexpr unsigned int number_of_keys = 2000;
+    std::string text("[section]\n");
+
+    for(unsigned int i = 0; i < number_of_keys; ++i)
+        text += "key " + std::to_string(i) + " = first " + std::to_string(i) + "\n";
+
+    text += "[other]\nfoo = bar\n[section]\n";
+
+    for(unsigned int i = 0; i < number_of_keys; i += 2)
+        text += "key " + std::to_string(i) + " = second " + std::to_string(i) + "\n";
+
+    REQUIRE(inifile_parse_from_memory(&ini, "test", text.c_str(), text.size()) == 0);
+
+    /* temporary parser indices are gone */
+    CHECK(ini.storage == nullptr);
+
+    auto *section = inifile_find_section(&ini, "section", 0);
+    REQUIRE(section != nullptr);
+    CHECK(section->next != nullptr);
+    CHECK(section->next->next == nullptr);
+    CHECK(section->storage == nullptr);
+    CHECK(section->values_index == nullptr);
+
+    unsigned int i = 0;
+
+    for(const auto *kv = section->values_head; kv != nullptr; kv = kv->next, ++i)
+    {
+        REQUIRE(i < number_of_keys);
+        CHECK(kv->key == "key " + std::to_string(i));
+        CHECK(kv->value == ((i % 2) == 0 ? "second " : "first ") + std::to_string(i));
+    }
+
+    CHECK(i == number_of_keys);
+}
+
+TEST_SUITE_END();
+
+
+TEST_SUITE_BEGIN("INI file manipulation");
+
+class InifileManipulationTestsFixture
+{
+  protected:
+    std::unique_ptr<MockMessages::Mock> mock_messages;
+    std::unique_ptr<MockOS::Mock> mock_os;
+    struct ini_file ini;
+
+    std::vector<uint8_t> os_write_buffer;
+    static constexpr int expected_os_write_fd = 123;
+
+  public:
+    explicit InifileManipulationTestsFixture():
+        mock_messages(std::make_unique<MockMessages::Mock>()),
+        mock_os(std::make_unique<MockOS::Mock>())
+    {
+        MockMessages::singleton = mock_messages.get();
+        MockOS::singleton = mock_os.get();
+
+        os_write_buffer.clear();
+
+        /* allow #inifile_free() to work in dtor in case of early test
+         * failures */
+        inifile_new(&ini);
+    }
+
+    ~InifileManipulationTestsFixture()
+    {
+        try
+        {
+            inifile_free(&ini);
+
+            os_write_buffer.clear();
+            os_write_buffer.shrink_to_fit();
+
+            mock_messages->done();
+            mock_os->done();
+        }
+        catch(...)
+        {
+            /* no throwing from dtors */
+        }
+
+        MockMessages::singleton = nullptr;
+        MockOS::singleton = nullptr;
+    }
+
+    MockOS::WriteFromBuffer::Callback buffer_writer()
+    {
+        return
+            [this] (const void *src, size_t count, int fd)
+            {
+                return write_from_buffer_callback(src, count, fd);
+            };
+    }
+
+  private:
+    int write_from_buffer_callback(const void *src, size_t count, int fd)
+    {
+        CHECK(fd == int(expected_os_write_fd));
+        CHECK(count > 0);
+        REQUIRE(src != nullptr);
+        std::copy_n(static_cast<const uint8_t *>(src), count,
+                    std::back_inserter(os_write_buffer));
+        return 0;
+    }
+};
+
+/*!\test
+ * Initialize INI file structure in memory.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Create empty file structure")
+{
+    std::fill(reinterpret_cast<uint8_t *>(&ini),
+              reinterpret_cast<uint8_t *>(&ini) + sizeof(ini), 0xff);
+
+    inifile_new(&ini);
+    CHECK(ini.sections_head == nullptr);
+    CHECK(ini.sections_tail == nullptr);
+}
+
+/*!\test
+ * Construct an INI file containing two sections with a few assignments and a
+ * third, empty section.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "New_write_ini_file")
+{
+    auto *section = inifile_new_section(&ini, "First", 0);
+    REQUIRE(section != nullptr);
+
+    CHECK(inifile_section_store_value(section, "key 1", 0, "value 1", 0) != nullptr);
+    CHECK(inifile_section_store_value(section, "key 2", 0, "value 2", 0) != nullptr);
+    CHECK(inifile_section_store_value(section, "key 3", 0, "value 3", 0) != nullptr);
+
+    section = inifile_new_section(&ini, "Second", 0);
+    CHECK(section != nullptr);
+
+    section = inifile_new_section(&ini, "Third", 0);
+    CHECK(section != nullptr);
+
+    CHECK(inifile_section_store_value(section, "foo", 0, "bar", 0) != nullptr);
+    CHECK(inifile_section_store_value(section, "foobar", 0, "barfoo", 0) != nullptr);
+
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+
+    REQUIRE(inifile_write_to_file(&ini, "outfile.config") == 0);
+
+    static const char expected_ini_file[] =
+        "[First]\n"
+        "key 1 = value 1\n"
+        "key 2 = value 2\n"
+        "key 3 = value 3\n"
+        "[Second]\n"
+        "[Third]\n"
+        "foo = bar\n"
+        "foobar = barfoo\n"
+        ;
+
+    os_write_buffer.push_back(0);
+    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) == expected_ini_file);
+}
+
+/*!\test
+ * Regular adding and removing of sections.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Add and remove sections")
+{
+    CHECK(inifile_new_section(&ini, "Foo", 0) != nullptr);
+    CHECK(ini.sections_head != nullptr);
+    CHECK(ini.sections_head == ini.sections_tail);
+    CHECK(inifile_remove_section_by_name(&ini, "Foo", 3));
+    CHECK(ini.sections_head == nullptr);
+    CHECK(ini.sections_tail == nullptr);
+
+    CHECK(inifile_new_section(&ini, "Bar", 3) != nullptr);
+    CHECK(ini.sections_head != nullptr);
+    CHECK(ini.sections_head == ini.sections_tail);
+    CHECK(inifile_new_section(&ini, "Foobar", 6) != nullptr);
+    CHECK(ini.sections_head != nullptr);
+    CHECK(ini.sections_head != ini.sections_tail);
+    CHECK(inifile_new_section(&ini, "Baz", 3) != nullptr);
+    CHECK(inifile_new_section(&ini, "Qux", 3) != nullptr);
+
+    CHECK(inifile_remove_section_by_name(&ini, "Bar", 3));
+    CHECK(inifile_remove_section(&ini, inifile_find_section(&ini, "Baz", 0)));
+    const struct ini_section *section = inifile_find_section(&ini, "Qux", 0);
+    CHECK(inifile_remove_section_by_name(&ini, section->name, section->name_length));
+    CHECK(inifile_remove_section_by_name(&ini, "Foobar", 0));
+
+    CHECK(ini.sections_head == nullptr);
+    CHECK(ini.sections_tail == nullptr);
+}
+
+/*!\test
+ * Trying to remove nonexistent sections by name is not fatal.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Removing nonexistent section by name returns failure")
+{
+    /* OK for empty files */
+    CHECK_FALSE(inifile_remove_section_by_name(&ini, "Foo", 0));
+
+    CHECK(inifile_new_section(&ini, "Empty", 0) != nullptr);
+
+    /* OK for files with content */
+    CHECK_FALSE(inifile_remove_section_by_name(&ini, "Foo", 0));
+}
+
+/*!\test
+ * Trying to remove nonexistent sections by wrong pointer is not fatal.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Removing nonexistent section by section pointer returns failure")
+{
+    auto *does_not_exist = reinterpret_cast<struct ini_section *>(0x0123);
+
+    /* OK for empty files */
+    CHECK_FALSE(inifile_remove_section(&ini, does_not_exist));
+
+    struct ini_section *section = inifile_new_section(&ini, "Empty", 0);
+    CHECK(section != nullptr);
+
+    /* OK for files with content */
+    CHECK_FALSE(inifile_remove_section(&ini, does_not_exist));
+}
+
+/*!\test
+ * Trying to remove \c nullptr section is not fatal.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Removing null section returns failure")
+{
+    /* OK for empty files */
+    CHECK_FALSE(inifile_remove_section(&ini, nullptr));
+
+    CHECK(inifile_new_section(&ini, "Empty", 0) != nullptr);
+
+    /* OK for files with content */
+    CHECK_FALSE(inifile_remove_section(&ini, nullptr));
+}
+
+/*!\test
+ * It is possible to load an INI file, remove a section, and write it back with
+ * the section removed.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove section from file")
+{
+    static const char text[] =
+        "[First]\n"
+        "key 1-1 = value 1-1\n"
+        "key 1-2 = value 1-2\n"
+        "[Second]\n"
+        "key 2-1 = value 2-1\n"
+        "key 2-2 = value 2-2\n"
+        "key 2-3 = value 2-3\n"
+        "[Third]\n"
+        "key 3-1 = value 3-1\n"
+        "key 3-2 = value 3-2\n"
+        ;
+
+    REQUIRE(inifile_parse_from_memory(&ini, "test", text, sizeof(text) - 1) == 0);
+    CHECK(ini.sections_head != nullptr);
+
+    CHECK(inifile_remove_section_by_name(&ini, "Second", 0));
+
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+
+    REQUIRE(inifile_write_to_file(&ini, "outfile.config") == 0);
+
+    static const char expected_ini_file[] =
+        "[First]\n"
+        "key 1-1 = value 1-1\n"
+        "key 1-2 = value 1-2\n"
+        "[Third]\n"
+        "key 3-1 = value 3-1\n"
+        "key 3-2 = value 3-2\n"
+        ;
+
+    os_write_buffer.push_back(0);
+    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) == expected_ini_file);
+}
+
+/*!\test
+ * It is possible to assign empty values to keys.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Write empty value to .ini file")
+{
+    auto *section = inifile_new_section(&ini, "First", 0);
+    REQUIRE(section != nullptr);
+
+    CHECK(inifile_section_store_empty_value(section, "empty", 0) != nullptr);
+
+    section = inifile_new_section(&ini, "Second", 0);
+    REQUIRE(section != nullptr);
+
+    CHECK(inifile_section_store_value(section, "foo", 0, "bar", 0) != nullptr);
+    CHECK(inifile_section_store_empty_value(section, "foobar", 0) != nullptr);
+
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+
+    REQUIRE(inifile_write_to_file(&ini, "outfile.config") == 0);
+
+    static const char expected_ini_file[] =
+        "[First]\n"
+        "empty = \n"
+        "[Second]\n"
+        "foo = bar\n"
+        "foobar = \n"
+        ;
+
+    os_write_buffer.push_back(0);
+    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) == expected_ini_file);
+}
+
+/*!\test
+ * Parse an INI file, change a few values, write a new INI file containing the
+ * changes.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Manipulate value in file")
+{
+    static const char text[] =
+        "[First]\n"
+        "key 1-1 = value 1-1\n"
+        "key 1-2 = value 1-2\n"
+        "[Second]\n"
+        "key 2-1 = value 2-1\n"
+        "key 2-2 = value 2-2\n"
+        "key 2-3 = value 2-3\n"
+        "[Third]\n"
+        "key 3-1 = value 3-1\n"
+        "key 3-2 = value 3-2\n"
+        ;
+
+    REQUIRE(inifile_parse_from_memory(&ini, "test", text, sizeof(text) - 1) == 0);
+    CHECK(ini.sections_head != nullptr);
+
+    auto *section = inifile_find_section(&ini, "Second", 0);
+    REQUIRE(section != nullptr);
+
+    CHECK(inifile_section_store_value(section, "key 2-1", 0, "changed value", 0) != nullptr);
+    CHECK(inifile_section_store_value(section, "key 11-13", 0, "new value", 0) != nullptr);
+
+    section = inifile_find_section(&ini, "Third", 0);
+    REQUIRE(section != nullptr);
+
+    CHECK(inifile_section_store_value(section, "key 3-2", 0, "also changed", 0) != nullptr);
+
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+
+    REQUIRE(inifile_write_to_file(&ini, "outfile.config") == 0);
+
+    static const char expected_ini_file[] =
+        "[First]\n"
+        "key 1-1 = value 1-1\n"
+        "key 1-2 = value 1-2\n"
+        "[Second]\n"
+        "key 2-1 = changed value\n"
+        "key 2-2 = value 2-2\n"
+        "key 2-3 = value 2-3\n"
+        "key 11-13 = new value\n"
+        "[Third]\n"
+        "key 3-1 = value 3-1\n"
+        "key 3-2 = also changed\n"
+        ;
+
+    os_write_buffer.push_back(0);
+    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) == expected_ini_file);
+}
+
+/*!\test
+ * Large files are written in a few large chunks.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Write large file")
+{
+    auto *section = inifile_new_section(&ini, "section", 0);
+    REQUIRE(section != nullptr);
+
+    std::string expected_ini_file("[section]\n");
+
+    for(unsigned int i = 0; i < 500; ++i)
+    {
+        const std::string key("key " + std::to_string(i));
+        const std::string value("value " + std::to_string(i));
+        CHECK(inifile_section_store_value(section, key.c_str(), 0, value.c_str(), 0) != nullptr);
+        expected_ini_file += key + " = " + value + "\n";
+    }
+
+    const std::string huge_value(10000, 'x');
+    CHECK(inifile_section_store_value(section, "huge", 0, huge_value.c_str(), 0) != nullptr);
+    expected_ini_file += "huge = " + huge_value + "\n";
+
+    /* two full buffers, the remaining short lines, the huge value written
+     * directly, and the final line feed */
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config");
+    for(int i = 0; i < 5; ++i)
+        expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+
+    REQUIRE(inifile_write_to_file(&ini, "outfile.config") == 0);
+
+    os_write_buffer.push_back(0);
+    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) == expected_ini_file);
+}
+
+/*!\test
+ * In case #os_file_new() fails for whatever reason, function
+ * #inifile_write_to_file() returns an error.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Write file fails if file cannot be created")
+{
+    CHECK(inifile_new_section(&ini, "section", 0) != nullptr);
+    expect<MockOS::FileNew>(mock_os, -1, ENOSPC, "outfile.config");
+    CHECK(inifile_write_to_file(&ini, "outfile.config") == -1);
+    CHECK(os_write_buffer.empty());
+}
+
+/*!\test
+ * In case #os_write_from_buffer() fails for whatever reason, function
+ * #inifile_write_to_file() deletes the output file and returns an error.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Write file fails if file cannot be written")
+{
+    CHECK(inifile_new_section(&ini, "section", 0) != nullptr);
+
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config");
+    expect<MockOS::WriteFromBuffer>(mock_os, -1, ENOSPC, false, 10, expected_os_write_fd);
+    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+    expect<MockOS::FileDelete>(mock_os, 0, 0, "outfile.config");
+    expect<MockMessages::MsgError>(mock_messages, 0, LOG_ERR,
+        "Failed writing INI file \"outfile.config\", deleting partially written file",
+        false);
+
+    CHECK(inifile_write_to_file(&ini, "outfile.config") == -1);
+
+    CHECK(os_write_buffer.empty());
+}
+
+/*!\test
+ * In case #os_write_from_buffer() fails for whatever reason, function
+ * #inifile_write_to_file() tries to delete the output file. If this fails,
+ * then an additional diagnostic message is emitted.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Message on failure to delete file after failure to write to file")
+{
+    CHECK(inifile_new_section(&ini, "section", 0) != nullptr);
+
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config");
+    expect<MockOS::WriteFromBuffer>(mock_os, -1, EIO, false, 10, expected_os_write_fd);
+    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+    expect<MockOS::FileDelete>(mock_os, -1, EIO, "outfile.config");
+    expect<MockMessages::MsgError>(mock_messages, 0, LOG_ERR,
+        "Failed writing INI file \"outfile.config\", deleting partially written file",
+        false);
+    expect<MockMessages::MsgError>(mock_messages, EIO, LOG_ERR,
+        "Failed to delete incomplete file (Input/output error)", false);
+
+    CHECK(inifile_write_to_file(&ini, "outfile.config") == -1);
+
+    CHECK(os_write_buffer.empty());
+}
+
+/*!\test
+ * Atomic write goes through a temporary file which is renamed over the
+ * target file.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Write file atomically")
+{
+    auto *section = inifile_new_section(&ini, "section", 0);
+    REQUIRE(section != nullptr);
+    CHECK(inifile_section_store_value(section, "key", 0, "value", 0) != nullptr);
+
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "/etc/outfile.config.tmp");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileSync>(mock_os, 0, 0, expected_os_write_fd);
+    expect<MockOS::FileCloseWithoutSync>(mock_os, 0, expected_os_write_fd);
+    expect<MockOS::FileRename>(mock_os, true, 0, "/etc/outfile.config.tmp", "/etc/outfile.config");
+    expect<MockOS::SyncDir>(mock_os, 0, "/etc");
+
+    REQUIRE(inifile_write_to_file_atomically(&ini, "/etc/outfile.config") == 0);
+
+    os_write_buffer.push_back(0);
+    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) == "[section]\nkey = value\n");
+}
+
+/*!\test
+ * Directory of relative file name without path is the current directory.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Write file atomically to current directory")
+{
+    CHECK(inifile_new_section(&ini, "section", 0) != nullptr);
+
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config.tmp");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileSync>(mock_os, 0, 0, expected_os_write_fd);
+    expect<MockOS::FileCloseWithoutSync>(mock_os, 0, expected_os_write_fd);
+    expect<MockOS::FileRename>(mock_os, true, 0, "outfile.config.tmp", "outfile.config");
+    expect<MockOS::SyncDir>(mock_os, 0, ".");
+
+    REQUIRE(inifile_write_to_file_atomically(&ini, "outfile.config") == 0);
+}
+
+/*!\test
+ * In case the temporary file cannot be written, it is deleted and the
+ * target file is not touched.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Atomic write keeps previous file if temporary file cannot be written")
+{
+    CHECK(inifile_new_section(&ini, "section", 0) != nullptr);
+
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "/outfile.config.tmp");
+    expect<MockOS::WriteFromBuffer>(mock_os, -1, ENOSPC, false, 10, expected_os_write_fd);
+    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+    expect<MockOS::FileDelete>(mock_os, 0, 0, "/outfile.config.tmp");
+    expect<MockMessages::MsgError>(mock_messages, 0, LOG_ERR,
+        "Failed writing INI file \"/outfile.config\", keeping previous file",
+        false);
+
+    CHECK(inifile_write_to_file_atomically(&ini, "/outfile.config") == -1);
+}
+
+/*!\test
+ * In case the temporary file cannot be synced to storage, it is deleted and
+ * not renamed over the target file.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Atomic write keeps previous file if temporary file cannot be synced")
+{
+    CHECK(inifile_new_section(&ini, "section", 0) != nullptr);
+
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "/outfile.config.tmp");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileSync>(mock_os, -1, EIO, expected_os_write_fd);
+    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+    expect<MockOS::FileDelete>(mock_os, 0, 0, "/outfile.config.tmp");
+    expect<MockMessages::MsgError>(mock_messages, 0, LOG_ERR,
+        "Failed writing INI file \"/outfile.config\", keeping previous file",
+        false);
+
+    CHECK(inifile_write_to_file_atomically(&ini, "/outfile.config") == -1);
+}
+
+/*!\test
+ * In case the temporary file cannot be renamed, it is deleted.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Atomic write deletes temporary file if it cannot be renamed")
+{
+    CHECK(inifile_new_section(&ini, "section", 0) != nullptr);
+
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "/outfile.config.tmp");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileSync>(mock_os, 0, 0, expected_os_write_fd);
+    expect<MockOS::FileCloseWithoutSync>(mock_os, 0, expected_os_write_fd);
+    expect<MockOS::FileRename>(mock_os, false, EACCES, "/outfile.config.tmp", "/outfile.config");
+    expect<MockOS::FileDelete>(mock_os, 0, 0, "/outfile.config.tmp");
+
+    CHECK(inifile_write_to_file_atomically(&ini, "/outfile.config") == -1);
+}
+
+static void expect_atomic_write(std::unique_ptr<MockOS::Mock> &mock_os,
+                                const MockOS::WriteFromBuffer::Callback &writer)
+{
+    expect<MockOS::FileNew>(mock_os, 123, 0, "/etc/test.ini.tmp");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, writer);
+    expect<MockOS::FileSync>(mock_os, 0, 0, 123);
+    expect<MockOS::FileCloseWithoutSync>(mock_os, 0, 123);
+    expect<MockOS::FileRename>(mock_os, true, 0, "/etc/test.ini.tmp", "/etc/test.ini");
+    expect<MockOS::SyncDir>(mock_os, 0, "/etc");
+}
+
+/*!\test
+ * Writing changes keeps the layout of the original text, only changed
+ * lines are replaced.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Write changes to file keeps layout of unchanged lines")
+{
+    static const char text[] =
+        "[general]\n"
+        "  name   =   Alpha  \n"
+        "mode=fast\n"
+        "\n"
+        "flag = 0\n"
+        "[old]\n"
+        "x = 1\n"
+        "\n"
+        "[net]\n"
+        "ip = 1.2.3.4\n"
+        "ip = 5.6.7.8\n"
+        "port=80\n"
+        ;
+
+    const struct inifile_parse_options options { INIFILE_FLAG_BORROWED, nullptr, 0, nullptr };
+
+    REQUIRE(inifile_parse_from_memory_with_options(&ini, "test", text,
+                                                   sizeof(text) - 1,
+                                                   &options) == 0);
+
+    auto *general = inifile_find_section(&ini, "general", 0);
+    REQUIRE(general != nullptr);
+    CHECK(inifile_section_store_value(general, "name", 0, "Alpha", 0) != nullptr);
+    CHECK(inifile_section_store_value(general, "flag", 0, "1", 0) != nullptr);
+    CHECK(inifile_section_remove_value(general, "mode", 0));
+    CHECK(inifile_section_store_value(general, "level", 0, "3", 0) != nullptr);
+    CHECK(inifile_remove_section_by_name(&ini, "old", 0));
+
+    auto *extra = inifile_new_section(&ini, "extra", 0);
+    REQUIRE(extra != nullptr);
+    CHECK(inifile_section_store_value(extra, "a", 0, "b", 0) != nullptr);
+
+    expect_atomic_write(mock_os, buffer_writer());
+    REQUIRE(inifile_write_changes_to_file(&ini, "/etc/test.ini") == 0);
+
+    os_write_buffer.push_back(0);
+    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) ==
+          "[general]\n"
+          "  name   =   Alpha  \n"
+          "\n"
+          "flag = 1\n"
+          "level = 3\n"
+          "[net]\n"
+          "ip = 1.2.3.4\n"
+          "ip = 5.6.7.8\n"
+          "port=80\n"
+          "[extra]\n"
+          "a = b\n");
+}
+
+/*!\test
+ * Superseded assignments of changed values are removed, sections which were
+ * removed and added again are written as new sections.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Write changes to file with duplicate keys and recreated section")
+{
+    static const char text[] =
+        "[s]\n"
+        "k = 1\n"
+        "k = 2\n"
+        "other = x\n"
+        "[t]\n"
+        "y = 5\n"
+        "[s]\n"
+        "z = 6"
+        ;
+
+    const struct inifile_parse_options options { INIFILE_FLAG_BORROWED, nullptr, 0, nullptr };
+
+    REQUIRE(inifile_parse_from_memory_with_options(&ini, "test", text,
+                                                   sizeof(text) - 1,
+                                                   &options) == 0);
+
+    auto *s = inifile_find_section(&ini, "s", 0);
+    REQUIRE(s != nullptr);
+    CHECK(inifile_section_store_value(s, "k", 0, "3", 0) != nullptr);
+    CHECK(inifile_section_store_value(s, "new", 0, "y", 0) != nullptr);
+
+    CHECK(inifile_remove_section_by_name(&ini, "t", 0));
+    auto *t = inifile_new_section(&ini, "t", 0);
+    REQUIRE(t != nullptr);
+    CHECK(inifile_section_store_value(t, "y", 0, "7", 0) != nullptr);
+
+    expect_atomic_write(mock_os, buffer_writer());
+    REQUIRE(inifile_write_changes_to_file(&ini, "/etc/test.ini") == 0);
+
+    os_write_buffer.push_back(0);
+    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) ==
+          "[s]\n"
+          "k = 3\n"
+          "other = x\n"
+          "new = y\n"
+          "[s]\n"
+          "z = 6\n"
+          "[t]\n"
+          "y = 7\n");
+}
+
+/*!\test
+ * Files are only written if their contents would change.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Write file only if changed")
+{
+    inifile_forget_written_files();
+
+    struct inifile_write_statistics before;
+    inifile_get_write_statistics(&before);
+
+    auto *section = inifile_new_section(&ini, "section", 0);
+    REQUIRE(section != nullptr);
+    CHECK(inifile_section_store_value(section, "key", 0, "value", 0) != nullptr);
+
+    static const char expected_first[] = "[section]\nkey = value\n";
+    static const char expected_second[] = "[section]\nkey = other\n";
+
+    struct stat info {};
+    info.st_ino = 10;
+    info.st_size = sizeof(expected_first) - 1;
+    info.st_mtim.tv_sec = 1000;
+
+    /* file does not exist yet */
+    expect<MockOS::Stat>(mock_os, -1, ENOENT, "/etc/test.ini", &info);
+    expect_atomic_write(mock_os, buffer_writer());
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/test.ini", &info);
+    CHECK(inifile_write_to_file_if_changed(&ini, "/etc/test.ini") == 0);
+
+    /* same contents, compared by hash */
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/test.ini", &info);
+    CHECK(inifile_write_to_file_if_changed(&ini, "/etc/test.ini") == 1);
+
+    /* value changed */
+    CHECK(inifile_section_store_value(section, "key", 0, "other", 0) != nullptr);
+    struct stat new_info = info;
+    new_info.st_mtim.tv_sec = 1001;
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/test.ini", &info);
+    expect_atomic_write(mock_os, buffer_writer());
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/test.ini", &new_info);
+    CHECK(inifile_write_to_file_if_changed(&ini, "/etc/test.ini") == 0);
+
+    os_write_buffer.push_back(0);
+    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) ==
+          std::string(expected_first) + expected_second);
+
+    /* file touched by somebody else, contents are read and compared */
+    struct stat touched_info = new_info;
+    touched_info.st_mtim.tv_sec = 2000;
+    const struct os_mapped_file_data mapped
+    {
+        40, const_cast<char *>(expected_second), sizeof(expected_second) - 1
+    };
+
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/test.ini", &touched_info);
+    expect<MockOS::MapFileToMemory>(mock_os, 0, 0, &mapped, "/etc/test.ini");
+    expect<MockOS::UnmapFile>(mock_os, 0, nullptr);
+    CHECK(inifile_write_to_file_if_changed(&ini, "/etc/test.ini") == 1);
+
+    /* now it is known again */
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/test.ini", &touched_info);
+    CHECK(inifile_write_to_file_if_changed(&ini, "/etc/test.ini") == 1);
+
+    struct inifile_write_statistics after;
+    inifile_get_write_statistics(&after);
+    CHECK(after.performed - before.performed == 2);
+    CHECK(after.skipped - before.skipped == 3);
+
+    inifile_forget_written_files();
+}
+
+/*!\test
+ * Removing a key from an empty section returns an error.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove key from empty section")
+{
+    auto *section = inifile_new_section(&ini, "section", 0);
+    REQUIRE(section != nullptr);
+    CHECK_FALSE(inifile_section_remove_value(section, "key", 0));
+}
+
+/*!\test
+ * Removing the only key results in an empty section.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove only key from section")
+{
+    auto *section = inifile_new_section(&ini, "section", 0);
+    REQUIRE(section != nullptr);
+
+    CHECK(inifile_section_store_value(section, "key", 0, "value", 0) != nullptr);
+
+    CHECK(inifile_section_remove_value(section, "key", 0));
+    CHECK(section->values_head == nullptr);
+    CHECK(section->values_tail == nullptr);
+}
+
+/*!\test
+ * Removing the first key from a section works as expected.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove existing first key from section")
+{
+    auto *section = inifile_new_section(&ini, "section", 0);
+    REQUIRE(section != nullptr);
+
+    CHECK(inifile_section_store_value(section, "key 1", 0, "value 1", 0) != nullptr);
+    CHECK(inifile_section_store_value(section, "key 2", 0, "value 2", 0) != nullptr);
+    CHECK(inifile_section_store_value(section, "key 3", 0, "value 3", 0) != nullptr);
 
-        MockMessages::singleton = nullptr;
-        MockOS::singleton = nullptr;
-    }
+    auto *head = section->values_head;
+    auto *tail = section->values_tail;
 
-    MockOS::WriteFromBuffer::Callback buffer_writer()
-    {
-        return
-            [this] (const void *src, size_t count, int fd)
-            {
-                return write_from_buffer_callback(src, count, fd);
-            };
-    }
+    CHECK(inifile_section_remove_value(section, "key 1", 0));
 
-  private:
-    int write_from_buffer_callback(const void *src, size_t count, int fd)
-    {
-        CHECK(fd == int(expected_os_write_fd));
-        CHECK(count > 0);
-        REQUIRE(src != nullptr);
-        std::copy_n(static_cast<const uint8_t *>(src), count,
-                    std::back_inserter(os_write_buffer));
-        return 0;
-    }
-};
+    CHECK(inifile_section_lookup_kv_pair(section, "key 1", 0) == nullptr);
+    CHECK(inifile_section_lookup_kv_pair(section, "key 2", 0) != nullptr);
+    CHECK(inifile_section_lookup_kv_pair(section, "key 3", 0) != nullptr);
+
+    CHECK(section->values_head != head);
+    CHECK(section->values_tail == tail);
+}
 
 /*!\test
- * Initialize INI file structure in memory.
+ * Removing a key from the middle of a section works as expected.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Create empty file structure")
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove existing middle key from section")
 {
-    std::fill(reinterpret_cast<uint8_t *>(&ini),
-              reinterpret_cast<uint8_t *>(&ini) + sizeof(ini), 0xff);
+    auto *section = inifile_new_section(&ini, "section", 0);
+    REQUIRE(section != nullptr);
 
-    inifile_new(&ini);
-    CHECK(ini.sections_head == nullptr);
-    CHECK(ini.sections_tail == nullptr);
+    CHECK(inifile_section_store_value(section, "key 1", 0, "value 1", 0) != nullptr);
+    CHECK(inifile_section_store_value(section, "key 2", 0, "value 2", 0) != nullptr);
+    CHECK(inifile_section_store_value(section, "key 3", 0, "value 3", 0) != nullptr);
+
+    auto *head = section->values_head;
+    auto *tail = section->values_tail;
+
+    CHECK(inifile_section_remove_value(section, "key 2", 0));
+
+    CHECK(inifile_section_lookup_kv_pair(section, "key 1", 0) != nullptr);
+    CHECK(inifile_section_lookup_kv_pair(section, "key 2", 0) == nullptr);
+    CHECK(inifile_section_lookup_kv_pair(section, "key 3", 0) != nullptr);
+
+    CHECK(section->values_head == head);
+    CHECK(section->values_tail == tail);
 }
 
 /*!\test
- * Construct an INI file containing two sections with a few assignments and a
- * third, empty section.
+ * Removing the last key from a section works as expected.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "New_write_ini_file")
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove existing tail key from section")
 {
-    auto *section = inifile_new_section(&ini, "First", 0);
+    auto *section = inifile_new_section(&ini, "section", 0);
     REQUIRE(section != nullptr);
 
     CHECK(inifile_section_store_value(section, "key 1", 0, "value 1", 0) != nullptr);
     CHECK(inifile_section_store_value(section, "key 2", 0, "value 2", 0) != nullptr);
     CHECK(inifile_section_store_value(section, "key 3", 0, "value 3", 0) != nullptr);
 
-    section = inifile_new_section(&ini, "Second", 0);
-    CHECK(section != nullptr);
-
-    section = inifile_new_section(&ini, "Third", 0);
-    CHECK(section != nullptr);
+    auto *head = section->values_head;
+    auto *tail = section->values_tail;
 
-    CHECK(inifile_section_store_value(section, "foo", 0, "bar", 0) != nullptr);
-    CHECK(inifile_section_store_value(section, "foobar", 0, "barfoo", 0) != nullptr);
+    CHECK(inifile_section_remove_value(section, "key 3", 0));
 
-    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config");
-    for(int i = 0; i < 3 * 3 + (3 + 0 + 2) * 4; ++i)
-        expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
-    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+    CHECK(inifile_section_lookup_kv_pair(section, "key 1", 0) != nullptr);
+    CHECK(inifile_section_lookup_kv_pair(section, "key 2", 0) != nullptr);
+    CHECK(inifile_section_lookup_kv_pair(section, "key 3", 0) == nullptr);
 
-    REQUIRE(inifile_write_to_file(&ini, "outfile.config") == 0);
+    CHECK(section->values_head == head);
+    CHECK(section->values_tail != tail);
+}
 
-    static const char expected_ini_file[] =
-        "[First]\n"
-        "key 1 = value 1\n"
-        "key 2 = value 2\n"
-        "key 3 = value 3\n"
-        "[Second]\n"
-        "[Third]\n"
-        "foo = bar\n"
-        "foobar = barfoo\n"
-        ;
+/*!\test
+ * Removing a non-existent key from a section returns an error.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove nonexistant key from section")
+{
+    auto *section = inifile_new_section(&ini, "section", 0);
+    REQUIRE(section != nullptr);
 
-    os_write_buffer.push_back(0);
-    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) == expected_ini_file);
+    CHECK(inifile_section_store_value(section, "key", 0, "value", 0) != nullptr);
+    CHECK_FALSE(inifile_section_remove_value(section, "k", 0));
+    CHECK(inifile_section_lookup_kv_pair(section, "key", 0) != nullptr);
 }
 
 /*!\test
- * Regular adding and removing of sections.
+ * Sections and key/value pairs known by pointer can be removed from anywhere
+ * in their lists, keeping both directions of the lists intact.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Add and remove sections")
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove known sections and keys by pointer")
 {
-    CHECK(inifile_new_section(&ini, "Foo", 0) != nullptr);
-    CHECK(ini.sections_head != nullptr);
-    CHECK(ini.sections_head == ini.sections_tail);
-    CHECK(inifile_remove_section_by_name(&ini, "Foo", 3));
+    auto *first = inifile_new_section(&ini, "first", 0);
+    auto *middle = inifile_new_section(&ini, "middle", 0);
+    auto *last = inifile_new_section(&ini, "last", 0);
+    REQUIRE(first != nullptr);
+    REQUIRE(middle != nullptr);
+    REQUIRE(last != nullptr);
+
+    auto *kv1 = inifile_section_store_value(first, "key 1", 0, "value 1", 0);
+    auto *kv2 = inifile_section_store_value(first, "key 2", 0, "value 2", 0);
+    auto *kv3 = inifile_section_store_value(first, "key 3", 0, "value 3", 0);
+    REQUIRE(kv1 != nullptr);
+    REQUIRE(kv2 != nullptr);
+    REQUIRE(kv3 != nullptr);
+
+    inifile_section_remove_kv_pair(first, kv2);
+    CHECK(first->values_head == kv1);
+    CHECK(first->values_tail == kv3);
+    CHECK(kv1->next == kv3);
+    CHECK(kv3->prev == kv1);
+    CHECK(inifile_section_lookup_kv_pair(first, "key 2", 0) == nullptr);
+
+    inifile_section_remove_kv_pair(first, kv3);
+    CHECK(first->values_head == kv1);
+    CHECK(first->values_tail == kv1);
+    CHECK(kv1->next == nullptr);
+
+    inifile_remove_section_unchecked(&ini, middle);
+    CHECK(ini.sections_head == first);
+    CHECK(ini.sections_tail == last);
+    CHECK(first->next == last);
+    CHECK(last->prev == first);
+    CHECK(inifile_find_section(&ini, "middle", 0) == nullptr);
+
+    inifile_remove_section_unchecked(&ini, first);
+    CHECK(ini.sections_head == last);
+    CHECK(last->prev == nullptr);
+
+    inifile_remove_section_unchecked(&ini, last);
     CHECK(ini.sections_head == nullptr);
     CHECK(ini.sections_tail == nullptr);
+}
 
-    CHECK(inifile_new_section(&ini, "Bar", 3) != nullptr);
-    CHECK(ini.sections_head != nullptr);
-    CHECK(ini.sections_head == ini.sections_tail);
-    CHECK(inifile_new_section(&ini, "Foobar", 6) != nullptr);
-    CHECK(ini.sections_head != nullptr);
-    CHECK(ini.sections_head != ini.sections_tail);
-    CHECK(inifile_new_section(&ini, "Baz", 3) != nullptr);
-    CHECK(inifile_new_section(&ini, "Qux", 3) != nullptr);
+/*!\test
+ * Sections and key/value pairs can be removed in bulk by predicate, with and
+ * without index.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove sections and keys matching predicate")
+{
+    for(const unsigned int flags : {0U, unsigned(INIFILE_FLAG_INDEX)})
+    {
+        struct ini_file inifile;
+        inifile_new_with_flags(&inifile, flags);
 
-    CHECK(inifile_remove_section_by_name(&ini, "Bar", 3));
-    CHECK(inifile_remove_section(&ini, inifile_find_section(&ini, "Baz", 0)));
-    const struct ini_section *section = inifile_find_section(&ini, "Qux", 0);
-    CHECK(inifile_remove_section_by_name(&ini, section->name, section->name_length));
-    CHECK(inifile_remove_section_by_name(&ini, "Foobar", 0));
+        for(unsigned int i = 0; i < 10; ++i)
+        {
+            auto *section =
+                inifile_new_section(&inifile, ("device " + std::to_string(i)).c_str(), 0);
+            REQUIRE(section != nullptr);
+
+            for(unsigned int j = 0; j < 5; ++j)
+                REQUIRE(inifile_section_store_value(section,
+                                                    ("key " + std::to_string(j)).c_str(), 0,
+                                                    std::to_string(i * j).c_str(), 0) != nullptr);
+        }
 
-    CHECK(ini.sections_head == nullptr);
-    CHECK(ini.sections_tail == nullptr);
+        /* remove all odd devices, including the last one */
+        CHECK(inifile_remove_sections_if(&inifile,
+                [] (const struct ini_section *s, void *) -> bool
+                {
+                    return (s->name[s->name_length - 1] - '0') % 2 != 0;
+                },
+                nullptr) == 5);
+
+        CHECK(inifile_find_section(&inifile, "device 1", 0) == nullptr);
+        CHECK(inifile_find_section(&inifile, "device 9", 0) == nullptr);
+        REQUIRE(inifile_find_section(&inifile, "device 8", 0) != nullptr);
+        CHECK(inifile.sections_tail == inifile_find_section(&inifile, "device 8", 0));
+
+        /* remove keys "key 0" and "key 4", i.e., head and tail */
+        auto *section = inifile_find_section(&inifile, "device 2", 0);
+        REQUIRE(section != nullptr);
+
+        unsigned int calls = 0;
+        CHECK(inifile_section_remove_values_if(section,
+                [] (const struct ini_key_value_pair *kv, void *user_data) -> bool
+                {
+                    ++*static_cast<unsigned int *>(user_data);
+                    return kv->key[4] == '0' || kv->key[4] == '4';
+                },
+                &calls) == 2);
+        CHECK(calls == 5);
+
+        CHECK(inifile_section_lookup_kv_pair(section, "key 0", 0) == nullptr);
+        CHECK(inifile_section_lookup_kv_pair(section, "key 4", 0) == nullptr);
+        CHECK(section->values_head == inifile_section_lookup_kv_pair(section, "key 1", 0));
+        CHECK(section->values_tail == inifile_section_lookup_kv_pair(section, "key 3", 0));
+        CHECK(section->values_head->prev == nullptr);
+
+        unsigned int sections = 0;
+        for(const auto *s = inifile.sections_tail; s != nullptr; s = s->prev)
+            ++sections;
+        CHECK(sections == 5);
+
+        inifile_free(&inifile);
+    }
+}
+
+TEST_SUITE_END();
+
+TEST_SUITE_BEGIN("INI file snapshots");
+
+static const char snapshot_text[] =
+    "[global]\n"
+    "name = Test\n"
+    "empty =\n"
+    "[network]\n"
+    "address = 192.168.1.2\n"
+    "name = eth0\n"
+    "address = 10.0.0.1\n"
+    ;
+
+static struct stat make_snapshot_source_info(time_t mtime)
+{
+    struct stat info {};
+    info.st_size = sizeof(snapshot_text) - 1;
+    info.st_mtim.tv_sec = mtime;
+    info.st_mtim.tv_nsec = 500;
+    return info;
+}
+
+static void expect_text_file_parsed(std::unique_ptr<MockOS::Mock> &mock_os,
+                                    const struct os_mapped_file_data &text)
+{
+    expect<MockOS::MapFileToMemory>(mock_os, 0, 0, &text, "/etc/test.ini");
+    expect<MockOS::UnmapFile>(mock_os, 0, nullptr);
 }
 
 /*!\test
- * Trying to remove nonexistent sections by name is not fatal.
+ * A compiled snapshot is mapped and looked up without parsing the text file.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Removing nonexistent section by name returns failure")
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Compile snapshot and look up values in mapped image")
 {
-    /* OK for empty files */
-    CHECK_FALSE(inifile_remove_section_by_name(&ini, "Foo", 0));
+    const auto info(make_snapshot_source_info(1000));
+    const struct os_mapped_file_data text
+    {
+        20, const_cast<char *>(snapshot_text), sizeof(snapshot_text) - 1
+    };
 
-    CHECK(inifile_new_section(&ini, "Empty", 0) != nullptr);
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/test.ini", &info);
+    expect_text_file_parsed(mock_os, text);
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "/var/cache/test.snap.tmp");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+    expect<MockOS::FileRename>(mock_os, true, 0, "/var/cache/test.snap.tmp", "/var/cache/test.snap");
 
-    /* OK for files with content */
-    CHECK_FALSE(inifile_remove_section_by_name(&ini, "Foo", 0));
+    REQUIRE(inifile_snapshot_compile("/etc/test.ini", "/var/cache/test.snap") == 0);
+    REQUIRE(os_write_buffer.size() > sizeof(snapshot_text));
+
+    const struct os_mapped_file_data image
+    {
+        21, os_write_buffer.data(), os_write_buffer.size()
+    };
+
+    struct inifile_snapshot snapshot;
+
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/test.ini", &info);
+    expect<MockOS::MapFileToMemory>(mock_os, 0, 0, &image, "/var/cache/test.snap");
+
+    REQUIRE(inifile_snapshot_open(&snapshot, "/etc/test.ini", "/var/cache/test.snap") == 0);
+
+    const auto *global = inifile_snapshot_find_section(&snapshot, "global", 0);
+    const auto *network = inifile_snapshot_find_section(&snapshot, "network", 0);
+    REQUIRE(global != nullptr);
+    REQUIRE(network != nullptr);
+    CHECK(global != network);
+    CHECK(inifile_snapshot_find_section(&snapshot, "globa", 0) == nullptr);
+    CHECK(inifile_snapshot_find_section(&snapshot, "network", 3) == nullptr);
+
+    size_t length = 0;
+    CHECK(inifile_snapshot_lookup_value(&snapshot, global, "name", 0, &length) == "Test");
+    CHECK(length == 4);
+    CHECK(inifile_snapshot_lookup_value(&snapshot, global, "empty", 0, &length) == "");
+    CHECK(length == 0);
+    CHECK(inifile_snapshot_lookup_value(&snapshot, network, "name", 0, nullptr) == "eth0");
+    CHECK(inifile_snapshot_lookup_value(&snapshot, network, "address", 0, nullptr) == "10.0.0.1");
+    CHECK(inifile_snapshot_lookup_value(&snapshot, network, "empty", 0, nullptr) == nullptr);
+
+    expect<MockOS::UnmapFile>(mock_os, 0, &snapshot.mapped);
+    inifile_snapshot_close(&snapshot);
 }
 
 /*!\test
- * Trying to remove nonexistent sections by wrong pointer is not fatal.
+ * If the text file has changed since the snapshot was compiled, the text
+ * file is parsed and the snapshot is written again.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Removing nonexistent section by section pointer returns failure")
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Outdated snapshot is regenerated from text file")
 {
-    auto *does_not_exist = reinterpret_cast<struct ini_section *>(0x0123);
+    const auto old_info(make_snapshot_source_info(1000));
+    const auto new_info(make_snapshot_source_info(2000));
+    const struct os_mapped_file_data text
+    {
+        20, const_cast<char *>(snapshot_text), sizeof(snapshot_text) - 1
+    };
 
-    /* OK for empty files */
-    CHECK_FALSE(inifile_remove_section(&ini, does_not_exist));
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/test.ini", &old_info);
+    expect_text_file_parsed(mock_os, text);
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "test.snap.tmp");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+    expect<MockOS::FileRename>(mock_os, true, 0, "test.snap.tmp", "test.snap");
 
-    struct ini_section *section = inifile_new_section(&ini, "Empty", 0);
-    CHECK(section != nullptr);
+    REQUIRE(inifile_snapshot_compile("/etc/test.ini", "test.snap") == 0);
 
-    /* OK for files with content */
-    CHECK_FALSE(inifile_remove_section(&ini, does_not_exist));
+    std::vector<uint8_t> old_image_data;
+    std::swap(old_image_data, os_write_buffer);
+
+    const struct os_mapped_file_data old_image
+    {
+        21, old_image_data.data(), old_image_data.size()
+    };
+
+    struct inifile_snapshot snapshot;
+
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/test.ini", &new_info);
+    expect<MockOS::MapFileToMemory>(mock_os, 0, 0, &old_image, "test.snap");
+    expect<MockOS::UnmapFile>(mock_os, 0, &snapshot.mapped);
+    expect_text_file_parsed(mock_os, text);
+    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "test.snap.tmp");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+    expect<MockOS::FileRename>(mock_os, true, 0, "test.snap.tmp", "test.snap");
+
+    REQUIRE(inifile_snapshot_open(&snapshot, "/etc/test.ini", "test.snap") == 0);
+
+    /* same contents, only the recorded modification time differs */
+    REQUIRE(os_write_buffer.size() == old_image_data.size());
+    CHECK(os_write_buffer != old_image_data);
+
+    const auto *network = inifile_snapshot_find_section(&snapshot, "network", 0);
+    REQUIRE(network != nullptr);
+    CHECK(inifile_snapshot_lookup_value(&snapshot, network, "address", 0, nullptr) == "10.0.0.1");
+
+    inifile_snapshot_close(&snapshot);
 }
 
 /*!\test
- * Trying to remove \c nullptr section is not fatal.
+ * Missing snapshots are generated, and the image is used from memory if it
+ * cannot be written.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Removing null section returns failure")
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Snapshot is used from memory if it cannot be written")
 {
-    /* OK for empty files */
-    CHECK_FALSE(inifile_remove_section(&ini, nullptr));
+    const auto info(make_snapshot_source_info(1000));
+    const struct os_mapped_file_data text
+    {
+        20, const_cast<char *>(snapshot_text), sizeof(snapshot_text) - 1
+    };
 
-    CHECK(inifile_new_section(&ini, "Empty", 0) != nullptr);
+    struct inifile_snapshot snapshot;
 
-    /* OK for files with content */
-    CHECK_FALSE(inifile_remove_section(&ini, nullptr));
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/test.ini", &info);
+    expect<MockOS::MapFileToMemory>(mock_os, -1, ENOENT, false, "/ro/test.snap");
+    expect_text_file_parsed(mock_os, text);
+    expect<MockOS::FileNew>(mock_os, -1, EROFS, "/ro/test.snap.tmp");
+
+    REQUIRE(inifile_snapshot_open(&snapshot, "/etc/test.ini", "/ro/test.snap") == 0);
+
+    const auto *global = inifile_snapshot_find_section(&snapshot, "global", 0);
+    REQUIRE(global != nullptr);
+    CHECK(inifile_snapshot_lookup_value(&snapshot, global, "name", 0, nullptr) == "Test");
+
+    inifile_snapshot_close(&snapshot);
+}
+
+TEST_SUITE_END();
+
+TEST_SUITE_BEGIN("INI file cache");
+
+static const char cached_text[] =
+    "[section]\n"
+    "key = value\n"
+    ;
+
+static struct stat make_cached_file_info(ino_t inode, time_t mtime)
+{
+    struct stat info {};
+    info.st_dev = 5;
+    info.st_ino = inode;
+    info.st_size = sizeof(cached_text) - 1;
+    info.st_mtim.tv_sec = mtime;
+    return info;
+}
+
+static void expect_cache_miss(std::unique_ptr<MockOS::Mock> &mock_os,
+                              const char *filename, const struct stat &info)
+{
+    static const struct os_mapped_file_data text
+    {
+        30, const_cast<char *>(cached_text), sizeof(cached_text) - 1
+    };
+
+    expect<MockOS::Stat>(mock_os, 0, 0, filename, &info);
+    expect<MockOS::MapFileToMemory>(mock_os, 0, 0, &text, filename);
+    expect<MockOS::UnmapFile>(mock_os, 0, nullptr);
+    expect<MockOS::Stat>(mock_os, 0, 0, filename, &info);
 }
 
 /*!\test
- * It is possible to load an INI file, remove a section, and write it back with
- * the section removed.
+ * Unchanged files are parsed only once and shared by all users.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove section from file")
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Cached INI file is shared while file is unchanged")
 {
-    static const char text[] =
-        "[First]\n"
-        "key 1-1 = value 1-1\n"
-        "key 1-2 = value 1-2\n"
-        "[Second]\n"
-        "key 2-1 = value 2-1\n"
-        "key 2-2 = value 2-2\n"
-        "key 2-3 = value 2-3\n"
-        "[Third]\n"
-        "key 3-1 = value 3-1\n"
-        "key 3-2 = value 3-2\n"
-        ;
+    const auto info(make_cached_file_info(100, 1000));
+    const auto changed_info(make_cached_file_info(100, 1001));
 
-    REQUIRE(inifile_parse_from_memory(&ini, "test", text, sizeof(text) - 1) == 0);
-    CHECK(ini.sections_head != nullptr);
+    inifile_cache_set_limit(1024 * 1024);
 
-    CHECK(inifile_remove_section_by_name(&ini, "Second", 0));
+    expect_cache_miss(mock_os, "/etc/a.ini", info);
+    int result = -5;
+    const auto *first = inifile_cache_get("/etc/a.ini", &result);
+    REQUIRE(first != nullptr);
+    CHECK(result == 0);
+    CHECK((first->flags & INIFILE_FLAG_INDEX) != 0);
 
-    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config");
-    for(int i = 0; i < 2 * 3 + (2 + 2) * 4; ++i)
-        expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
-    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/a.ini", &info);
+    const auto *second = inifile_cache_get("/etc/a.ini", &result);
+    CHECK(result == 0);
+    CHECK(second == first);
 
-    REQUIRE(inifile_write_to_file(&ini, "outfile.config") == 0);
+    const auto *section = inifile_find_section(second, "section", 0);
+    REQUIRE(section != nullptr);
+    const auto *pair = inifile_section_lookup_kv_pair(section, "key", 0);
+    REQUIRE(pair != nullptr);
+    CHECK(pair->value == "value");
 
-    static const char expected_ini_file[] =
-        "[First]\n"
-        "key 1-1 = value 1-1\n"
-        "key 1-2 = value 1-2\n"
-        "[Third]\n"
-        "key 3-1 = value 3-1\n"
-        "key 3-2 = value 3-2\n"
-        ;
+    expect_cache_miss(mock_os, "/etc/a.ini", changed_info);
+    const auto *third = inifile_cache_get("/etc/a.ini", &result);
+    REQUIRE(third != nullptr);
+    CHECK(third != first);
 
-    os_write_buffer.push_back(0);
-    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) == expected_ini_file);
+    inifile_cache_release(first);
+    inifile_cache_release(second);
+    inifile_cache_release(third);
+
+    inifile_cache_set_limit(0);
 }
 
 /*!\test
- * It is possible to assign empty values to keys.
+ * With the cache disabled, each user gets its own structure.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Write empty value to .ini file")
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "INI files are parsed each time if cache is disabled")
 {
-    auto *section = inifile_new_section(&ini, "First", 0);
-    REQUIRE(section != nullptr);
+    const auto info(make_cached_file_info(100, 1000));
 
-    CHECK(inifile_section_store_empty_value(section, "empty", 0) != nullptr);
+    expect_cache_miss(mock_os, "/etc/a.ini", info);
+    const auto *first = inifile_cache_get("/etc/a.ini", nullptr);
+    REQUIRE(first != nullptr);
 
-    section = inifile_new_section(&ini, "Second", 0);
-    REQUIRE(section != nullptr);
+    expect_cache_miss(mock_os, "/etc/a.ini", info);
+    const auto *second = inifile_cache_get("/etc/a.ini", nullptr);
+    REQUIRE(second != nullptr);
+    CHECK(second != first);
 
-    CHECK(inifile_section_store_value(section, "foo", 0, "bar", 0) != nullptr);
-    CHECK(inifile_section_store_empty_value(section, "foobar", 0) != nullptr);
+    inifile_cache_release(second);
+    inifile_cache_release(first);
+
+    const struct stat missing {};
+    int result = -5;
+    expect<MockOS::Stat>(mock_os, -1, ENOENT, "/etc/missing.ini", &missing);
+    CHECK(inifile_cache_get("/etc/missing.ini", &result) == nullptr);
+    CHECK(result == 1);
+}
+
+/*!\test
+ * Least recently used structures are evicted when the memory limit is
+ * exceeded.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Cached INI files are evicted when memory limit is exceeded")
+{
+    const auto info_a(make_cached_file_info(100, 1000));
+    const auto info_b(make_cached_file_info(200, 1000));
+    const auto info_c(make_cached_file_info(300, 1000));
+
+    inifile_cache_set_limit(1024 * 1024);
+
+    expect_cache_miss(mock_os, "/etc/a.ini", info_a);
+    const auto *a = inifile_cache_get("/etc/a.ini", nullptr);
+    REQUIRE(a != nullptr);
+
+    /* room for two structures */
+    const size_t size = inifile_get_memory_usage(a);
+    CHECK(size > sizeof(cached_text));
+    inifile_cache_set_limit(2 * size + size / 2);
+
+    expect_cache_miss(mock_os, "/etc/b.ini", info_b);
+    const auto *b = inifile_cache_get("/etc/b.ini", nullptr);
+    REQUIRE(b != nullptr);
+    inifile_cache_release(b);
+
+    /* use a so that b becomes least recently used */
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/a.ini", &info_a);
+    CHECK(inifile_cache_get("/etc/a.ini", nullptr) == a);
+    inifile_cache_release(a);
+
+    expect_cache_miss(mock_os, "/etc/c.ini", info_c);
+    const auto *c = inifile_cache_get("/etc/c.ini", nullptr);
+    REQUIRE(c != nullptr);
+    inifile_cache_release(c);
+
+    expect<MockOS::Stat>(mock_os, 0, 0, "/etc/a.ini", &info_a);
+    CHECK(inifile_cache_get("/etc/a.ini", nullptr) == a);
+    inifile_cache_release(a);
+
+    expect_cache_miss(mock_os, "/etc/b.ini", info_b);
+    b = inifile_cache_get("/etc/b.ini", nullptr);
+    REQUIRE(b != nullptr);
+    inifile_cache_release(b);
+
+    /* a is still in use and must survive being dropped from the cache */
+    inifile_cache_set_limit(0);
+    const auto *section = inifile_find_section(a, "section", 0);
+    CHECK(section != nullptr);
+    inifile_cache_release(a);
+}
+
+TEST_SUITE_END();
 
-    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config");
-    for(int i = 0; i < 2 * 3 + 3 + 4 + 3; ++i)
-        expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
-    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+/*!@}*/
 
-    REQUIRE(inifile_write_to_file(&ini, "outfile.config") == 0);
+TEST_SUITE_BEGIN("INI file journal");
 
-    static const char expected_ini_file[] =
-        "[First]\n"
-        "empty = \n"
-        "[Second]\n"
-        "foo = bar\n"
-        "foobar = \n"
-        ;
+static void expect_journal_created(std::unique_ptr<MockOS::Mock> &mock_os,
+                                   const MockOS::WriteFromBuffer::Callback &writer)
+{
+    expect<MockOS::FileNew>(mock_os, 123, 0, "/etc/test.ini.journal");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, writer);
+}
 
-    os_write_buffer.push_back(0);
-    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) == expected_ini_file);
+static void expect_journal_opened_without_files(std::unique_ptr<MockOS::Mock> &mock_os,
+                                                const MockOS::WriteFromBuffer::Callback &writer)
+{
+    expect<MockOS::MapFileToMemory>(mock_os, -1, ENOENT, false, "/etc/test.ini");
+    expect<MockOS::MapFileToMemory>(mock_os, -1, ENOENT, false, "/etc/test.ini.journal");
+    expect_journal_created(mock_os, writer);
 }
 
 /*!\test
- * Parse an INI file, change a few values, write a new INI file containing the
- * changes.
+ * Changed values are appended to the journal, and the journal is synced
+ * after the configured number of records.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Manipulate value in file")
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Journal appends changes and syncs in batches")
 {
-    static const char text[] =
-        "[First]\n"
-        "key 1-1 = value 1-1\n"
-        "key 1-2 = value 1-2\n"
-        "[Second]\n"
-        "key 2-1 = value 2-1\n"
-        "key 2-2 = value 2-2\n"
-        "key 2-3 = value 2-3\n"
-        "[Third]\n"
-        "key 3-1 = value 3-1\n"
-        "key 3-2 = value 3-2\n"
-        ;
-
-    REQUIRE(inifile_parse_from_memory(&ini, "test", text, sizeof(text) - 1) == 0);
-    CHECK(ini.sections_head != nullptr);
+    struct inifile_journal journal;
 
-    auto *section = inifile_find_section(&ini, "Second", 0);
-    REQUIRE(section != nullptr);
+    expect_journal_opened_without_files(mock_os, buffer_writer());
+    REQUIRE(inifile_journal_open(&journal, "/etc/test.ini", 2, 0) == 0);
+    CHECK(os_write_buffer.size() == 8);
 
-    CHECK(inifile_section_store_value(section, "key 2-1", 0, "changed value", 0) != nullptr);
-    CHECK(inifile_section_store_value(section, "key 11-13", 0, "new value", 0) != nullptr);
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    CHECK(inifile_journal_store_value(&journal, "audio", 0, "volume", 0, "42", 0) == 0);
+    CHECK(os_write_buffer.size() == 8 + 16 + 5 + 6 + 2);
 
-    section = inifile_find_section(&ini, "Third", 0);
-    REQUIRE(section != nullptr);
+    /* same value again, nothing is written */
+    CHECK(inifile_journal_store_value(&journal, "audio", 0, "volume", 0, "42", 0) == 0);
 
-    CHECK(inifile_section_store_value(section, "key 3-2", 0, "also changed", 0) != nullptr);
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileSync>(mock_os, 0, 0, 123);
+    CHECK(inifile_journal_store_value(&journal, "audio", 0, "volume", 0, "43", 0) == 0);
+    CHECK(os_write_buffer.size() == 8 + 2 * (16 + 5 + 6 + 2));
 
-    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config");
-    for(int i = 0; i < 3 * 3 + (2 + 4 + 2) * 4; ++i)
-        expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
-    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
+    const auto *section = inifile_find_section(&journal.inifile, "audio", 0);
+    REQUIRE(section != nullptr);
+    const auto *kv = inifile_section_lookup_kv_pair(section, "volume", 0);
+    REQUIRE(kv != nullptr);
+    CHECK(kv->value == "43");
 
-    REQUIRE(inifile_write_to_file(&ini, "outfile.config") == 0);
+    expect<MockOS::FileClose>(mock_os, 0, 123);
+    inifile_journal_close(&journal);
+}
 
-    static const char expected_ini_file[] =
-        "[First]\n"
-        "key 1-1 = value 1-1\n"
-        "key 1-2 = value 1-2\n"
-        "[Second]\n"
-        "key 2-1 = changed value\n"
-        "key 2-2 = value 2-2\n"
-        "key 2-3 = value 2-3\n"
-        "key 11-13 = new value\n"
-        "[Third]\n"
-        "key 3-1 = value 3-1\n"
-        "key 3-2 = also changed\n"
+/*!\test
+ * On open, the journal is replayed over the INI file up to the first damaged
+ * record, then written to the INI file, and a new journal is started.
+ */
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Journal is replayed over INI file and compacted on open")
+{
+    struct inifile_journal journal;
+
+    expect_journal_opened_without_files(mock_os, buffer_writer());
+    REQUIRE(inifile_journal_open(&journal, "/etc/test.ini", 0, 0) == 0);
+
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    CHECK(inifile_journal_store_value(&journal, "audio", 0, "volume", 0, "42", 0) == 0);
+    CHECK(inifile_journal_store_value(&journal, "player", 0, "position", 0, "", 0) == 0);
+    CHECK(inifile_journal_store_value(&journal, "audio", 0, "volume", 0, "50", 0) == 0);
+
+    expect<MockOS::FileClose>(mock_os, 0, 123);
+    inifile_journal_close(&journal);
+
+    /* last record torn by power failure */
+    std::vector<uint8_t> journal_data(os_write_buffer);
+    journal_data.resize(journal_data.size() - 1);
+    os_write_buffer.clear();
+
+    static const char base_text[] =
+        "[audio]\n"
+        "volume = 10\n"
+        "balance = 0\n"
         ;
+    const struct os_mapped_file_data base
+    {
+        20, const_cast<char *>(base_text), sizeof(base_text) - 1
+    };
+    const struct os_mapped_file_data journal_file
+    {
+        21, journal_data.data(), journal_data.size()
+    };
+
+    expect<MockOS::MapFileToMemory>(mock_os, 0, 0, &base, "/etc/test.ini");
+    expect<MockOS::UnmapFile>(mock_os, 0, nullptr);
+    expect<MockOS::MapFileToMemory>(mock_os, 0, 0, &journal_file, "/etc/test.ini.journal");
+    expect<MockMessages::MsgError>(mock_messages, 0, LOG_WARNING,
+        "Ignoring 28 bytes of damaged records in journal \"/etc/test.ini.journal\"",
+        false);
+    expect<MockOS::UnmapFile>(mock_os, 0, nullptr);
+    expect_atomic_write(mock_os, buffer_writer());
+    expect_journal_created(mock_os, buffer_writer());
+    REQUIRE(inifile_journal_open(&journal, "/etc/test.ini", 0, 0) == 0);
 
     os_write_buffer.push_back(0);
-    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) == expected_ini_file);
+    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) ==
+          "[audio]\n"
+          "volume = 42\n"
+          "balance = 0\n"
+          "[player]\n"
+          "position = \n"
+          "INIJRNL\x01");
+
+    expect<MockOS::FileClose>(mock_os, 0, 123);
+    inifile_journal_close(&journal);
 }
 
 /*!\test
- * In case #os_file_new() fails for whatever reason, function
- * #inifile_write_to_file() returns an error.
+ * The journal is compacted as soon as it exceeds the size threshold.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Write file fails if file cannot be created")
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Journal is compacted when size threshold is reached")
 {
-    CHECK(inifile_new_section(&ini, "section", 0) != nullptr);
-    expect<MockOS::FileNew>(mock_os, -1, ENOSPC, "outfile.config");
-    CHECK(inifile_write_to_file(&ini, "outfile.config") == -1);
-    CHECK(os_write_buffer.empty());
+    struct inifile_journal journal;
+
+    expect_journal_opened_without_files(mock_os, buffer_writer());
+    REQUIRE(inifile_journal_open(&journal, "/etc/test.ini", 0, 60) == 0);
+
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    CHECK(inifile_journal_store_value(&journal, "audio", 0, "volume", 0, "42", 0) == 0);
+
+    os_write_buffer.clear();
+
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect_atomic_write(mock_os, buffer_writer());
+    expect<MockOS::FileClose>(mock_os, 0, 123);
+    expect_journal_created(mock_os, buffer_writer());
+    CHECK(inifile_journal_store_value(&journal, "audio", 0, "volume", 0, "43", 0) == 0);
+
+    os_write_buffer.erase(os_write_buffer.begin(), os_write_buffer.begin() + 16 + 5 + 6 + 2);
+    os_write_buffer.push_back(0);
+    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) ==
+          "[audio]\n"
+          "volume = 43\n"
+          "INIJRNL\x01");
+
+    /* nothing to do for empty journal */
+    CHECK(inifile_journal_compact(&journal) == 0);
+
+    expect<MockOS::FileClose>(mock_os, 0, 123);
+    inifile_journal_close(&journal);
 }
 
 /*!\test
- * In case #os_write_from_buffer() fails for whatever reason, function
- * #inifile_write_to_file() deletes the output file and returns an error.
+ * The journal is kept if the INI file cannot be synced to storage during
+ * compaction.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Write file fails if file cannot be written")
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Journal is not truncated if INI file cannot be synced")
 {
-    CHECK(inifile_new_section(&ini, "section", 0) != nullptr);
+    struct inifile_journal journal;
 
-    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config");
-    expect<MockOS::WriteFromBuffer>(mock_os, -1, ENOSPC, false, 1, expected_os_write_fd);
-    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
-    expect<MockOS::FileDelete>(mock_os, 0, 0, "outfile.config");
+    expect_journal_opened_without_files(mock_os, buffer_writer());
+    REQUIRE(inifile_journal_open(&journal, "/etc/test.ini", 0, 0) == 0);
+
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    CHECK(inifile_journal_store_value(&journal, "audio", 0, "volume", 0, "42", 0) == 0);
+
+    const size_t journal_size = journal.journal_size;
+
+    expect<MockOS::FileNew>(mock_os, 123, 0, "/etc/test.ini.tmp");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, buffer_writer());
+    expect<MockOS::FileSync>(mock_os, -1, EIO, 123);
+    expect<MockOS::FileClose>(mock_os, 0, 123);
+    expect<MockOS::FileDelete>(mock_os, 0, 0, "/etc/test.ini.tmp");
     expect<MockMessages::MsgError>(mock_messages, 0, LOG_ERR,
-        "Failed writing INI file \"outfile.config\", deleting partially written file",
+        "Failed writing INI file \"/etc/test.ini\", keeping previous file",
         false);
+    CHECK(inifile_journal_compact(&journal) == -1);
 
-    CHECK(inifile_write_to_file(&ini, "outfile.config") == -1);
+    /* journal has been neither closed nor recreated */
+    CHECK(journal.fd == 123);
+    CHECK(journal.journal_size == journal_size);
 
-    CHECK(os_write_buffer.empty());
+    expect<MockOS::FileClose>(mock_os, 0, 123);
+    inifile_journal_close(&journal);
 }
 
 /*!\test
- * In case #os_write_from_buffer() fails for whatever reason, function
- * #inifile_write_to_file() tries to delete the output file. If this fails,
- * then an additional diagnostic message is emitted.
+ * A journal which failed to take a record is closed, and the change is
+ * written to the INI file before a new journal is started, so that no
+ * records are appended after a torn one.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Message on failure to delete file after failure to write to file")
+TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Journal is rewritten after failed record write")
 {
-    CHECK(inifile_new_section(&ini, "section", 0) != nullptr);
+    struct inifile_journal journal;
+    std::vector<uint8_t> journal_data;
+    std::vector<uint8_t> ini_data;
 
-    expect<MockOS::FileNew>(mock_os, expected_os_write_fd, 0, "outfile.config");
-    expect<MockOS::WriteFromBuffer>(mock_os, -1, EIO, false, 1, expected_os_write_fd);
-    expect<MockOS::FileClose>(mock_os, 0, expected_os_write_fd);
-    expect<MockOS::FileDelete>(mock_os, -1, EIO, "outfile.config");
+    const auto append_to =
+        [] (std::vector<uint8_t> &data)
+        {
+            return
+                [&data] (const void *src, size_t count, int fd)
+                {
+                    const auto *p = static_cast<const uint8_t *>(src);
+                    std::copy(p, p + count, std::back_inserter(data));
+                    return 0;
+                };
+        };
+
+    expect_journal_opened_without_files(mock_os, append_to(journal_data));
+    REQUIRE(inifile_journal_open(&journal, "/etc/test.ini", 0, 0) == 0);
+
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, append_to(journal_data));
+    CHECK(inifile_journal_store_value(&journal, "audio", 0, "volume", 0, "42", 0) == 0);
+
+    /* half of the record makes it to the file */
+    expect<MockOS::WriteFromBuffer>(mock_os, ENOSPC,
+        [&journal_data] (const void *src, size_t count, int fd)
+        {
+            const auto *p = static_cast<const uint8_t *>(src);
+            std::copy(p, p + count / 2, std::back_inserter(journal_data));
+            return -1;
+        });
     expect<MockMessages::MsgError>(mock_messages, 0, LOG_ERR,
-        "Failed writing INI file \"outfile.config\", deleting partially written file",
-        false);
-    expect<MockMessages::MsgError>(mock_messages, EIO, LOG_ERR,
-        "Failed to delete incomplete file (Input/output error)", false);
+        "Failed writing journal \"/etc/test.ini.journal\"", false);
+    expect<MockOS::FileClose>(mock_os, 0, 123);
+    CHECK(inifile_journal_store_value(&journal, "audio", 0, "volume", 0, "50", 0) == -1);
+    CHECK(journal.fd == -1);
+
+    /* the INI file is written before the journal is started over */
+    journal_data.clear();
+    expect<MockOS::FileNew>(mock_os, 124, 0, "/etc/test.ini.tmp");
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, append_to(ini_data));
+    expect<MockOS::FileSync>(mock_os, 0, 0, 124);
+    expect<MockOS::FileCloseWithoutSync>(mock_os, 0, 124);
+    expect<MockOS::FileRename>(mock_os, true, 0, "/etc/test.ini.tmp", "/etc/test.ini");
+    expect<MockOS::SyncDir>(mock_os, 0, "/etc");
+    expect_journal_created(mock_os, append_to(journal_data));
+    expect<MockOS::WriteFromBuffer>(mock_os, 0, append_to(journal_data));
+    CHECK(inifile_journal_store_value(&journal, "player", 0, "position", 0, "7", 0) == 0);
+
+    expect<MockOS::FileClose>(mock_os, 0, 123);
+    inifile_journal_close(&journal);
+
+    ini_data.push_back(0);
+    CHECK(reinterpret_cast<const char *>(ini_data.data()) ==
+          "[audio]\n"
+          "volume = 50\n");
+
+    /* reopen, all changes are there */
+    const struct os_mapped_file_data ini_file
+    {
+        20, ini_data.data(), ini_data.size() - 1
+    };
+    const struct os_mapped_file_data journal_file
+    {
+        21, journal_data.data(), journal_data.size()
+    };
 
-    CHECK(inifile_write_to_file(&ini, "outfile.config") == -1);
+    expect<MockOS::MapFileToMemory>(mock_os, 0, 0, &ini_file, "/etc/test.ini");
+    expect<MockOS::UnmapFile>(mock_os, 0, nullptr);
+    expect<MockOS::MapFileToMemory>(mock_os, 0, 0, &journal_file, "/etc/test.ini.journal");
+    expect<MockOS::UnmapFile>(mock_os, 0, nullptr);
+    expect_atomic_write(mock_os, buffer_writer());
+    expect_journal_created(mock_os, buffer_writer());
+    REQUIRE(inifile_journal_open(&journal, "/etc/test.ini", 0, 0) == 0);
 
-    CHECK(os_write_buffer.empty());
+    os_write_buffer.push_back(0);
+    CHECK(reinterpret_cast<const char *>(os_write_buffer.data()) ==
+          "[audio]\n"
+          "volume = 50\n"
+          "[player]\n"
+          "position = 7\n"
+          "INIJRNL\x01");
+
+    expect<MockOS::FileClose>(mock_os, 0, 123);
+    inifile_journal_close(&journal);
 }
 
+TEST_SUITE_END();
+
+TEST_SUITE_BEGIN("INI file overlay");
+
 /*!\test
- * Removing a key from an empty section returns an error.
+ * Values in upper layers hide values in lower layers, sections and keys are
+ * merged in order of first appearance.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove key from empty section")
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Overlay looks up values from topmost layer")
 {
-    auto *section = inifile_new_section(&ini, "section", 0);
-    REQUIRE(section != nullptr);
-    CHECK_FALSE(inifile_section_remove_value(section, "key", 0));
+    static const char defaults_text[] =
+        "[audio]\n"
+        "volume = 20\n"
+        "balance = 0\n"
+        "[network]\n"
+        "dhcp = yes\n"
+        ;
+    static const char oem_text[] =
+        "[audio]\n"
+        "volume = 30\n"
+        "[branding]\n"
+        "name = OEM\n"
+        ;
+    static const char user_text[] =
+        "[audio]\n"
+        "loudness = on\n"
+        "volume = 42\n"
+        "[network]\n"
+        ;
+
+    struct ini_file defaults;
+    struct ini_file user;
+
+    REQUIRE(inifile_parse_from_memory(&defaults, "defaults", defaults_text, sizeof(defaults_text) - 1) == 0);
+    REQUIRE(inifile_parse_from_memory(&ini, "oem", oem_text, sizeof(oem_text) - 1) == 0);
+    REQUIRE(inifile_parse_from_memory(&user, "user", user_text, sizeof(user_text) - 1) == 0);
+
+    const struct ini_file *const layers[] = { &defaults, nullptr, &ini, &user };
+    struct inifile_overlay overlay;
+
+    REQUIRE(inifile_overlay_init(&overlay, layers, 4) == 0);
+    REQUIRE(overlay.number_of_sections == 3);
+    CHECK(std::string(overlay.sections[0].name) == "audio");
+    CHECK(std::string(overlay.sections[1].name) == "network");
+    CHECK(std::string(overlay.sections[2].name) == "branding");
+
+    const auto *audio = inifile_overlay_find_section(&overlay, "audio", 0);
+    REQUIRE(audio == &overlay.sections[0]);
+    REQUIRE(audio->number_of_values == 3);
+    CHECK(audio->values[0].kv->value == "42");
+    CHECK(audio->values[0].layer == 3);
+    CHECK(audio->values[1].kv->value == "0");
+    CHECK(audio->values[1].layer == 0);
+    CHECK(audio->values[2].kv->key == "loudness");
+    CHECK(audio->values[2].layer == 3);
+
+    const auto *value = inifile_overlay_section_lookup_value(audio, "volume", 0);
+    REQUIRE(value != nullptr);
+    CHECK(value->kv == inifile_section_lookup_kv_pair(inifile_find_section(&user, "audio", 0), "volume", 0));
+
+    CHECK(inifile_overlay_lookup_kv_pair(&overlay, "network", 0, "dhcp", 0)->value == "yes");
+    CHECK(inifile_overlay_lookup_kv_pair(&overlay, "branding", 0, "name", 0)->value == "OEM");
+    CHECK(inifile_overlay_lookup_kv_pair(&overlay, "branding", 0, "logo", 0) == nullptr);
+    CHECK(inifile_overlay_lookup_kv_pair(&overlay, "video", 0, "name", 0) == nullptr);
+
+    inifile_overlay_free(&overlay);
+    inifile_free(&defaults);
+    inifile_free(&user);
 }
 
 /*!\test
- * Removing the only key results in an empty section.
+ * An overlay of no layers is empty.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove only key from section")
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Overlay of empty layers")
 {
-    auto *section = inifile_new_section(&ini, "section", 0);
-    REQUIRE(section != nullptr);
+    const struct ini_file *const layers[] = { nullptr, &ini };
+    struct inifile_overlay overlay;
+
+    REQUIRE(inifile_overlay_init(&overlay, layers, 2) == 0);
+    CHECK(overlay.number_of_sections == 0);
+    CHECK(inifile_overlay_find_section(&overlay, "audio", 0) == nullptr);
+    CHECK(inifile_overlay_lookup_kv_pair(&overlay, "audio", 0, "volume", 0) == nullptr);
+    inifile_overlay_free(&overlay);
+}
 
-    CHECK(inifile_section_store_value(section, "key", 0, "value", 0) != nullptr);
+TEST_SUITE_END();
 
-    CHECK(inifile_section_remove_value(section, "key", 0));
-    CHECK(section->values_head == nullptr);
-    CHECK(section->values_tail == nullptr);
-}
+TEST_SUITE_BEGIN("INI file shared between threads");
 
 /*!\test
- * Removing the first key from a section works as expected.
+ * Readers keep their version while a writer publishes a modified copy.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove existing first key from section")
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Shared INI file update does not affect acquired version")
 {
-    auto *section = inifile_new_section(&ini, "section", 0);
+    static const char text[] =
+        "[audio]\n"
+        "volume = 20\n"
+        ;
+
+    const struct inifile_parse_options options { INIFILE_FLAG_BORROWED, nullptr, 0, nullptr };
+
+    REQUIRE(inifile_parse_from_memory_with_options(&ini, "test", text,
+                                                   sizeof(text) - 1,
+                                                   &options) == 0);
+
+    struct inifile_shared shared;
+    REQUIRE(inifile_shared_init(&shared, &ini) == 0);
+    inifile_new(&ini);
+
+    const struct ini_file *before = inifile_shared_acquire(&shared);
+
+    struct ini_file *update = inifile_shared_begin_update(&shared);
+    REQUIRE(update != nullptr);
+    CHECK(update->flags == INIFILE_FLAG_ARENA);
+
+    auto *section = inifile_find_section(update, "audio", 0);
     REQUIRE(section != nullptr);
+    CHECK(inifile_section_store_value(section, "volume", 0, "42", 0) != nullptr);
+    CHECK(inifile_shared_acquire(&shared) == before);
+    inifile_shared_release(before);
 
-    CHECK(inifile_section_store_value(section, "key 1", 0, "value 1", 0) != nullptr);
-    CHECK(inifile_section_store_value(section, "key 2", 0, "value 2", 0) != nullptr);
-    CHECK(inifile_section_store_value(section, "key 3", 0, "value 3", 0) != nullptr);
+    inifile_shared_commit_update(&shared, update);
 
-    auto *head = section->values_head;
-    auto *tail = section->values_tail;
+    const struct ini_file *after = inifile_shared_acquire(&shared);
+    CHECK(after == update);
 
-    CHECK(inifile_section_remove_value(section, "key 1", 0));
+    const auto *kv = inifile_section_lookup_kv_pair(inifile_find_section(before, "audio", 0), "volume", 0);
+    REQUIRE(kv != nullptr);
+    CHECK(std::string(kv->value, kv->value_length) == "20");
+    CHECK(inifile_section_lookup_kv_pair(inifile_find_section(after, "audio", 0), "volume", 0)->value == "42");
 
-    CHECK(inifile_section_lookup_kv_pair(section, "key 1", 0) == nullptr);
-    CHECK(inifile_section_lookup_kv_pair(section, "key 2", 0) != nullptr);
-    CHECK(inifile_section_lookup_kv_pair(section, "key 3", 0) != nullptr);
+    inifile_shared_release(before);
 
-    CHECK(section->values_head != head);
-    CHECK(section->values_tail == tail);
+    update = inifile_shared_begin_update(&shared);
+    REQUIRE(update != nullptr);
+    CHECK(inifile_remove_section_by_name(update, "audio", 0));
+    inifile_shared_abort_update(&shared, update);
+
+    const struct ini_file *unchanged = inifile_shared_acquire(&shared);
+    CHECK(unchanged == after);
+    inifile_shared_release(unchanged);
+
+    inifile_shared_free(&shared);
+    CHECK(inifile_find_section(after, "audio", 0) != nullptr);
+    inifile_shared_release(after);
 }
 
+TEST_SUITE_END();
+
+TEST_SUITE_BEGIN("INI file string pool");
+
 /*!\test
- * Removing a key from the middle of a section works as expected.
+ * INI files sharing a string pool share their section names and keys, no
+ * matter how the files have been created.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove existing middle key from section")
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "INI files share interned names and keys")
 {
-    auto *section = inifile_new_section(&ini, "section", 0);
-    REQUIRE(section != nullptr);
-
-    CHECK(inifile_section_store_value(section, "key 1", 0, "value 1", 0) != nullptr);
-    CHECK(inifile_section_store_value(section, "key 2", 0, "value 2", 0) != nullptr);
-    CHECK(inifile_section_store_value(section, "key 3", 0, "value 3", 0) != nullptr);
+    static const char text[] =
+        "[device]\n"
+        "name = first\n"
+        "address = 1\n"
+        "[device 2]\n"
+        "name = second\n"
+        "address = 2\n"
+        ;
 
-    auto *head = section->values_head;
-    auto *tail = section->values_tail;
+    struct inifile_string_pool pool;
+    inifile_string_pool_init(&pool);
 
-    CHECK(inifile_section_remove_value(section, "key 2", 0));
+    for(const unsigned int flags : {0U, unsigned(INIFILE_FLAG_ARENA | INIFILE_FLAG_INDEX),
+                                    unsigned(INIFILE_FLAG_BORROWED)})
+    {
+        const struct inifile_parse_options options { flags, nullptr, 0, &pool };
+        struct ini_file parsed;
+        REQUIRE(inifile_parse_from_memory_with_options(&parsed, "test", text,
+                                                       sizeof(text) - 1, &options) == 0);
+
+        struct ini_file built;
+        inifile_new_with_string_pool(&built, flags & ~INIFILE_FLAG_BORROWED, &pool);
+        auto *section = inifile_new_section(&built, "device", 0);
+        REQUIRE(section != nullptr);
+        REQUIRE(inifile_section_store_value(section, "name", 0, "third", 0) != nullptr);
+
+        const char *const name = inifile_string_pool_find(&pool, "name", 0);
+        REQUIRE(name != nullptr);
+        CHECK(name == inifile_string_pool_intern(&pool, "name", 4));
+
+        const auto *kv1 = inifile_section_lookup_kv_pair(inifile_find_section(&parsed, "device", 0), name, 4);
+        const auto *kv2 = inifile_section_lookup_kv_pair(inifile_find_section(&parsed, "device 2", 0), name, 4);
+        const auto *kv3 = inifile_section_lookup_kv_pair(section, name, 4);
+        REQUIRE(kv1 != nullptr);
+        REQUIRE(kv2 != nullptr);
+        REQUIRE(kv3 != nullptr);
+        CHECK(kv1->key == name);
+        CHECK(kv2->key == name);
+        CHECK(kv3->key == name);
+        CHECK(section->name == parsed.sections_head->name);
+        CHECK(std::string(kv3->value) == "third");
+
+        /* removing keys and sections does not free interned strings */
+        CHECK(inifile_section_remove_value(section, "name", 0));
+        CHECK(inifile_remove_section_by_name(&parsed, "device", 0));
+        CHECK(inifile_string_pool_find(&pool, "device", 0) == section->name);
+
+        inifile_free(&parsed);
+        inifile_free(&built);
+    }
 
-    CHECK(inifile_section_lookup_kv_pair(section, "key 1", 0) != nullptr);
-    CHECK(inifile_section_lookup_kv_pair(section, "key 2", 0) == nullptr);
-    CHECK(inifile_section_lookup_kv_pair(section, "key 3", 0) != nullptr);
+    CHECK(inifile_string_pool_find(&pool, "first", 0) == nullptr);
 
-    CHECK(section->values_head == head);
-    CHECK(section->values_tail == tail);
+    inifile_string_pool_free(&pool);
 }
 
 /*!\test
- * Removing the last key from a section works as expected.
+ * Names parsed in parallel end up in the caller's string pool, not in the
+ * private pools used by the parser threads.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove existing tail key from section")
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Parallel parsing interns names into given pool")
 {
-    auto *section = inifile_new_section(&ini, "section", 0);
-    REQUIRE(section != nullptr);
+    std::string text;
 
-    CHECK(inifile_section_store_value(section, "key 1", 0, "value 1", 0) != nullptr);
-    CHECK(inifile_section_store_value(section, "key 2", 0, "value 2", 0) != nullptr);
-    CHECK(inifile_section_store_value(section, "key 3", 0, "value 3", 0) != nullptr);
+    for(int i = 0; i < 4000; ++i)
+    {
+        text += "[section " + std::to_string(i % 1500) + "]\n";
 
-    auto *head = section->values_head;
-    auto *tail = section->values_tail;
+        for(int j = 0; j < 10; ++j)
+            text += "key " + std::to_string((i + j) % 13) + " = value " +
+                    std::to_string(i) + "/" + std::to_string(j) + "\n";
+    }
 
-    CHECK(inifile_section_remove_value(section, "key 3", 0));
+    struct inifile_string_pool pool;
+    inifile_string_pool_init(&pool);
 
-    CHECK(inifile_section_lookup_kv_pair(section, "key 1", 0) != nullptr);
-    CHECK(inifile_section_lookup_kv_pair(section, "key 2", 0) != nullptr);
-    CHECK(inifile_section_lookup_kv_pair(section, "key 3", 0) == nullptr);
+    for(const unsigned int flags : {0U, unsigned(INIFILE_FLAG_ARENA | INIFILE_FLAG_INDEX)})
+    {
+        const struct inifile_parse_options options { flags, nullptr, 0, &pool };
 
-    CHECK(section->values_head == head);
-    CHECK(section->values_tail != tail);
+        REQUIRE(inifile_parse_from_memory_with_options(&ini, "test",
+                                                       text.c_str(), text.size(),
+                                                       &options) == 0);
+
+        struct ini_file parallel_ini;
+        REQUIRE(inifile_parse_from_memory_parallel(&parallel_ini, "test",
+                                                   text.c_str(), text.size(),
+                                                   &options, 4) == 0);
+
+        CHECK(dump_inifile(&parallel_ini) == dump_inifile(&ini));
+
+        for(const auto *s = parallel_ini.sections_head; s != nullptr; s = s->next)
+        {
+            CHECK(s->name == inifile_string_pool_find(&pool, s->name, s->name_length));
+
+            for(const auto *kv = s->values_head; kv != nullptr; kv = kv->next)
+                CHECK(kv->key == inifile_string_pool_find(&pool, kv->key, kv->key_length));
+        }
+
+        inifile_free(&parallel_ini);
+        inifile_free(&ini);
+        inifile_new(&ini);
+    }
+
+    inifile_string_pool_free(&pool);
+}
+
+TEST_SUITE_END();
+
+TEST_SUITE_BEGIN("INI file differences");
+
+static std::vector<std::string> describe_diff(const struct inifile_diff &diff)
+{
+    static const char *const kinds[] =
+        { "+section", "-section", "+value", "-value", "*value" };
+    std::vector<std::string> result;
+
+    for(size_t i = 0; i < diff.number_of_changes; ++i)
+    {
+        const auto &c(diff.changes[i]);
+        const auto *section = c.new_section != nullptr ? c.new_section : c.old_section;
+        std::string d = std::string(kinds[c.kind]) + " " + section->name;
+
+        if(c.old_kv != nullptr)
+            d += std::string(" ") + c.old_kv->key + "=" + c.old_kv->value;
+
+        if(c.new_kv != nullptr)
+            d += std::string(" ") + c.new_kv->key + "=" + c.new_kv->value;
+
+        result.push_back(d);
+    }
+
+    return result;
 }
 
 /*!\test
- * Removing a non-existent key from a section returns an error.
+ * All kinds of differences are found, with and without indices.
  */
-TEST_CASE_FIXTURE(InifileManipulationTestsFixture, "Remove nonexistant key from section")
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Differences between INI files")
 {
-    auto *section = inifile_new_section(&ini, "section", 0);
-    REQUIRE(section != nullptr);
+    static const char old_text[] =
+        "[same]\n"
+        "a = 1\n"
+        "[modified]\n"
+        "a = 1\n"
+        "b = 2\n"
+        "c = 3\n"
+        "[removed]\n"
+        "x = 1\n"
+        ;
 
-    CHECK(inifile_section_store_value(section, "key", 0, "value", 0) != nullptr);
-    CHECK_FALSE(inifile_section_remove_value(section, "k", 0));
-    CHECK(inifile_section_lookup_kv_pair(section, "key", 0) != nullptr);
+    static const char new_text[] =
+        "[added]\n"
+        "y = 2\n"
+        "[modified]\n"
+        "d = 4\n"
+        "c = 3\n"
+        "a = 10\n"
+        "[same]\n"
+        "a = 1\n"
+        ;
+
+    const std::vector<std::string> expected
+    {
+        "+section added",
+        "+value added y=2",
+        "+value modified d=4",
+        "*value modified a=1 a=10",
+        "-value modified b=2",
+        "-section removed",
+        "-value removed x=1",
+    };
+
+    for(const unsigned int flags : {0U, unsigned(INIFILE_FLAG_INDEX)})
+    {
+        const struct inifile_parse_options options { flags, nullptr, 0, nullptr };
+        struct ini_file old_ini;
+        struct ini_file new_ini;
+
+        REQUIRE(inifile_parse_from_memory_with_options(&old_ini, "old", old_text,
+                                                       sizeof(old_text) - 1, &options) == 0);
+        REQUIRE(inifile_parse_from_memory_with_options(&new_ini, "new", new_text,
+                                                       sizeof(new_text) - 1, &options) == 0);
+
+        struct inifile_diff diff;
+        REQUIRE(inifile_compute_diff(&diff, &old_ini, &new_ini) == 0);
+        CHECK(describe_diff(diff) == expected);
+        inifile_diff_free(&diff);
+
+        REQUIRE(inifile_compute_diff(&diff, &new_ini, &new_ini) == 0);
+        CHECK(diff.number_of_changes == 0);
+        inifile_diff_free(&diff);
+
+        inifile_free(&old_ini);
+        inifile_free(&new_ini);
+    }
 }
 
-TEST_SUITE_END();
+/*!\test
+ * Large sections are compared through temporary indices.
+ */
+TEST_CASE_FIXTURE(InifileParserTestsFixture, "Differences between large INI files")
+{
+    struct ini_file old_ini;
+    struct ini_file new_ini;
+    inifile_new(&old_ini);
+    inifile_new(&new_ini);
 
-/*!@}*/
+    for(int i = 0; i < 50; ++i)
+    {
+        const std::string name("section " + std::to_string(i));
+        auto *old_section = inifile_new_section(&old_ini, name.c_str(), 0);
+        auto *new_section = inifile_new_section(&new_ini, name.c_str(), 0);
+        REQUIRE(old_section != nullptr);
+        REQUIRE(new_section != nullptr);
+
+        for(int j = 0; j < 50; ++j)
+        {
+            const std::string key("key " + std::to_string(j));
+            REQUIRE(inifile_section_store_value(old_section, key.c_str(), 0, "v", 0) != nullptr);
+
+            /* new file: key 7 changed in section 3, key 9 missing in all */
+            if(j != 9)
+                REQUIRE(inifile_section_store_value(new_section, key.c_str(), 0,
+                                                    i == 3 && j == 7 ? "w" : "v", 0) != nullptr);
+        }
+    }
+
+    struct inifile_diff diff;
+    REQUIRE(inifile_compute_diff(&diff, &old_ini, &new_ini) == 0);
+    REQUIRE(diff.number_of_changes == 51);
+    CHECK(describe_diff(diff)[0] == "-value section 0 key 9=v");
+    CHECK(describe_diff(diff)[3] == "*value section 3 key 7=v key 7=w");
+    CHECK(describe_diff(diff)[4] == "-value section 3 key 9=v");
+    inifile_diff_free(&diff);
+
+    inifile_free(&old_ini);
+    inifile_free(&new_ini);
+}
+
+TEST_SUITE_END();